@@ -0,0 +1,293 @@
+/*
+* Compressed RGB animation format for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "spiled.h"
+#include "anim.h"
+
+static const uint8_t OP_SKIP = 0x00;
+static const uint8_t OP_LITERAL = 0x40;
+static const uint8_t OP_RUN = 0x80;
+static const int OP_MAX_COUNT = 64;
+
+// A run must save at least this much over literals to be worth an op.
+static const int MIN_RUN = 3;
+
+static const int FRAME_BYTES = GRID_AREA * 3;
+
+static inline uint16_t get16(const uint8_t* p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static inline uint32_t get32(const uint8_t* p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void put32(uint8_t* p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+bool animOpen(animReader_t* pReader, const char* path)
+{
+    memset(pReader, 0, sizeof(*pReader));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < ANIM_HEADER_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    pReader->data = (const uint8_t*)p;
+    pReader->size = st.st_size;
+
+    const uint8_t* h = pReader->data;
+    pReader->width = get16(&h[6]);
+    pReader->height = get16(&h[8]);
+    pReader->fps = get16(&h[10]);
+    pReader->frameCount = get32(&h[12]);
+    if (memcmp(h, "SPLA", 4) != 0 || h[4] != ANIM_VERSION ||
+        pReader->width != GRID_WIDTH || pReader->height != GRID_HEIGHT)
+    {
+        printf("%s: not a %dx%d SPLA v%d animation\n", path,
+            GRID_WIDTH, GRID_HEIGHT, ANIM_VERSION);
+        animClose(pReader);
+        return false;
+    }
+
+    animRewind(pReader);
+    return true;
+}
+
+void animClose(animReader_t* pReader)
+{
+    if (pReader->data != NULL)
+        munmap((void*)pReader->data, pReader->size);
+    memset(pReader, 0, sizeof(*pReader));
+}
+
+void animRewind(animReader_t* pReader)
+{
+    pReader->pos = ANIM_HEADER_SIZE;
+    pReader->frame = 0;
+}
+
+// Walks the XORed byte stream over the r, g, b bytes of the grid pixels.
+struct byteCursor_t
+{
+    rgbPixel_t* pixel;
+    int channel;            // 0 = r, 1 = g, 2 = b
+    int offset;             // byte offset into the frame
+};
+
+static inline void cursorSkip(byteCursor_t& c, int count)
+{
+    int channel = c.channel + count;
+    c.pixel += channel / 3;
+    c.channel = channel % 3;
+    c.offset += count;
+}
+
+static inline void cursorXor(byteCursor_t& c, uint8_t value)
+{
+    (&c.pixel->r)[c.channel] ^= value;
+    if (++c.channel == 3)
+    {
+        c.channel = 0;
+        c.pixel++;
+    }
+    c.offset++;
+}
+
+int animNextFrame(animReader_t* pReader, rgbPixel_t* grid, rowMask_t* pDirty)
+{
+    *pDirty = 0;
+    if (pReader->pos + ANIM_FRAME_HEADER_SIZE > pReader->size)
+        return 0;
+
+    const uint8_t* pFrame = &pReader->data[pReader->pos];
+    uint8_t type = pFrame[0];
+    uint32_t length = get32(&pFrame[1]);
+    if ((type != 'K' && type != 'D') ||
+        pReader->pos + ANIM_FRAME_HEADER_SIZE + length > pReader->size)
+    {
+        return -1;
+    }
+
+    if (type == 'K')
+    {
+        for (int i = 0; i < GRID_AREA; i++)
+            grid[i].r = grid[i].g = grid[i].b = 0;
+        *pDirty = ALL_ROWS;
+    }
+
+    const uint8_t* p = pFrame + ANIM_FRAME_HEADER_SIZE;
+    const uint8_t* pEnd = p + length;
+    byteCursor_t cursor = { grid, 0, 0 };
+    const int ROW_BYTES = GRID_WIDTH * 3;
+
+    while (p < pEnd)
+    {
+        uint8_t op = *p++;
+        int count = (op & 0x3F) + 1;
+        if (cursor.offset + count > FRAME_BYTES)
+            return -1;
+
+        if ((op & 0xC0) == OP_SKIP)
+        {
+            cursorSkip(cursor, count);
+            continue;
+        }
+
+        int firstRow = cursor.offset / ROW_BYTES;
+        int lastRow = (cursor.offset + count - 1) / ROW_BYTES;
+        *pDirty |= ((((rowMask_t)2 << lastRow) - 1) >> firstRow) << firstRow;
+
+        if ((op & 0xC0) == OP_LITERAL)
+        {
+            if (p + count > pEnd)
+                return -1;
+            for (int i = 0; i < count; i++)
+                cursorXor(cursor, *p++);
+        }
+        else if ((op & 0xC0) == OP_RUN)
+        {
+            if (p >= pEnd)
+                return -1;
+            uint8_t value = *p++;
+            for (int i = 0; i < count; i++)
+                cursorXor(cursor, value);
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    pReader->pos += ANIM_FRAME_HEADER_SIZE + length;
+    pReader->frame++;
+    return 1;
+}
+
+// Emit diff[start, end) as literal ops.
+static uint8_t* putLiterals(uint8_t* p, const uint8_t* diff, int start, int end)
+{
+    while (start < end)
+    {
+        int count = end - start;
+        if (count > OP_MAX_COUNT)
+            count = OP_MAX_COUNT;
+        *p++ = OP_LITERAL | (count - 1);
+        memcpy(p, &diff[start], count);
+        p += count;
+        start += count;
+    }
+    return p;
+}
+
+static inline uint8_t xorByte(const rgbPixel_t* prev, const rgbPixel_t* cur, int offset)
+{
+    int pixel = offset / 3;
+    int channel = offset % 3;
+    uint8_t before = prev? (&prev[pixel].r)[channel] : 0;
+    return before ^ (&cur[pixel].r)[channel];
+}
+
+int animEncodeFrame(const rgbPixel_t* prev, const rgbPixel_t* cur, uint8_t* out)
+{
+    uint8_t diff[FRAME_BYTES];
+    for (int i = 0; i < FRAME_BYTES; i++)
+        diff[i] = xorByte(prev, cur, i);
+
+    uint8_t* p = out + ANIM_FRAME_HEADER_SIZE;
+    int literalStart = -1;
+
+    int i = 0;
+    while (i < FRAME_BYTES)
+    {
+        int run = 1;
+        while (i + run < FRAME_BYTES && diff[i + run] == diff[i] && run < OP_MAX_COUNT)
+            run++;
+
+        // A lone unchanged byte is cheaper inside a literal than as a skip.
+        if ((diff[i] == 0 && run >= 2) || run >= MIN_RUN)
+        {
+            if (literalStart >= 0)
+                p = putLiterals(p, diff, literalStart, i);
+            literalStart = -1;
+            if (diff[i] == 0)
+            {
+                // Trailing unchanged bytes need no op at all.
+                int skip = run;
+                while (i + skip < FRAME_BYTES && diff[i + skip] == 0)
+                    skip++;
+                if (i + skip < FRAME_BYTES)
+                {
+                    for (int left = skip; left > 0; left -= OP_MAX_COUNT)
+                        *p++ = OP_SKIP | ((left > OP_MAX_COUNT? OP_MAX_COUNT : left) - 1);
+                }
+                i += skip;
+            }
+            else
+            {
+                *p++ = OP_RUN | (run - 1);
+                *p++ = diff[i];
+                i += run;
+            }
+        }
+        else
+        {
+            if (literalStart < 0)
+                literalStart = i;
+            i++;
+        }
+    }
+    if (literalStart >= 0)
+        p = putLiterals(p, diff, literalStart, FRAME_BYTES);
+
+    int length = p - (out + ANIM_FRAME_HEADER_SIZE);
+    out[0] = prev? 'D' : 'K';
+    put32(&out[1], length);
+    return ANIM_FRAME_HEADER_SIZE + length;
+}
+
+void animWriteHeader(uint8_t* out, int fps, uint32_t frameCount)
+{
+    memcpy(out, "SPLA", 4);
+    out[4] = ANIM_VERSION;
+    out[5] = 0;
+    put16(&out[6], GRID_WIDTH);
+    put16(&out[8], GRID_HEIGHT);
+    put16(&out[10], fps);
+    put32(&out[12], frameCount);
+}
@@ -0,0 +1,64 @@
+/*
+* Compressed RGB animation format for the SPI NEOPixel display
+* By R. Blansett
+*
+* A .spla file is a 16 byte header followed by frames:
+*
+*   header: "SPLA", version, 0, width (u16), height (u16), fps (u16),
+*           frame count (u32)                        (all little endian)
+*   frame:  type ('K' keyframe or 'D' delta), payload length (u32), payload
+*
+* Frames hold grid-ready pixels (r, g, b per pixel, already scaled the way
+* makeRgbPixel wants). A payload is a list of ops over those bytes, XORed
+* against the previous frame (against black for a keyframe):
+*
+*   00nnnnnn            skip n+1 unchanged bytes
+*   01nnnnnn b0..bn     n+1 literal XOR bytes
+*   10nnnnnn b          n+1 copies of XOR byte b
+*
+* The decoder applies a frame straight into an rgbPixel_t grid and reports
+* the rows it touched, so only those rows need to be re-encoded.
+*/
+
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "spiled.h"
+
+static const int ANIM_HEADER_SIZE = 16;
+static const int ANIM_FRAME_HEADER_SIZE = 5;
+static const uint8_t ANIM_VERSION = 1;
+
+// Generous bound on one frame's payload (all literals is about 1.02x).
+static const int ANIM_MAX_PAYLOAD = GRID_AREA * 3 * 2;
+
+struct animReader_t
+{
+    const uint8_t* data;        // the whole file, mmapped
+    size_t size;
+    size_t pos;                 // next frame header
+    int width;
+    int height;
+    int fps;
+    uint32_t frameCount;
+    uint32_t frame;             // frames decoded since the last rewind
+};
+
+bool animOpen(animReader_t* pReader, const char* path);
+void animClose(animReader_t* pReader);
+void animRewind(animReader_t* pReader);
+
+// Apply the next frame to grid. Returns 1, 0 at the end, -1 if corrupt.
+int animNextFrame(animReader_t* pReader, rgbPixel_t* grid, rowMask_t* pDirty);
+
+// Encode cur against prev (NULL for a keyframe), header included.
+// out must hold ANIM_FRAME_HEADER_SIZE + ANIM_MAX_PAYLOAD bytes.
+// Returns the number of bytes written.
+int animEncodeFrame(const rgbPixel_t* prev, const rgbPixel_t* cur, uint8_t* out);
+
+void animWriteHeader(uint8_t* out, int fps, uint32_t frameCount);
+
+#endif // ANIM_H
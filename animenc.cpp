@@ -0,0 +1,198 @@
+/*
+* SPLA animation encoder
+* By R. Blansett
+*
+* Turns a directory of numbered BMP frames into a compressed .spla file
+* for spiled's -A option, then times how fast it decodes.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "bmp24.h"
+#include "arena.h"
+#include "anim.h"
+
+static const char *output = "out.spla";
+static int frameRate = 30;
+static int keyInterval = 0;
+static uint32_t speed = 8000000;
+
+static void pabort(const char *s)
+{
+    perror(s);
+    abort();
+}
+
+static int isBmpFile(const struct dirent *entry)
+{
+    size_t len = strlen(entry->d_name);
+    return len > 4 && strcasecmp(entry->d_name + len - 4, ".bmp") == 0;
+}
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void benchmarkDecode(const char* path, long rawBytes)
+{
+    animReader_t reader;
+    if (!animOpen(&reader, path))
+        pabort("can't reopen output");
+
+    static rgbPixel_t grid[GRID_AREA];
+    long frames = 0;
+    long rowsDirty = 0;
+    double start = now();
+    double elapsed = 0;
+    while (elapsed < 1.0)
+    {
+        animRewind(&reader);
+        rowMask_t dirty;
+        int ret;
+        while ((ret = animNextFrame(&reader, grid, &dirty)) == 1)
+        {
+            frames++;
+            rowsDirty += __builtin_popcountll(dirty);
+        }
+        if (ret < 0)
+        {
+            printf("decode error at frame %u\n", reader.frame);
+            break;
+        }
+        elapsed = now() - start;
+    }
+
+    // One frame on the wire: 8 bits per txBuffer byte.
+    double wireFps = speed / (8.0 * txBuffer_SIZE);
+    printf("decode: %.0f frames/s (%.1f MB/s of RGB), %.0fx the %.0f fps wire rate\n",
+        frames / elapsed, frames * (rawBytes / (double)reader.frameCount) / elapsed / 1e6,
+        frames / elapsed / wireFps, wireFps);
+    printf("dirty rows: %.1f of %d per frame\n",
+        frames? (double)rowsDirty / frames : 0.0, GRID_HEIGHT);
+    animClose(&reader);
+}
+
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [-orks] frame-directory\n", prog);
+    puts("  -o --output   file to write (default out.spla)\n"
+         "  -r --rate     playback frame rate (default 30)\n"
+         "  -k --key      keyframe every N frames (default first only)\n"
+         "  -s --speed    SPI speed for the wire rate comparison (Hz)\n"
+    );
+    exit(1);
+}
+
+static void parse_opts(int argc, char *argv[])
+{
+    while (1) {
+        static const struct option lopts[] = {
+            { "output", 1, 0, 'o' },
+            { "rate",   1, 0, 'r' },
+            { "key",    1, 0, 'k' },
+            { "speed",  1, 0, 's' },
+            { NULL, 0, 0, 0 },
+        };
+        int c;
+
+        c = getopt_long(argc, argv, "o:r:k:s:", lopts, NULL);
+
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 'o':
+            output = optarg;
+            break;
+        case 'r':
+            frameRate = atoi(optarg);
+            break;
+        case 'k':
+            keyInterval = atoi(optarg);
+            break;
+        case 's':
+            speed = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            break;
+        }
+    }
+    if (optind != argc - 1)
+        print_usage(argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    parse_opts(argc, argv);
+    const char* dir = argv[optind];
+
+    struct dirent **names;
+    int count = scandir(dir, &names, isBmpFile, versionsort);
+    if (count < 0)
+        pabort("can't read frame directory");
+    if (count == 0)
+    {
+        printf("no BMP frames in %s\n", dir);
+        exit(1);
+    }
+
+    FILE* f = fopen(output, "wb");
+    if (f == NULL)
+        pabort("can't create output");
+
+    uint8_t header[ANIM_HEADER_SIZE];
+    animWriteHeader(header, frameRate, count);
+    fwrite(header, 1, sizeof(header), f);
+
+    static rgbPixel_t frames[2][GRID_AREA];
+    static uint8_t encoded[ANIM_FRAME_HEADER_SIZE + ANIM_MAX_PAYLOAD];
+    arena_t arena;
+    if (!arenaInit(&arena, DEFAULT_ARENA_KB * 1024))
+        pabort("can't allocate BMP arena");
+    long total = sizeof(header);
+    int keyframes = 0;
+    char path[512];
+
+    for (int i = 0; i < count; i++)
+    {
+        rgbPixel_t* cur = frames[i & 1];
+        rgbPixel_t* prev = frames[(i + 1) & 1];
+
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]->d_name);
+        if (!bmpLoadFrame(path, &arena, cur))
+        {
+            printf("Failed to read BMP file: %s\n", path);
+            exit(2);
+        }
+        free(names[i]);
+
+        bool key = i == 0 || (keyInterval > 0 && i % keyInterval == 0);
+        int len = animEncodeFrame(key? NULL : prev, cur, encoded);
+        fwrite(encoded, 1, len, f);
+        total += len;
+        keyframes += key;
+    }
+    free(names);
+    fclose(f);
+    arenaFree(&arena);
+
+    long raw = (long)count * GRID_AREA * 3;
+    long wire = (long)count * txBuffer_SIZE;
+    printf("%s: %d frames (%d keyframes), %ld bytes\n", output, count, keyframes, total);
+    printf("size: %.1f%% of raw RGB (%ld), %.1f%% of wire frames (%ld)\n",
+        100.0 * total / raw, raw, 100.0 * total / wire, wire);
+
+    benchmarkDecode(output, raw);
+    return 0;
+}
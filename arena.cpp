@@ -0,0 +1,43 @@
+/*
+* Region allocator for asset loading
+* By R. Blansett
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+static const size_t ALIGN = 16;
+
+bool arenaInit(arena_t* pArena, size_t size)
+{
+    memset(pArena, 0, sizeof(*pArena));
+    pArena->base = (uint8_t*)malloc(size);
+    if (pArena->base == NULL)
+        return false;
+    pArena->size = size;
+    return true;
+}
+
+void arenaFree(arena_t* pArena)
+{
+    free(pArena->base);
+    pArena->base = NULL;
+    pArena->size = 0;
+    pArena->used = 0;
+}
+
+void* arenaAlloc(arena_t* pArena, size_t size)
+{
+    size_t start = (pArena->used + ALIGN - 1) & ~(ALIGN - 1);
+    if (start > pArena->size || size > pArena->size - start)
+    {
+        pArena->refused++;
+        return NULL;
+    }
+    pArena->used = start + size;
+    if (pArena->used > pArena->peak)
+        pArena->peak = pArena->used;
+    return pArena->base + start;
+}
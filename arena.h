@@ -0,0 +1,54 @@
+/*
+* Region allocator for asset loading
+* By R. Blansett
+*
+* One block, allocated at startup and sized with -k, that asset loads
+* bump-allocate from. A load takes a mark first and releases back to it
+* when its frame is converted, so in steady state loading never touches
+* the heap and a long-running controller can't fragment it. The peak
+* use is kept, to size the block exactly on small devices.
+*
+* Not thread-safe: one thread allocates at a time (the loaders run one
+* after another).
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const int DEFAULT_ARENA_KB = 1024;
+
+struct arena_t
+{
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    size_t peak;
+    uint32_t refused;           // allocations that didn't fit
+};
+
+bool arenaInit(arena_t* pArena, size_t size);
+void arenaFree(arena_t* pArena);
+
+// 16-byte aligned; NULL if the arena is full.
+void* arenaAlloc(arena_t* pArena, size_t size);
+
+// Everything allocated after arenaMark() goes with arenaRelease().
+static inline size_t arenaMark(const arena_t* pArena)
+{
+    return pArena->used;
+}
+
+static inline void arenaRelease(arena_t* pArena, size_t mark)
+{
+    pArena->used = mark;
+}
+
+static inline void arenaReset(arena_t* pArena)
+{
+    pArena->used = 0;
+}
+
+#endif // ARENA_H
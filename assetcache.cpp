@@ -0,0 +1,357 @@
+/*
+* On-disk cache of converted assets
+* By R. Blansett
+*/
+
+#include <stdint.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <new>
+
+#include "assetcache.h"
+#include "pixelmap.h"
+#include "idle.h"
+#include "arena.h"
+
+// Bump when the entry layout or the encoding changes.
+static const uint32_t CACHE_VERSION = 1;
+static const char CACHE_MAGIC[4] = { 'S', 'P', 'L', 'C' };
+
+struct cacheHeader_t
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t settings;
+    uint32_t pathLen;           // source path follows the header
+    uint32_t rgbOffset;
+    uint32_t wireOffset;
+    uint32_t wireLen;
+};
+
+static long usecsSince(const struct timespec& start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000000L + (now.tv_nsec - start.tv_nsec) / 1000L;
+}
+
+bool cacheInit(assetCache_t* pCache, const char* dir, int maxKB, arena_t* pArena)
+{
+    memset(pCache, 0, sizeof(*pCache));
+    if (strlen(dir) >= sizeof(pCache->dir))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strcpy(pCache->dir, dir);
+    pCache->maxBytes = (uint64_t)maxKB * 1024;
+    pCache->pArena = pArena;
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+        return false;
+
+    // Anything that changes the converted bytes for the same source file.
+    uint32_t geometry[4] = { CACHE_VERSION, GRID_WIDTH, GRID_HEIGHT, REFRESH_SIZE };
+    pCache->settings = idleHash(geometry, sizeof(geometry)) ^ idleHash(ledMap, sizeof(ledMap));
+    return true;
+}
+
+static uint32_t align8(uint32_t n)
+{
+    return (n + 7) & ~7u;
+}
+
+// Map an existing entry and check it really is the one asked for.
+static bool mapEntry(const char* name, uint64_t key, uint64_t settings,
+    const char* path, cacheEntry_t* pEntry)
+{
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(cacheHeader_t))
+    {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    const cacheHeader_t* pHeader = (const cacheHeader_t*)map;
+    const char* pPath = (const char*)(pHeader + 1);
+    size_t len = st.st_size;
+    bool ok = memcmp(pHeader->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+        pHeader->version == CACHE_VERSION && pHeader->key == key &&
+        pHeader->settings == settings &&
+        sizeof(*pHeader) + pHeader->pathLen <= len &&
+        pHeader->pathLen == strlen(path) &&
+        memcmp(pPath, path, pHeader->pathLen) == 0 &&
+        pHeader->rgbOffset + sizeof(rgbPixel_t) * GRID_AREA <= len &&
+        pHeader->wireLen == txBuffer_SIZE &&
+        pHeader->wireOffset + pHeader->wireLen <= len;
+    if (!ok)
+    {
+        munmap(map, len);
+        close(fd);
+        return false;
+    }
+
+    // A hit makes this the most recently used entry.
+    futimens(fd, NULL);
+    close(fd);
+
+    pEntry->map = map;
+    pEntry->mapLen = len;
+    pEntry->rgb = (const rgbPixel_t*)((const uint8_t*)map + pHeader->rgbOffset);
+    pEntry->wire = (const uint8_t*)map + pHeader->wireOffset;
+    pEntry->wireLen = pHeader->wireLen;
+    return true;
+}
+
+static bool writeAll(int fd, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Build the entry in memory, then write it under a temporary name and
+// rename it into place so a reader never sees half an entry.
+static void* buildEntry(arena_t* pArena, uint64_t key, uint64_t settings,
+    const char* path, const display_t* pFrame, size_t* pLen)
+{
+    cacheHeader_t header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.settings = settings;
+    header.pathLen = strlen(path);
+    header.rgbOffset = align8(sizeof(header) + header.pathLen);
+    header.wireOffset = align8(header.rgbOffset + sizeof(pFrame->rgb));
+    header.wireLen = sizeof(pFrame->tx);
+
+    size_t len = header.wireOffset + header.wireLen;
+    uint8_t* pData = (uint8_t*)arenaAlloc(pArena, len);
+    if (pData == NULL)
+        return NULL;
+    memset(pData, 0, len);
+    memcpy(pData, &header, sizeof(header));
+    memcpy(pData + sizeof(header), path, header.pathLen);
+    memcpy(pData + header.rgbOffset, pFrame->rgb, sizeof(pFrame->rgb));
+    memcpy(pData + header.wireOffset, pFrame->tx, sizeof(pFrame->tx));
+    *pLen = len;
+    return pData;
+}
+
+static bool storeEntry(const char* name, const void* data, size_t len)
+{
+    // Room for the suffix on a PATH_MAX name; a name that still doesn't
+    // fit must not be truncated into some other file's.
+    char tmpName[PATH_MAX + 32];
+    int tmpLen = snprintf(tmpName, sizeof(tmpName), "%s.%d.tmp", name, (int)getpid());
+    if (tmpLen < 0 || tmpLen >= (int)sizeof(tmpName))
+        return false;
+
+    int fd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    bool ok = writeAll(fd, data, len);
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmpName, name) < 0)
+    {
+        unlink(tmpName);
+        return false;
+    }
+    return true;
+}
+
+static int isEntryFile(const struct dirent* pEntry)
+{
+    size_t len = strlen(pEntry->d_name);
+    return len > 4 && strcmp(&pEntry->d_name[len - 4], ".spc") == 0;
+}
+
+struct lruFile_t
+{
+    struct timespec used;
+    off_t size;
+    char* name;
+};
+
+static int compareUsed(const void* a, const void* b)
+{
+    const lruFile_t* pA = (const lruFile_t*)a;
+    const lruFile_t* pB = (const lruFile_t*)b;
+    if (pA->used.tv_sec != pB->used.tv_sec)
+        return pA->used.tv_sec < pB->used.tv_sec? -1 : 1;
+    if (pA->used.tv_nsec != pB->used.tv_nsec)
+        return pA->used.tv_nsec < pB->used.tv_nsec? -1 : 1;
+    return 0;
+}
+
+// Delete the least recently used entries until the directory fits.
+// keep is the entry just loaded, which always stays.
+static void evict(assetCache_t* pCache, const char* keep)
+{
+    struct dirent** names;
+    int count = scandir(pCache->dir, &names, isEntryFile, NULL);
+    if (count < 0)
+        return;
+
+    lruFile_t* files = new lruFile_t[count > 0? count : 1];
+    int used = 0;
+    uint64_t total = 0;
+    char name[PATH_MAX];
+    for (int i = 0; i < count; i++)
+    {
+        struct stat st;
+        snprintf(name, sizeof(name), "%s/%s", pCache->dir, names[i]->d_name);
+        if (stat(name, &st) == 0)
+        {
+            files[used].used = st.st_mtim;
+            files[used].size = st.st_size;
+            files[used].name = names[i]->d_name;
+            total += st.st_size;
+            used++;
+        }
+    }
+
+    if (total > pCache->maxBytes)
+    {
+        qsort(files, used, sizeof(files[0]), compareUsed);
+        for (int i = 0; i < used && total > pCache->maxBytes; i++)
+        {
+            snprintf(name, sizeof(name), "%s/%s", pCache->dir, files[i].name);
+            if (strcmp(name, keep) == 0)
+                continue;
+            if (unlink(name) == 0)
+            {
+                total -= files[i].size;
+                pCache->evictions++;
+            }
+        }
+    }
+
+    delete[] files;
+    for (int i = 0; i < count; i++)
+        free(names[i]);
+    free(names);
+}
+
+bool cacheLoad(assetCache_t* pCache, const char* path, assetConvert_t convert,
+    cacheEntry_t* pEntry)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(pEntry, 0, sizeof(*pEntry));
+
+    char realPath[PATH_MAX];
+    struct stat st;
+    if (realpath(path, realPath) == NULL || stat(realPath, &st) < 0)
+        return false;
+
+    // The key covers which file, which version of it, and how it is encoded.
+    uint64_t version[3] = { (uint64_t)st.st_mtim.tv_sec, (uint64_t)st.st_mtim.tv_nsec,
+        (uint64_t)st.st_size };
+    uint64_t key = idleHash(realPath, strlen(realPath)) ^
+        idleHash(version, sizeof(version)) * 3 ^ pCache->settings;
+
+    char name[PATH_MAX];
+    snprintf(name, sizeof(name), "%s/%016llx.spc", pCache->dir, (unsigned long long)key);
+
+    if (mapEntry(name, key, pCache->settings, realPath, pEntry))
+    {
+        pEntry->hit = true;
+        pEntry->usecs = usecsSince(start);
+        pCache->hits++;
+        pCache->hitUsecs += pEntry->usecs;
+        return true;
+    }
+
+    // Miss: convert and encode the way the display would, with the frame
+    // and the entry image both in the arena until the entry is stored.
+    size_t mark = arenaMark(pCache->pArena);
+    void* pScratch = arenaAlloc(pCache->pArena, sizeof(display_t));
+    if (pScratch == NULL)
+        return false;
+    display_t* pFrame = new (pScratch) display_t(ledMap);
+    pFrame->clear();
+    if (!convert(path, pFrame->rgb))
+    {
+        arenaRelease(pCache->pArena, mark);
+        return false;
+    }
+    pFrame->encode();
+
+    size_t len = 0;
+    void* pData = buildEntry(pCache->pArena, key, pCache->settings, realPath, pFrame, &len);
+    if (pData == NULL)
+    {
+        arenaRelease(pCache->pArena, mark);
+        return false;
+    }
+
+    bool stored = storeEntry(name, pData, len) &&
+        mapEntry(name, key, pCache->settings, realPath, pEntry);
+    if (!stored)
+    {
+        // Still hand back the converted asset, just not from the disk.
+        pCache->errors++;
+        void* map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+        {
+            arenaRelease(pCache->pArena, mark);
+            return false;
+        }
+        memcpy(map, pData, len);
+        const cacheHeader_t* pHeader = (const cacheHeader_t*)map;
+        pEntry->map = map;
+        pEntry->mapLen = len;
+        pEntry->rgb = (const rgbPixel_t*)((const uint8_t*)map + pHeader->rgbOffset);
+        pEntry->wire = (const uint8_t*)map + pHeader->wireOffset;
+        pEntry->wireLen = pHeader->wireLen;
+    }
+    arenaRelease(pCache->pArena, mark);
+
+    if (stored)
+        evict(pCache, name);
+
+    pEntry->hit = false;
+    pEntry->usecs = usecsSince(start);
+    pCache->misses++;
+    pCache->missUsecs += pEntry->usecs;
+    return true;
+}
+
+void cacheRelease(cacheEntry_t* pEntry)
+{
+    if (pEntry->map != NULL)
+        munmap(pEntry->map, pEntry->mapLen);
+    memset(pEntry, 0, sizeof(*pEntry));
+}
@@ -0,0 +1,73 @@
+/*
+* On-disk cache of converted assets
+* By R. Blansett
+*
+* Showing a BMP means reading it, swapping it to RGB, scaling it to the
+* grid, clamping it and encoding it, every time. The cache keeps the end
+* result instead: one file per asset holding the grid-sized RGB frame and
+* the complete wire frame (symbols plus REFRESH tail), ready to mmap and
+* send as it is.
+*
+* An entry is keyed by the asset's real path, mtime and size, plus the
+* grid geometry and LED map it was encoded for, so editing the file or
+* changing -m both miss. Entries are immutable; a hit just touches the
+* entry's mtime, and when the directory grows past its size limit the
+* entries touched longest ago are deleted first (LRU).
+*/
+
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "spiled.h"
+
+struct arena_t;
+
+static const int DEFAULT_CACHE_KB = 1024;
+
+// Convert a source asset into a grid-sized frame (e.g. readBMP + bmpToGrid).
+typedef bool (*assetConvert_t)(const char* path, rgbPixel_t* frame);
+
+struct assetCache_t
+{
+    char dir[256];
+    uint64_t maxBytes;
+    uint64_t settings;          // hash of geometry, LED map and format
+    arena_t* pArena;            // scratch for converting a miss
+
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t errors;            // entries that couldn't be written or read
+    uint64_t hitUsecs;          // total load time, warm
+    uint64_t missUsecs;         // total load time, cold (convert + store)
+};
+
+// A mapped entry. rgb and wire point into the mapping.
+struct cacheEntry_t
+{
+    void* map;
+    size_t mapLen;
+    const rgbPixel_t* rgb;      // GRID_AREA pixels
+    const uint8_t* wire;        // txBuffer_SIZE bytes
+    uint32_t wireLen;
+    bool hit;
+    long usecs;                 // how long the load took
+};
+
+// Create dir if needed. Call after pixelMapInit: the LED map is part of
+// every key. A miss builds its entry in pArena and releases it once the
+// entry is stored, so it needs no heap either.
+bool cacheInit(assetCache_t* pCache, const char* dir, int maxKB, arena_t* pArena);
+
+// Map the entry for path, converting and storing it first on a miss.
+// Returns false if the asset can't be converted. If only the cache
+// fails, the entry is still returned (from an anonymous mapping).
+bool cacheLoad(assetCache_t* pCache, const char* path, assetConvert_t convert,
+    cacheEntry_t* pEntry);
+
+void cacheRelease(cacheEntry_t* pEntry);
+
+#endif // ASSETCACHE_H
@@ -0,0 +1,377 @@
+/*
+* Audio-reactive visualizer for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "spiled.h"
+#include "fft.h"
+#include "audio.h"
+#include "trace.h"
+#include "timing.h"
+
+// Bars cover this much range below the loudest band seen lately.
+static const float RANGE_DB = 42.0f;
+// ... and the reference falls this fast once the music gets quieter.
+static const float PEAK_FALL_DB = 0.15f;
+static const float LOWEST_HZ = 50.0f;
+
+struct wavReader_t
+{
+    FILE* pFile;
+    bool pipe;
+    int channels;
+    uint32_t sampleRate;
+    uint32_t remaining;         // bytes of sample data left
+    int16_t* raw;               // one read's worth of interleaved samples
+    int rawFrames;
+};
+
+static uint32_t le32(const uint8_t* p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t le16(const uint8_t* p)
+{
+    return p[0] | p[1] << 8;
+}
+
+// Skip by reading, so it works on pipes.
+static bool skipBytes(FILE* pFile, uint32_t len)
+{
+    uint8_t scratch[256];
+    while (len > 0)
+    {
+        uint32_t n = len < sizeof(scratch)? len : sizeof(scratch);
+        if (fread(scratch, 1, n, pFile) != n)
+            return false;
+        len -= n;
+    }
+    return true;
+}
+
+static bool wavOpen(wavReader_t* pWav, const char* path, int maxFrames)
+{
+    memset(pWav, 0, sizeof(*pWav));
+    pWav->pFile = strcmp(path, "-") == 0? stdin : fopen(path, "rb");
+    if (pWav->pFile == NULL)
+        return false;
+    struct stat st;
+    pWav->pipe = fstat(fileno(pWav->pFile), &st) < 0 || !S_ISREG(st.st_mode);
+
+    uint8_t header[12];
+    if (fread(header, 1, sizeof(header), pWav->pFile) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(&header[8], "WAVE", 4) != 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    int bits = 0;
+    while (true)
+    {
+        uint8_t chunk[8];
+        if (fread(chunk, 1, sizeof(chunk), pWav->pFile) != sizeof(chunk))
+        {
+            errno = EINVAL;
+            return false;
+        }
+        uint32_t len = le32(&chunk[4]);
+
+        if (memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t fmt[16];
+            if (len < sizeof(fmt) || fread(fmt, 1, sizeof(fmt), pWav->pFile) != sizeof(fmt) ||
+                !skipBytes(pWav->pFile, len - sizeof(fmt) + (len & 1)))
+            {
+                errno = EINVAL;
+                return false;
+            }
+            // 1 = PCM, 0xFFFE = extensible (PCM in practice for 16 bits).
+            uint16_t format = le16(&fmt[0]);
+            pWav->channels = le16(&fmt[2]);
+            pWav->sampleRate = le32(&fmt[4]);
+            bits = le16(&fmt[14]);
+            if ((format != 1 && format != 0xFFFE) || bits != 16 || pWav->channels < 1)
+            {
+                errno = ENOTSUP;
+                return false;
+            }
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            // Streaming writers leave the size 0 or ~0: read to the end.
+            pWav->remaining = len == 0? 0xFFFFFFFF : len;
+            break;
+        }
+        else if (!skipBytes(pWav->pFile, len + (len & 1)))
+        {
+            errno = EINVAL;
+            return false;
+        }
+    }
+    if (bits == 0 || pWav->sampleRate == 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    pWav->rawFrames = maxFrames;
+    pWav->raw = new int16_t[maxFrames * pWav->channels];
+    return true;
+}
+
+static void wavClose(wavReader_t* pWav)
+{
+    if (pWav->pFile != NULL && pWav->pFile != stdin)
+        fclose(pWav->pFile);
+    delete[] pWav->raw;
+    pWav->raw = NULL;
+}
+
+// Read up to count frames, mixed down to mono. Returns frames read.
+static int wavRead(wavReader_t* pWav, int16_t* mono, int count)
+{
+    if (count > pWav->rawFrames)
+        count = pWav->rawFrames;
+    uint32_t frameBytes = 2 * pWav->channels;
+    if ((uint32_t)count * frameBytes > pWav->remaining)
+        count = pWav->remaining / frameBytes;
+
+    int got = fread(pWav->raw, frameBytes, count, pWav->pFile);
+    pWav->remaining -= got * frameBytes;
+    for (int i = 0; i < got; i++)
+    {
+        // Samples are little endian on the wire and in memory here.
+        const int16_t* pFrame = &pWav->raw[i * pWav->channels];
+        int32_t sum = 0;
+        for (int c = 0; c < pWav->channels; c++)
+            sum += pFrame[c];
+        mono[i] = sum / pWav->channels;
+    }
+    return got;
+}
+
+static long usecsBetween(const struct timespec& from, const struct timespec& to)
+{
+    return (to.tv_sec - from.tv_sec) * 1000000L + (to.tv_nsec - from.tv_nsec) / 1000L;
+}
+
+// Bin ranges for one log-spaced band per column: band b is
+// [edges[b], edges[b + 1]).
+static void bandEdges(int fftSize, uint32_t sampleRate, int* edges)
+{
+    int bins = fftSize / 2;
+    float low = LOWEST_HZ * fftSize / sampleRate;
+    if (low < 1)
+        low = 1;
+    for (int band = 0; band <= GRID_WIDTH; band++)
+    {
+        int edge = (int)lrintf(low * powf(bins / low, (float)band / GRID_WIDTH));
+        if (band > 0 && edge <= edges[band - 1])
+            edge = edges[band - 1] + 1;
+        // Never past Nyquist: with fewer bins than columns the top bands
+        // come out empty rather than reading off the end of power[].
+        if (edge > bins + 1)
+            edge = bins + 1;
+        edges[band] = edge;
+    }
+}
+
+static rgbPixel_t barColor(int row)
+{
+    // Green at the bottom through yellow to red at the top.
+    int height = GRID_HEIGHT - 1 - row;
+    int red = 48 * height / (GRID_HEIGHT - 1);
+    rgbPixel_t color = makeRgbPixel(color, red, 48 - red, 0);
+    return color;
+}
+
+static rgbPixel_t heatColor(float level)
+{
+    // Black, blue, magenta, orange, yellow, evenly spaced.
+    static const uint8_t STOPS[5][3] = {
+        { 0, 0, 0 }, { 0, 0, 48 }, { 48, 0, 48 }, { 48, 24, 0 }, { 48, 48, 0 },
+    };
+    float at = level * 4;
+    int stop = at >= 4? 3 : (int)at;
+    float t = at - stop;
+    const uint8_t* pFrom = STOPS[stop];
+    const uint8_t* pTo = STOPS[stop + 1];
+    rgbPixel_t color = makeRgbPixel(color,
+        pFrom[0] + (int)((pTo[0] - pFrom[0]) * t),
+        pFrom[1] + (int)((pTo[1] - pFrom[1]) * t),
+        pFrom[2] + (int)((pTo[2] - pFrom[2]) * t));
+    return color;
+}
+
+int audioRun(int fd, const audioConfig_t* pConfig, audioStats_t* pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+    int fps = pConfig->fps > 0? pConfig->fps : 30;
+
+    fft_t fft;
+    if (pConfig->fftSize < AUDIO_MIN_FFT_SIZE || pConfig->fftSize > AUDIO_MAX_FFT_SIZE ||
+        !fftInit(&fft, pConfig->fftSize))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    wavReader_t wav;
+    if (!wavOpen(&wav, pConfig->path, FFT_MAX_SIZE))
+    {
+        int err = errno;
+        wavClose(&wav);
+        fftFree(&fft);
+        errno = err;
+        return -1;
+    }
+    pStats->sampleRate = wav.sampleRate;
+    pStats->channels = wav.channels;
+
+    // The window slides by one frame's worth of samples each frame.
+    int hop = wav.sampleRate / fps;
+    if (hop > wav.rawFrames)
+        hop = wav.rawFrames;
+    if (hop < 1)
+        hop = 1;
+    int16_t* window = new int16_t[fft.size + hop];
+    memset(window, 0, (fft.size + hop) * sizeof(int16_t));
+    uint64_t* power = new uint64_t[fft.size / 2 + 1];
+    int edges[GRID_WIDTH + 1];
+    bandEdges(fft.size, wav.sampleRate, edges);
+
+    float shown[GRID_WIDTH];
+    memset(shown, 0, sizeof(shown));
+    float peakDb = 0;
+    if (pConfig->style == AUDIO_BARS)
+        memset(rgbGrid, 0, sizeof(rgbGrid));
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t consumed = 0;
+
+    while (true)
+    {
+        // The newest hop samples go on the end of the window.
+        memmove(window, &window[hop], fft.size * sizeof(int16_t));
+        int got = 0;
+        while (got < hop)
+        {
+            int n = wavRead(&wav, &window[fft.size + got], hop - got);
+            if (n <= 0)
+                break;
+            got += n;
+        }
+        if (got < hop)
+            break;
+        consumed += hop;
+
+        // When the newest sample is heard: now for a pipe, on the audio
+        // clock for a file.
+        struct timespec due;
+        if (wav.pipe)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &due);
+        }
+        else
+        {
+            due = start;
+            addNsec(due, (long)(consumed * 1000000000ull / wav.sampleRate));
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (usecsBetween(due, now) > 0)
+                pStats->lateFrames++;
+            else
+            {
+                uint64_t slept = traceBegin();
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+                traceEnd(TRACE_SLEEP, slept);
+            }
+        }
+
+        struct timespec analysisStart;
+        clock_gettime(CLOCK_MONOTONIC, &analysisStart);
+        uint64_t generated = traceBegin();
+        fftForward(&fft, &window[hop]);
+        fftPower(&fft, power);
+
+        float levels[GRID_WIDTH];
+        float loudest = -1000;
+        for (int band = 0; band < GRID_WIDTH; band++)
+        {
+            uint64_t energy = 0;
+            for (int bin = edges[band]; bin < edges[band + 1]; bin++)
+                energy += power[bin];
+            levels[band] = 10 * log10f((float)energy + 1);
+            if (levels[band] > loudest)
+                loudest = levels[band];
+        }
+        peakDb = loudest > peakDb - PEAK_FALL_DB? loudest : peakDb - PEAK_FALL_DB;
+
+        if (pConfig->style == AUDIO_BARS)
+        {
+            for (int band = 0; band < GRID_WIDTH; band++)
+            {
+                float level = (levels[band] - (peakDb - RANGE_DB)) / RANGE_DB * GRID_HEIGHT;
+                // Bars jump up but fall back gently.
+                shown[band] = level > shown[band] - 0.5f? level : shown[band] - 0.5f;
+                if (shown[band] < 0)
+                    shown[band] = 0;
+                int height = (int)(shown[band] + 0.5f);
+                for (int row = 0; row < GRID_HEIGHT; row++)
+                {
+                    rgbPixel_t& pixel = rgbGrid[row * GRID_WIDTH + band];
+                    if (GRID_HEIGHT - row <= height)
+                        pixel = barColor(row);
+                    else
+                        makeRgbPixel(pixel, 0, 0, 0);
+                }
+            }
+        }
+        else
+        {
+            // Time runs up the grid; the newest spectrum is the bottom row.
+            memmove(rgbGrid, &rgbGrid[GRID_WIDTH], (GRID_AREA - GRID_WIDTH) * sizeof(rgbPixel_t));
+            rgbPixel_t* pRow = &rgbGrid[GRID_AREA - GRID_WIDTH];
+            for (int band = 0; band < GRID_WIDTH; band++)
+            {
+                float level = (levels[band] - (peakDb - RANGE_DB)) / RANGE_DB;
+                level = level < 0? 0 : level > 1? 1 : level;
+                pRow[band] = heatColor(level * level);
+            }
+        }
+
+        struct timespec analysisEnd;
+        clock_gettime(CLOCK_MONOTONIC, &analysisEnd);
+        traceEnd(TRACE_GENERATE, generated);
+        gridTransfer(fd);
+        struct timespec sent;
+        clock_gettime(CLOCK_MONOTONIC, &sent);
+
+        long analysis = usecsBetween(analysisStart, analysisEnd);
+        long latency = usecsBetween(due, sent);
+        pStats->frames++;
+        pStats->analysisUsecs += analysis;
+        if (analysis > pStats->analysisMaxUsecs)
+            pStats->analysisMaxUsecs = analysis;
+        pStats->latencyUsecs += latency;
+        if (latency > pStats->latencyMaxUsecs)
+            pStats->latencyMaxUsecs = latency;
+    }
+
+    delete[] window;
+    delete[] power;
+    wavClose(&wav);
+    fftFree(&fft);
+    return pStats->frames;
+}
@@ -0,0 +1,58 @@
+/*
+* Audio-reactive visualizer for the SPI NEOPixel display
+* By R. Blansett
+*
+* Reads 16-bit PCM from a WAV file, or from a pipe carrying a WAV stream
+* (e.g. arecord -t wav, or sox ... -t wav -), and once per display frame
+* runs a windowed fixed-point FFT (see fft.h) over the latest samples.
+* The spectrum is split into one log-spaced band per column and drawn as
+* bars, or as a spectrogram scrolling up the grid.
+*
+* A file is played against the clock, as if it were being heard from the
+* moment the pattern starts; a pipe is taken as fast as it delivers.
+* Latency is measured from when the newest sample in the window is due
+* (file) or arrives (pipe) until its frame has gone out the SPI device.
+* The FFT window itself adds about half its length on top of that.
+*/
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+
+static const int DEFAULT_FFT_SIZE = 512;
+static const int AUDIO_MIN_FFT_SIZE = 256;     // enough bins for the log bands
+static const int AUDIO_MAX_FFT_SIZE = 1024;    // longer only adds latency
+
+enum audioStyle_t
+{
+    AUDIO_BARS,
+    AUDIO_SPECTROGRAM,
+};
+
+struct audioConfig_t
+{
+    const char* path;           // WAV file, or "-" for stdin
+    int fftSize;                // power of two, AUDIO_MIN_FFT_SIZE to AUDIO_MAX_FFT_SIZE
+    int fps;
+    audioStyle_t style;
+};
+
+struct audioStats_t
+{
+    uint32_t sampleRate;
+    int channels;
+    uint32_t frames;
+    uint32_t lateFrames;        // frames whose audio was due before we could start
+    long analysisUsecs;         // FFT and drawing, total
+    long analysisMaxUsecs;
+    long latencyUsecs;          // total
+    long latencyMaxUsecs;
+};
+
+// Visualize until the audio ends. Returns the number of frames shown, or
+// -1 if the input can't be opened or isn't 16-bit PCM, or the FFT size
+// is out of range (EINVAL).
+int audioRun(int fd, const audioConfig_t* pConfig, audioStats_t* pStats);
+
+#endif // AUDIO_H
@@ -0,0 +1,111 @@
+/*
+* Kernel-paced frame batches for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "trace.h"
+
+static const char* BUFSIZ_PARAM = "/sys/module/spidev/parameters/bufsiz";
+static const uint32_t DEFAULT_BUFSIZ = 4096;
+
+uint32_t spidevBufsiz()
+{
+    uint32_t bufsiz = DEFAULT_BUFSIZ;
+    FILE* pFile = fopen(BUFSIZ_PARAM, "r");
+    if (pFile != NULL)
+    {
+        if (fscanf(pFile, "%u", &bufsiz) != 1 || bufsiz == 0)
+            bufsiz = DEFAULT_BUFSIZ;
+        fclose(pFile);
+    }
+    return bufsiz;
+}
+
+bool batchInit(frameBatch_t* pBatch, uint32_t frameSize, int fps,
+    int latencyMs, uint32_t speedHz)
+{
+    memset(pBatch, 0, sizeof(*pBatch));
+    pBatch->frameSize = frameSize;
+    pBatch->bufsiz = spidevBufsiz();
+    if (fps < 1)
+        fps = 1;
+
+    // Time left in each frame period once the frame has been clocked out.
+    uint32_t periodUsecs = 1000000 / fps;
+    pBatch->periodNs = 1000000000u / fps;
+    uint32_t wireUsecs = (uint32_t)((uint64_t)frameSize * 8 * 1000000 / speedHz);
+    pBatch->gapUsecs = periodUsecs > wireUsecs? periodUsecs - wireUsecs : 0;
+
+    // libspiled turns an unchanged frame into idle time of its whole
+    // period, which may take one more delay transfer than the gap alone.
+    pBatch->transfersPerFrame = batchTransfersPerFrame(wireUsecs + pBatch->gapUsecs);
+
+    // Smallest of: what spidev accepts in one message, what the latency
+    // budget allows, and what the ioctl can describe.
+    int capacity = pBatch->bufsiz / frameSize;
+    int latencyFrames = latencyMs * fps / 1000;
+    if (capacity > latencyFrames)
+        capacity = latencyFrames;
+    if (capacity > MAX_TRANSFERS / pBatch->transfersPerFrame)
+        capacity = MAX_TRANSFERS / pBatch->transfersPerFrame;
+    if (capacity < 1)
+        capacity = 1;
+    pBatch->capacity = capacity;
+
+    pBatch->frames = (uint8_t*)malloc((size_t)capacity * frameSize);
+    return pBatch->frames != NULL;
+}
+
+void batchFree(frameBatch_t* pBatch)
+{
+    free(pBatch->frames);
+    pBatch->frames = NULL;
+}
+
+bool batchPush(frameBatch_t* pBatch, spiled_t* pLed, const uint8_t* wire)
+{
+    memcpy(&pBatch->frames[pBatch->count * pBatch->frameSize], wire,
+        pBatch->frameSize);
+    pBatch->count++;
+
+    if (pBatch->count == pBatch->capacity)
+        return batchFlush(pBatch, pLed);
+    return true;
+}
+
+bool batchFlush(frameBatch_t* pBatch, spiled_t* pLed)
+{
+    if (pBatch->count == 0)
+        return true;
+
+    if (pBatch->pRecorder != NULL)
+    {
+        // The kernel spaces the frames out a period apart.
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        uint64_t start = t.tv_sec * 1000000000ull + t.tv_nsec;
+        for (int i = 0; i < pBatch->count; i++)
+            recordFrame(pBatch->pRecorder, &pBatch->frames[i * pBatch->frameSize],
+                pBatch->frameSize, start + (uint64_t)i * pBatch->periodNs);
+    }
+
+    uint64_t sent = traceBegin();
+    int ret = spiledWriteBatch(pLed, pBatch->frames, pBatch->frameSize, pBatch->count,
+        pBatch->gapUsecs);
+    traceEnd(TRACE_TRANSFER, sent);
+
+    if (ret >= 0)
+    {
+        pBatch->framesSent += ret;
+        pBatch->framesSuppressed += pBatch->count - ret;
+    }
+    pBatch->batches++;
+    pBatch->count = 0;
+    return ret >= 0;
+}
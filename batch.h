@@ -0,0 +1,73 @@
+/*
+* Kernel-paced frame batches for the SPI NEOPixel display
+* By R. Blansett
+*
+* Queues several wire images into one SPI_IOC_MESSAGE(n) call, sent by
+* spiledWriteBatch(). Each frame's transfer carries a delay_usecs that
+* holds the inter-frame gap inside the kernel, so a pre-computed sequence
+* costs one syscall and one wakeup per batch instead of per frame.
+*
+* spidev refuses a message whose total length exceeds its bufsiz module
+* parameter (4096 by default, too small for more than one 16x16 frame;
+* boot with spidev.bufsiz=65536 to batch), and a batch adds up to its
+* length in latency, so the batch size is the smaller of the two limits.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include <linux/spi/spidev.h>
+
+#include "libspiled.h"
+#include "record.h"
+
+// delay_usecs is 16 bits; longer gaps are split over extra transfers.
+static const uint32_t MAX_DELAY_USECS = 0xFFFF;
+
+// The ioctl number only has room for this many transfers.
+static const int MAX_TRANSFERS =
+    ((1 << _IOC_SIZEBITS) - 1) / sizeof(struct spi_ioc_transfer);
+
+// Most transfers one frame can take: its data, then delay-only transfers
+// for the rest of periodUsecs (a suppressed frame idles the whole period).
+static inline int batchTransfersPerFrame(uint32_t periodUsecs)
+{
+    return 1 + periodUsecs / MAX_DELAY_USECS;
+}
+
+struct frameBatch_t
+{
+    uint8_t* frames;            // capacity wire images, back to back
+    uint32_t frameSize;
+    int capacity;               // frames per SPI_IOC_MESSAGE
+    int count;                  // frames queued so far
+    int transfersPerFrame;      // most each frame may need (see libspiled.h)
+    uint32_t gapUsecs;          // idle time after each frame
+    uint32_t bufsiz;            // spidev's per-message limit
+    uint32_t periodNs;          // one frame period
+    recorder_t* pRecorder;      // if set, gets each frame as it goes out
+
+    long batches;               // ioctl calls made
+    long framesSent;
+    long framesSuppressed;      // unchanged, sent as idle time instead
+};
+
+// spidev's bufsiz module parameter, or its default if it can't be read.
+uint32_t spidevBufsiz();
+
+// Size the batch for frameSize byte frames shown at fps, with at most
+// latencyMs of frames queued ahead. Returns false if out of memory.
+bool batchInit(frameBatch_t* pBatch, uint32_t frameSize, int fps,
+    int latencyMs, uint32_t speedHz);
+void batchFree(frameBatch_t* pBatch);
+
+// Copy one wire image into the batch; sends the batch once it is full.
+bool batchPush(frameBatch_t* pBatch, spiled_t* pLed, const uint8_t* wire);
+
+// Send whatever is queued.
+bool batchFlush(frameBatch_t* pBatch, spiled_t* pLed);
+
+#endif // BATCH_H
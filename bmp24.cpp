@@ -0,0 +1,111 @@
+/*
+* 24-bit BMP image loader
+* By R. Blansett
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spiled.h"
+#include "bmp24.h"
+#include "arena.h"
+
+// Big enough for a whole wall; anything larger is a corrupt header.
+static const int MAX_DIMENSION = 8192;
+
+bool readBMP(const char* filename, arena_t* pArena, bmp24_t* pBmp)
+{
+    memset(pBmp, 0, sizeof(*pBmp));
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL)
+        return false;
+
+    unsigned char info[54];
+    if (fread(info, sizeof(unsigned char), 54, f) != 54 ||   // read the 54-byte header
+        info[0] != 'B' || info[1] != 'M' ||
+        *(uint16_t*)&info[28] != 24 ||                      // bits per pixel
+        *(uint32_t*)&info[30] != 0)                         // uncompressed
+    {
+        fclose(f);
+        return false;
+    }
+
+    // extract image height and width from header
+    uint32_t offset = *(uint32_t*)&info[10];
+    int width = *(int32_t*)&info[18];
+    int height = *(int32_t*)&info[22];
+    int rows = height < 0? -height : height;
+    if (width <= 0 || width > MAX_DIMENSION || rows == 0 || rows > MAX_DIMENSION ||
+        fseek(f, offset, SEEK_SET) != 0)
+    {
+        fclose(f);
+        return false;
+    }
+
+    size_t mark = arenaMark(pArena);
+    size_t rowBytes = 3 * width;
+    long padding = (4 - rowBytes % 4) % 4;      // rows are stored 4-byte aligned
+    unsigned char* data = (unsigned char*)arenaAlloc(pArena, rowBytes * rows);
+    bool ok = data != NULL;
+    for (int row = 0; ok && row < rows; row++)
+    {
+        unsigned char* pRow = data + row * rowBytes;
+        ok = fread(pRow, 1, rowBytes, f) == rowBytes &&
+            (padding == 0 || fseek(f, padding, SEEK_CUR) == 0);
+        for (size_t i = 0; i < rowBytes; i += 3)
+        {
+            // Swap the Red & Blue color positions:
+            unsigned char tmp = pRow[i];
+            pRow[i] = pRow[i+2];
+            pRow[i+2] = tmp;
+        }
+    }
+    fclose(f);
+
+    if (!ok)
+    {
+        arenaRelease(pArena, mark);
+        return false;
+    }
+    pBmp->m_width = width;
+    pBmp->m_height = height;
+    pBmp->m_data = data;
+    return true;
+}
+
+bool bmpToGrid(const bmp24_t* pBmp, rgbPixel_t* frame)
+{
+    if (pBmp == NULL || pBmp->m_data == NULL)
+        return false;
+
+    // A positive height means the rows are stored bottom-up.
+    int width = pBmp->m_width;
+    int height = pBmp->m_height < 0? -pBmp->m_height : pBmp->m_height;
+    bool bottomUp = pBmp->m_height > 0;
+
+    memset(frame, 0, GRID_AREA * sizeof(rgbPixel_t));
+    for (int row = 0; row < GRID_HEIGHT && row < height; row++)
+    {
+        int srcRow = bottomUp? height - 1 - row : row;
+        const unsigned char* pSrc = pBmp->m_data + srcRow * width * 3;
+        for (int col = 0; col < GRID_WIDTH && col < width; col++)
+        {
+            // Same 8-bit to 6-bit scaling as the built-in images.
+            makeRgbPixel(frame[row * GRID_WIDTH + col],
+                pSrc[0] >> 2, pSrc[1] >> 2, pSrc[2] >> 2);
+            pSrc += 3;
+        }
+    }
+    return true;
+}
+
+bool bmpLoadFrame(const char* filename, arena_t* pArena, rgbPixel_t* frame)
+{
+    size_t mark = arenaMark(pArena);
+    bmp24_t bmp;
+    bool ok = readBMP(filename, pArena, &bmp) && bmpToGrid(&bmp, frame);
+    arenaRelease(pArena, mark);
+    return ok;
+}
@@ -0,0 +1,35 @@
+/*
+* 24-bit BMP image loader
+* By R. Blansett
+*/
+
+#ifndef BMP24_H
+#define BMP24_H
+
+#include <stddef.h>
+
+struct rgbPixel_t;
+
+struct arena_t;
+
+// Pixel data lives in the arena it was read into; there's nothing to free.
+struct bmp24_t
+{
+    int m_width;
+    int m_height;               // negative if the rows are stored top-down
+    unsigned char *m_data;
+};
+
+// Read a 24-bit uncompressed BMP into pArena (RGB ordered data, rows
+// unpadded). Returns false, with the arena unchanged, if the file can't
+// be read, isn't a 24-bit BMP, or doesn't fit in what's left of pArena.
+bool readBMP(const char* filename, arena_t* pArena, bmp24_t* pBmp);
+
+// Scale a loaded BMP into a grid-sized rgbPixel_t frame (top row first).
+// Pixels outside the image are left black. Returns false if bmp has no data.
+bool bmpToGrid(const bmp24_t* pBmp, rgbPixel_t* frame);
+
+// readBMP() then bmpToGrid(), releasing the pixel data from pArena after.
+bool bmpLoadFrame(const char* filename, arena_t* pArena, rgbPixel_t* frame);
+
+#endif // BMP24_H
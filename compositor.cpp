@@ -0,0 +1,130 @@
+/*
+* Alpha-blended layer compositor for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <string.h>
+
+#include "spiled.h"
+#include "compositor.h"
+
+static_assert(sizeof(rgbPixel_t) == 4, "blend kernel expects packed RGBA");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "blend kernel expects r in the low byte");
+
+// Whole-pixel access to rgbPixel_t rows without breaking strict aliasing.
+typedef uint32_t __attribute__((may_alias)) pixelWord_t;
+static_assert(GRID_HEIGHT <= 64, "row masks are 64 bits");
+
+void compositorInit(compositor_t* pComp, int count)
+{
+    memset(pComp, 0, sizeof(*pComp));
+    pComp->count = count < 1? 1 : count > MAX_LAYERS? MAX_LAYERS : count;
+    for (int i = 0; i < pComp->count; i++)
+    {
+        pComp->layers[i].enabled = true;
+        pComp->layers[i].dirtyRows = ALL_ROWS;
+    }
+}
+
+void compositorEnable(compositor_t* pComp, int index, bool enabled)
+{
+    if (pComp->layers[index].enabled != enabled)
+    {
+        pComp->layers[index].enabled = enabled;
+        pComp->layers[index].dirtyRows = ALL_ROWS;
+    }
+}
+
+// dst = src over dst for one row, two channels per multiply (r/b, then g).
+// x/255 is done as (x + 128 + ((x + 128) >> 8)) >> 8, exact for x <= 255*255.
+static void blendRow(pixelWord_t* pDst, const pixelWord_t* pBelow,
+    const pixelWord_t* pSrc, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t s = pSrc[i];
+        uint32_t d = pBelow[i];
+        uint32_t a = s >> 24;
+
+        if (a == 0)
+        {
+            pDst[i] = d;
+        }
+        else if (a == 255)
+        {
+            pDst[i] = (s & 0x00FFFFFF) | (d & 0xFF000000);
+        }
+        else
+        {
+            uint32_t na = 255 - a;
+            uint32_t rb = (s & 0x00FF00FF) * a + (d & 0x00FF00FF) * na + 0x00800080;
+            rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+            uint32_t g = ((s >> 8) & 0xFF) * a + ((d >> 8) & 0xFF) * na + 0x80;
+            g = ((g + (g >> 8)) >> 8) & 0xFF;
+            pDst[i] = rb | (g << 8) | (d & 0xFF000000);
+        }
+    }
+}
+
+void compositorBlendRow(rgbPixel_t* out, const rgbPixel_t* below,
+    const rgbPixel_t* src, int count)
+{
+    blendRow((pixelWord_t*)out, (const pixelWord_t*)below,
+        (const pixelWord_t*)src, count);
+}
+
+rowMask_t compositorRender(compositor_t* pComp, rgbPixel_t* out)
+{
+    // Rows that changed in the flattened result so far.
+    rowMask_t changed = 0;
+
+    for (int i = 0; i < pComp->count; i++)
+    {
+        layer_t* pLayer = &pComp->layers[i];
+        changed |= pLayer->dirtyRows;
+        pLayer->dirtyRows = 0;
+
+        for (int row = 0; row < GRID_HEIGHT; row++)
+        {
+            if (!(changed & ((rowMask_t)1 << row)))
+            {
+                pComp->rowsSkipped++;
+                continue;
+            }
+
+            int offset = row * GRID_WIDTH;
+            pixelWord_t* pDst = (pixelWord_t*)&pComp->blended[i][offset];
+            const pixelWord_t* pSrc = (const pixelWord_t*)&pLayer->pixels[offset];
+
+            if (i == 0)
+            {
+                // The background is opaque whatever its alpha says.
+                if (pLayer->enabled)
+                    memcpy(pDst, pSrc, GRID_WIDTH * sizeof(pixelWord_t));
+                else
+                    memset(pDst, 0, GRID_WIDTH * sizeof(pixelWord_t));
+            }
+            else
+            {
+                const pixelWord_t* pBelow = (const pixelWord_t*)&pComp->blended[i - 1][offset];
+                if (pLayer->enabled)
+                    blendRow(pDst, pBelow, pSrc, GRID_WIDTH);
+                else
+                    memcpy(pDst, pBelow, GRID_WIDTH * sizeof(pixelWord_t));
+            }
+            pComp->rowsBlended++;
+        }
+    }
+
+    const rgbPixel_t* pTop = pComp->blended[pComp->count - 1];
+    for (int row = 0; row < GRID_HEIGHT; row++)
+    {
+        if (changed & ((rowMask_t)1 << row))
+        {
+            memcpy(&out[row * GRID_WIDTH], &pTop[row * GRID_WIDTH],
+                GRID_WIDTH * sizeof(rgbPixel_t));
+        }
+    }
+
+    return changed;
+}
@@ -0,0 +1,82 @@
+/*
+* Alpha-blended layer compositor for the SPI NEOPixel display
+* By R. Blansett
+*
+* Layers are grid-sized rgbPixel_t frames stacked bottom to top. Layer 0
+* is the background and is always opaque; on the layers above it the
+* pixel's a channel is its coverage (0 = transparent, 255 = opaque).
+*
+* The compositor keeps the blended result after every layer, and each
+* layer tracks which rows were touched since the last render. Rendering
+* only re-blends the touched rows, starting at the lowest touched layer,
+* so static layers (and untouched rows of moving ones) cost nothing.
+*/
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+static const int MAX_LAYERS = 8;
+
+struct layer_t
+{
+    rgbPixel_t pixels[GRID_AREA];
+    rowMask_t dirtyRows;
+    bool enabled;
+};
+
+struct compositor_t
+{
+    layer_t layers[MAX_LAYERS];
+    rgbPixel_t blended[MAX_LAYERS][GRID_AREA];  // layers 0..i flattened
+    int count;
+
+    uint32_t rowsBlended;       // stats: layer rows actually blended
+    uint32_t rowsSkipped;       // stats: layer rows reused from cache
+};
+
+static inline rgbPixel_t&
+    makeRgbaPixel(rgbPixel_t& pixel, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    makeRgbPixel(pixel, r, g, b);
+    pixel.a = a;
+
+    return pixel;
+}
+
+// Start with count empty (transparent, enabled) layers.
+void compositorInit(compositor_t* pComp, int count);
+
+// Writable pixels of a layer. The caller must mark what it changed.
+static inline rgbPixel_t* compositorLayer(compositor_t* pComp, int index)
+{
+    return pComp->layers[index].pixels;
+}
+
+static inline void compositorMarkRows(compositor_t* pComp, int index,
+    int firstRow, int rowCount)
+{
+    rowMask_t rows = rowCount >= 64? ~(rowMask_t)0 :
+        (((rowMask_t)1 << rowCount) - 1);
+    pComp->layers[index].dirtyRows |= (rows << firstRow) & ALL_ROWS;
+}
+
+static inline void compositorMarkDirty(compositor_t* pComp, int index)
+{
+    pComp->layers[index].dirtyRows = ALL_ROWS;
+}
+
+void compositorEnable(compositor_t* pComp, int index, bool enabled);
+
+// out = src over below for count pixels (out may alias below).
+void compositorBlendRow(rgbPixel_t* out, const rgbPixel_t* below,
+    const rgbPixel_t* src, int count);
+
+// Blend the changed rows into out (grid-sized). Returns the mask of rows
+// that changed in out; 0 means out is already up to date.
+rowMask_t compositorRender(compositor_t* pComp, rgbPixel_t* out);
+
+#endif // COMPOSITOR_H
@@ -0,0 +1,105 @@
+/*
+* E1.31 (sACN) and Art-Net packet layout
+* By R. Blansett
+*
+* Shared by the spiled DMX receiver and the dmxsend test sender.
+* Only the packets we need are described: E1.31 data + universe sync,
+* and Art-Net ArtDmx + ArtSync.
+*/
+
+#ifndef DMX_H
+#define DMX_H
+
+#include <stdint.h>
+#include <string.h>
+
+static const uint16_t E131_PORT = 5568;
+static const uint16_t ARTNET_PORT = 6454;
+
+static const int DMX_CHANNELS = 512;
+static const int DMX_PIXELS_PER_UNIVERSE = 170;  // 510 channels of RGB
+
+// E1.31 root layer
+static const uint8_t E131_ACN_ID[12] = {
+    'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+static const uint32_t E131_VECTOR_ROOT_DATA = 0x00000004;
+static const uint32_t E131_VECTOR_ROOT_EXTENDED = 0x00000008;
+static const uint32_t E131_VECTOR_DATA_PACKET = 0x00000002;
+static const uint32_t E131_VECTOR_EXTENDED_SYNC = 0x00000001;
+static const uint8_t E131_VECTOR_DMP_SET_PROPERTY = 0x02;
+
+// E1.31 data packet byte offsets
+static const int E131_ROOT_VECTOR = 18;
+static const int E131_CID = 22;
+static const int E131_FRAMING_FLAGS = 38;
+static const int E131_FRAMING_VECTOR = 40;
+static const int E131_SOURCE_NAME = 44;
+static const int E131_PRIORITY = 108;
+static const int E131_SYNC_ADDRESS = 109;
+static const int E131_SEQUENCE = 111;
+static const int E131_OPTIONS = 112;
+static const int E131_UNIVERSE = 113;
+static const int E131_DMP_FLAGS = 115;
+static const int E131_DMP_VECTOR = 117;
+static const int E131_PROPERTY_COUNT = 123;
+static const int E131_START_CODE = 125;
+static const int E131_DATA = 126;
+static const int E131_DATA_MAX_SIZE = E131_DATA + DMX_CHANNELS;
+
+// E1.31 universe sync packet byte offsets
+static const int E131_SYNC_SEQUENCE = 44;
+static const int E131_SYNC_UNIVERSE = 45;
+static const int E131_SYNC_SIZE = 49;
+
+static const uint8_t E131_OPT_PREVIEW = 0x80;
+static const uint8_t E131_OPT_TERMINATED = 0x40;
+
+// Art-Net
+static const uint8_t ARTNET_ID[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0 };
+static const uint16_t ARTNET_OP_DMX = 0x5000;
+static const uint16_t ARTNET_OP_SYNC = 0x5200;
+static const uint8_t ARTNET_PROTOCOL_VERSION = 14;
+
+static const int ARTNET_OPCODE = 8;     // little endian
+static const int ARTNET_VERSION = 10;   // big endian
+static const int ARTNET_SEQUENCE = 12;
+static const int ARTNET_SUBUNI = 14;    // low byte of the port address
+static const int ARTNET_NET = 15;       // high 7 bits of the port address
+static const int ARTNET_LENGTH = 16;    // big endian
+static const int ARTNET_DATA = 18;
+static const int ARTNET_DATA_MAX_SIZE = ARTNET_DATA + DMX_CHANNELS;
+static const int ARTNET_SYNC_SIZE = 14;
+
+static const int DMX_PACKET_MAX_SIZE = E131_DATA_MAX_SIZE;
+
+static inline uint16_t dmxGet16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t dmxGet32(const uint8_t* p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline void dmxPut16(uint8_t* p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static inline void dmxPut32(uint8_t* p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+// The first universe that falls on a multicast group is 1 (239.255.0.1).
+static inline uint32_t e131MulticastGroup(uint16_t universe)
+{
+    return 0xEFFF0000u | universe;
+}
+
+#endif // DMX_H
@@ -0,0 +1,379 @@
+/*
+* E1.31 (sACN) / Art-Net receiver for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "spiled.h"
+#include "dmx.h"
+#include "dmxrecv.h"
+
+// Datagrams pulled from the socket per recvmmsg() call.
+static const int DMX_BATCH = 32;
+
+// Art-Net nodes fall back to unsynchronized output after this long
+// without an ArtSync; E1.31 sources that stop sending syncs are treated
+// the same way.
+static const int SYNC_TIMEOUT_SEC = 4;
+
+// Packets older than this (by sequence number) are dropped, per E1.31.
+static const int SEQUENCE_WINDOW = 20;
+
+static const int MAX_UNIVERSES = 64;
+
+struct dmxState_t
+{
+    int fd;
+    int sock;
+    const dmxConfig_t* pConfig;
+    dmxStats_t* pStats;
+
+    int universeCount;
+    uint64_t allMask;
+    uint64_t receivedMask;      // universes decoded into rgbGrid so far
+    bool pendingSync;           // sync arrived before the frame completed
+    uint16_t e131SyncAddress;   // 0 = sources aren't using sync
+    uint16_t joinedSyncAddress; // sync universe whose group we're in
+    time_t lastE131Sync;
+    time_t lastArtSync;
+    uint8_t lastSequence[MAX_UNIVERSES];
+    bool haveSequence[MAX_UNIVERSES];
+    uint64_t terminatedMask;
+};
+
+int dmxUniverseCount()
+{
+    return (GRID_AREA + DMX_PIXELS_PER_UNIVERSE - 1) / DMX_PIXELS_PER_UNIVERSE;
+}
+
+static void presentFrame(dmxState_t* pState)
+{
+    const dmxConfig_t* pConfig = pState->pConfig;
+    if (pConfig->pQueue != NULL)
+        presentSubmit(pConfig->pQueue, rgbGrid, presentNow() + pConfig->delayNs);
+    else
+        gridTransfer(pState->fd);
+    pState->pStats->frames++;
+    pState->receivedMask = 0;
+    pState->pendingSync = false;
+}
+
+static bool inSequence(dmxState_t* pState, int index, uint8_t sequence)
+{
+    if (pState->haveSequence[index])
+    {
+        int8_t diff = (int8_t)(sequence - pState->lastSequence[index]);
+        if (diff <= 0 && diff > -SEQUENCE_WINDOW)
+        {
+            pState->pStats->outOfSequence++;
+            return false;
+        }
+    }
+    pState->haveSequence[index] = true;
+    pState->lastSequence[index] = sequence;
+    return true;
+}
+
+// Decode one universe worth of channels straight into rgbGrid.
+static void decodeUniverse(dmxState_t* pState, int index,
+    const uint8_t* pData, int channels, bool synchronized)
+{
+    int base = index * DMX_PIXELS_PER_UNIVERSE;
+    int pixels = channels / 3;
+    if (pixels > DMX_PIXELS_PER_UNIVERSE)
+        pixels = DMX_PIXELS_PER_UNIVERSE;
+    if (pixels > GRID_AREA - base)
+        pixels = GRID_AREA - base;
+
+    rgbPixel_t* pPixel = &rgbGrid[base];
+    for (int i = 0; i < pixels; i++)
+    {
+        // Same 8-bit to 6-bit scaling as the images.
+        makeRgbPixel(*pPixel++, pData[0] >> 2, pData[1] >> 2, pData[2] >> 2);
+        pData += 3;
+    }
+
+    pState->receivedMask |= 1ull << index;
+    if (pState->receivedMask == pState->allMask &&
+        (!synchronized || pState->pendingSync))
+    {
+        presentFrame(pState);
+    }
+}
+
+static int universeIndex(dmxState_t* pState, uint16_t universe)
+{
+    int index = (int)universe - pState->pConfig->firstUniverse;
+    if (index < 0 || index >= pState->universeCount)
+        return -1;
+    return index;
+}
+
+static void handleSync(dmxState_t* pState)
+{
+    pState->pStats->syncs++;
+    if (pState->receivedMask == 0)
+    {
+        // Nothing new since the last frame went out.
+        return;
+    }
+    if (pState->receivedMask == pState->allMask)
+    {
+        presentFrame(pState);
+    }
+    else
+    {
+        // Present as soon as the stragglers arrive.
+        pState->pStats->earlySyncs++;
+        pState->pendingSync = true;
+    }
+}
+
+// Join universe's sACN multicast group on sock.
+static bool joinGroup(int sock, uint16_t universe)
+{
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = htonl(e131MulticastGroup(universe));
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    return setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0;
+}
+
+static void handleE131(dmxState_t* pState, const uint8_t* p, int len)
+{
+    uint32_t rootVector = dmxGet32(&p[E131_ROOT_VECTOR]);
+
+    if (rootVector == E131_VECTOR_ROOT_EXTENDED)
+    {
+        if (len < E131_SYNC_SIZE ||
+            dmxGet32(&p[E131_FRAMING_VECTOR]) != E131_VECTOR_EXTENDED_SYNC)
+        {
+            pState->pStats->ignored++;
+            return;
+        }
+        if (pState->e131SyncAddress != 0 &&
+            dmxGet16(&p[E131_SYNC_UNIVERSE]) == pState->e131SyncAddress)
+        {
+            pState->lastE131Sync = time(NULL);
+            handleSync(pState);
+        }
+        else
+        {
+            pState->pStats->ignored++;
+        }
+        return;
+    }
+
+    if (rootVector != E131_VECTOR_ROOT_DATA || len < E131_DATA ||
+        dmxGet32(&p[E131_FRAMING_VECTOR]) != E131_VECTOR_DATA_PACKET ||
+        p[E131_DMP_VECTOR] != E131_VECTOR_DMP_SET_PROPERTY)
+    {
+        pState->pStats->badPackets++;
+        return;
+    }
+
+    int channels = dmxGet16(&p[E131_PROPERTY_COUNT]) - 1;
+    if (channels < 0 || channels > DMX_CHANNELS || E131_DATA + channels > len)
+    {
+        pState->pStats->badPackets++;
+        return;
+    }
+
+    int index = universeIndex(pState, dmxGet16(&p[E131_UNIVERSE]));
+    uint8_t options = p[E131_OPTIONS];
+    if (index < 0 || p[E131_START_CODE] != 0 || (options & E131_OPT_PREVIEW))
+    {
+        pState->pStats->ignored++;
+        return;
+    }
+    if (!inSequence(pState, index, p[E131_SEQUENCE]))
+        return;
+
+    if (options & E131_OPT_TERMINATED)
+    {
+        pState->terminatedMask |= 1ull << index;
+        return;
+    }
+
+    pState->e131SyncAddress = dmxGet16(&p[E131_SYNC_ADDRESS]);
+    if (pState->e131SyncAddress != 0 &&
+        pState->e131SyncAddress != pState->joinedSyncAddress)
+    {
+        // Syncs go to their own universe's group, which may not be one of ours.
+        if (universeIndex(pState, pState->e131SyncAddress) < 0)
+            joinGroup(pState->sock, pState->e131SyncAddress);
+        pState->joinedSyncAddress = pState->e131SyncAddress;
+    }
+
+    bool synchronized = pState->e131SyncAddress != 0 && pState->lastE131Sync != 0 &&
+        time(NULL) - pState->lastE131Sync < SYNC_TIMEOUT_SEC;
+    decodeUniverse(pState, index, &p[E131_DATA], channels, synchronized);
+}
+
+static void handleArtNet(dmxState_t* pState, const uint8_t* p, int len)
+{
+    uint16_t opcode = p[ARTNET_OPCODE] | p[ARTNET_OPCODE + 1] << 8;
+
+    if (opcode == ARTNET_OP_SYNC)
+    {
+        pState->lastArtSync = time(NULL);
+        handleSync(pState);
+        return;
+    }
+    if (opcode != ARTNET_OP_DMX || len < ARTNET_DATA)
+    {
+        pState->pStats->ignored++;
+        return;
+    }
+
+    int channels = dmxGet16(&p[ARTNET_LENGTH]);
+    if (channels > DMX_CHANNELS || ARTNET_DATA + channels > len)
+    {
+        pState->pStats->badPackets++;
+        return;
+    }
+
+    uint16_t portAddress = (p[ARTNET_NET] & 0x7F) << 8 | p[ARTNET_SUBUNI];
+    int index = universeIndex(pState, portAddress);
+    if (index < 0)
+    {
+        pState->pStats->ignored++;
+        return;
+    }
+    // Sequence 0 means the sender doesn't number its packets.
+    if (p[ARTNET_SEQUENCE] != 0 && !inSequence(pState, index, p[ARTNET_SEQUENCE]))
+        return;
+
+    bool synchronized = pState->lastArtSync != 0 &&
+        time(NULL) - pState->lastArtSync < SYNC_TIMEOUT_SEC;
+    decodeUniverse(pState, index, &p[ARTNET_DATA], channels, synchronized);
+}
+
+static void handlePacket(dmxState_t* pState, const uint8_t* p, int len)
+{
+    pState->pStats->packets++;
+
+    if (len >= E131_SYNC_SIZE && dmxGet16(&p[0]) == 0x0010 &&
+        memcmp(&p[4], E131_ACN_ID, sizeof(E131_ACN_ID)) == 0)
+    {
+        handleE131(pState, p, len);
+    }
+    else if (len >= ARTNET_SYNC_SIZE &&
+        memcmp(&p[0], ARTNET_ID, sizeof(ARTNET_ID)) == 0)
+    {
+        handleArtNet(pState, p, len);
+    }
+    else
+    {
+        pState->pStats->badPackets++;
+    }
+}
+
+static int openSocket(const dmxConfig_t* pConfig, int universeCount)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+        return -1;
+
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    // Room for a few frames of every universe arriving in a burst.
+    int rcvbuf = 1 << 20;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(pConfig->port != 0? pConfig->port :
+        pConfig->artnet? ARTNET_PORT : E131_PORT);
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        close(sock);
+        return -1;
+    }
+
+    if (!pConfig->artnet)
+    {
+        // sACN sources normally multicast; unicast works either way.
+        for (int i = 0; i < universeCount; i++)
+        {
+            if (!joinGroup(sock, pConfig->firstUniverse + i))
+            {
+                perror("can't join sACN multicast group (unicast only)");
+                break;
+            }
+        }
+    }
+
+    return sock;
+}
+
+int dmxReceiveRun(int fd, const dmxConfig_t* pConfig, dmxStats_t* pStats)
+{
+    dmxState_t state;
+    memset(&state, 0, sizeof(state));
+    memset(pStats, 0, sizeof(*pStats));
+    state.fd = fd;
+    state.pConfig = pConfig;
+    state.pStats = pStats;
+    state.universeCount = dmxUniverseCount();
+    if (state.universeCount > MAX_UNIVERSES)
+        state.universeCount = MAX_UNIVERSES;
+    state.allMask = state.universeCount == 64? ~0ull :
+        (1ull << state.universeCount) - 1;
+
+    int sock = openSocket(pConfig, state.universeCount);
+    if (sock < 0)
+        return -1;
+    state.sock = sock;
+
+    static uint8_t packets[DMX_BATCH][DMX_PACKET_MAX_SIZE];
+    struct iovec iovs[DMX_BATCH];
+    struct mmsghdr msgs[DMX_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < DMX_BATCH; i++)
+    {
+        iovs[i].iov_base = packets[i];
+        iovs[i].iov_len = sizeof(packets[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int ret = 0;
+    while (pConfig->frameLimit == 0 || pStats->frames < pConfig->frameLimit)
+    {
+        // Block for the first datagram, then take whatever else is queued.
+        int count = recvmmsg(sock, msgs, DMX_BATCH, MSG_WAITFORONE, NULL);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ret = -1;
+            break;
+        }
+        pStats->batches++;
+
+        for (int i = 0; i < count; i++)
+        {
+            handlePacket(&state, packets[i], msgs[i].msg_len);
+            if (pConfig->frameLimit != 0 && pStats->frames >= pConfig->frameLimit)
+                break;
+        }
+
+        if (state.terminatedMask == state.allMask)
+            break;
+    }
+
+    close(sock);
+    return ret;
+}
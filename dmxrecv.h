@@ -0,0 +1,51 @@
+/*
+* E1.31 (sACN) / Art-Net receiver for the SPI NEOPixel display
+* By R. Blansett
+*
+* Maps consecutive DMX universes onto rgbGrid (170 RGB pixels per
+* universe, row-major) and presents a frame once every universe of it
+* has arrived, honouring E1.31 universe sync and ArtSync.
+*
+* Neither protocol timestamps its frames, so with a presentation queue
+* (see present.h) each complete frame is due a fixed delay after it
+* arrives: network jitter up to that delay is smoothed out, at the cost
+* of that much latency.
+*/
+
+#ifndef DMXRECV_H
+#define DMXRECV_H
+
+#include <stdint.h>
+
+#include "present.h"
+
+struct dmxConfig_t
+{
+    bool artnet;                // listen on the Art-Net port (else E1.31)
+    uint16_t port;              // 0 = the protocol's default port
+    uint16_t firstUniverse;     // universe holding pixel 0
+    uint32_t frameLimit;        // stop after this many frames (0 = never)
+    presentQueue_t* pQueue;     // present through this queue, or NULL
+    int64_t delayNs;            // ... this long after arrival
+};
+
+struct dmxStats_t
+{
+    uint32_t batches;           // recvmmsg() calls that returned data
+    uint32_t packets;           // datagrams received
+    uint32_t frames;            // frames presented
+    uint32_t syncs;             // sync packets received
+    uint32_t earlySyncs;        // syncs that arrived before all universes
+    uint32_t badPackets;        // malformed or unknown datagrams
+    uint32_t ignored;           // other universes, preview data, ...
+    uint32_t outOfSequence;     // dropped as older than the last one seen
+};
+
+// Number of universes needed to cover the grid.
+int dmxUniverseCount();
+
+// Receive until frameLimit frames have been presented or every E1.31
+// source has terminated its stream. Returns 0, or -1 on socket errors.
+int dmxReceiveRun(int fd, const dmxConfig_t* pConfig, dmxStats_t* pStats);
+
+#endif // DMXRECV_H
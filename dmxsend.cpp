@@ -0,0 +1,313 @@
+/*
+* E1.31 (sACN) / Art-Net test sender
+* By R. Blansett
+*
+* Streams a moving color pattern over a number of universes, followed by
+* a universe sync (or ArtSync) per frame. All packets of a frame go out in
+* one sendmmsg() call. Handy for exercising spiled's DMX receiver over
+* loopback without any lighting console.
+*/
+
+#include <stdint.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "dmx.h"
+#include "timing.h"
+
+static const char *host = "127.0.0.1";
+static uint16_t port = 0;
+static bool artnet = false;
+static bool useSync = true;
+static uint16_t firstUniverse = 1;
+static int universes = 2;
+static int frameRate = 40;
+static int frameCount = 200;
+
+static const int MAX_UNIVERSES = 64;
+
+static void pabort(const char *s)
+{
+    perror(s);
+    abort();
+}
+
+static int buildE131Data(uint8_t* p, uint16_t universe, uint8_t sequence,
+    uint8_t options, const uint8_t* pData)
+{
+    static const uint8_t CID[16] = {
+        's', 'p', 'i', 'l', 'e', 'd', '-', 'd', 'm', 'x', 's', 'e', 'n', 'd', 0, 1 };
+    const int len = E131_DATA_MAX_SIZE;
+
+    memset(p, 0, len);
+    dmxPut16(&p[0], 0x0010);
+    memcpy(&p[4], E131_ACN_ID, sizeof(E131_ACN_ID));
+    dmxPut16(&p[16], 0x7000 | (len - 16));
+    dmxPut32(&p[E131_ROOT_VECTOR], E131_VECTOR_ROOT_DATA);
+    memcpy(&p[E131_CID], CID, sizeof(CID));
+
+    dmxPut16(&p[E131_FRAMING_FLAGS], 0x7000 | (len - E131_FRAMING_FLAGS));
+    dmxPut32(&p[E131_FRAMING_VECTOR], E131_VECTOR_DATA_PACKET);
+    strcpy((char*)&p[E131_SOURCE_NAME], "dmxsend");
+    p[E131_PRIORITY] = 100;
+    dmxPut16(&p[E131_SYNC_ADDRESS], useSync? firstUniverse : 0);
+    p[E131_SEQUENCE] = sequence;
+    p[E131_OPTIONS] = options;
+    dmxPut16(&p[E131_UNIVERSE], universe);
+
+    dmxPut16(&p[E131_DMP_FLAGS], 0x7000 | (len - E131_DMP_FLAGS));
+    p[E131_DMP_VECTOR] = E131_VECTOR_DMP_SET_PROPERTY;
+    p[E131_DMP_VECTOR + 1] = 0xA1;          // address & data type
+    dmxPut16(&p[E131_DMP_VECTOR + 4], 1);   // address increment
+    dmxPut16(&p[E131_PROPERTY_COUNT], DMX_CHANNELS + 1);
+    p[E131_START_CODE] = 0;
+    memcpy(&p[E131_DATA], pData, DMX_CHANNELS);
+
+    return len;
+}
+
+static int buildE131Sync(uint8_t* p, uint8_t sequence)
+{
+    const int len = E131_SYNC_SIZE;
+
+    memset(p, 0, len);
+    dmxPut16(&p[0], 0x0010);
+    memcpy(&p[4], E131_ACN_ID, sizeof(E131_ACN_ID));
+    dmxPut16(&p[16], 0x7000 | (len - 16));
+    dmxPut32(&p[E131_ROOT_VECTOR], E131_VECTOR_ROOT_EXTENDED);
+    dmxPut16(&p[E131_FRAMING_FLAGS], 0x7000 | (len - E131_FRAMING_FLAGS));
+    dmxPut32(&p[E131_FRAMING_VECTOR], E131_VECTOR_EXTENDED_SYNC);
+    p[E131_SYNC_SEQUENCE] = sequence;
+    dmxPut16(&p[E131_SYNC_UNIVERSE], firstUniverse);
+
+    return len;
+}
+
+static int buildArtDmx(uint8_t* p, uint16_t universe, uint8_t sequence,
+    const uint8_t* pData)
+{
+    memcpy(p, ARTNET_ID, sizeof(ARTNET_ID));
+    p[ARTNET_OPCODE] = ARTNET_OP_DMX & 0xFF;
+    p[ARTNET_OPCODE + 1] = ARTNET_OP_DMX >> 8;
+    dmxPut16(&p[ARTNET_VERSION], ARTNET_PROTOCOL_VERSION);
+    p[ARTNET_SEQUENCE] = sequence;
+    p[ARTNET_SEQUENCE + 1] = 0;
+    p[ARTNET_SUBUNI] = universe & 0xFF;
+    p[ARTNET_NET] = (universe >> 8) & 0x7F;
+    dmxPut16(&p[ARTNET_LENGTH], DMX_CHANNELS);
+    memcpy(&p[ARTNET_DATA], pData, DMX_CHANNELS);
+
+    return ARTNET_DATA_MAX_SIZE;
+}
+
+static int buildArtSync(uint8_t* p)
+{
+    memcpy(p, ARTNET_ID, sizeof(ARTNET_ID));
+    p[ARTNET_OPCODE] = ARTNET_OP_SYNC & 0xFF;
+    p[ARTNET_OPCODE + 1] = ARTNET_OP_SYNC >> 8;
+    dmxPut16(&p[ARTNET_VERSION], ARTNET_PROTOCOL_VERSION);
+    p[12] = 0;  // Aux1
+    p[13] = 0;  // Aux2
+
+    return ARTNET_SYNC_SIZE;
+}
+
+// A diagonal rainbow that drifts one pixel per frame.
+static void fillUniverse(uint8_t* pData, int universe, int frame)
+{
+    for (int i = 0; i < DMX_PIXELS_PER_UNIVERSE; i++)
+    {
+        int pixel = universe * DMX_PIXELS_PER_UNIVERSE + i;
+        int hue = (pixel * 7 + frame * 4) % 768;
+        uint8_t level = hue % 256;
+        uint8_t* p = &pData[i * 3];
+        switch (hue / 256)
+        {
+            case 0: p[0] = 255 - level; p[1] = level; p[2] = 0; break;
+            case 1: p[0] = 0; p[1] = 255 - level; p[2] = level; break;
+            default: p[0] = level; p[1] = 0; p[2] = 255 - level; break;
+        }
+    }
+    pData[DMX_CHANNELS - 2] = 0;
+    pData[DMX_CHANNELS - 1] = 0;
+}
+
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [-tHPuNrcS]\n", prog);
+    puts("  -t --type      e131 (default) or artnet\n"
+         "  -H --host      destination address (default 127.0.0.1)\n"
+         "  -P --port      destination port (default per protocol)\n"
+         "  -u --universe  first universe (default 1)\n"
+         "  -N --universes number of universes (default 2)\n"
+         "  -r --rate      frames per second (default 40)\n"
+         "  -c --count     frames to send (default 200)\n"
+         "  -S --nosync    don't send sync packets\n"
+    );
+    exit(1);
+}
+
+static void parse_opts(int argc, char *argv[])
+{
+    while (1) {
+        static const struct option lopts[] = {
+            { "type",      1, 0, 't' },
+            { "host",      1, 0, 'H' },
+            { "port",      1, 0, 'P' },
+            { "universe",  1, 0, 'u' },
+            { "universes", 1, 0, 'N' },
+            { "rate",      1, 0, 'r' },
+            { "count",     1, 0, 'c' },
+            { "nosync",    0, 0, 'S' },
+            { NULL, 0, 0, 0 },
+        };
+        int c;
+
+        c = getopt_long(argc, argv, "t:H:P:u:N:r:c:S", lopts, NULL);
+
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 't':
+            artnet = strcmp(optarg, "artnet") == 0;
+            break;
+        case 'H':
+            host = optarg;
+            break;
+        case 'P':
+            port = atoi(optarg);
+            break;
+        case 'u':
+            firstUniverse = atoi(optarg);
+            break;
+        case 'N':
+            universes = atoi(optarg);
+            break;
+        case 'r':
+            frameRate = atoi(optarg);
+            break;
+        case 'c':
+            frameCount = atoi(optarg);
+            break;
+        case 'S':
+            useSync = false;
+            break;
+        default:
+            print_usage(argv[0]);
+            break;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    parse_opts(argc, argv);
+
+    if (universes < 1 || universes > MAX_UNIVERSES)
+        universes = universes < 1? 1 : MAX_UNIVERSES;
+    if (frameRate < 1)
+        frameRate = 1;
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+        pabort("can't open socket");
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port != 0? port : artnet? ARTNET_PORT : E131_PORT);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1)
+        pabort("bad host address");
+
+    // One datagram per universe plus the sync.
+    static uint8_t packets[MAX_UNIVERSES + 1][DMX_PACKET_MAX_SIZE];
+    static uint8_t dmxData[DMX_CHANNELS];
+    struct iovec iovs[MAX_UNIVERSES + 1];
+    struct mmsghdr msgs[MAX_UNIVERSES + 1];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i <= universes; i++)
+    {
+        iovs[i].iov_base = packets[i];
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+    }
+
+    printf("sending %d %s universes from %d to %s at %d fps, %d frames%s\n",
+        universes, artnet? "Art-Net" : "E1.31", firstUniverse, host,
+        frameRate, frameCount, useSync? " with sync" : "");
+
+    const long FRAME_NSEC = 1000000000L / frameRate;
+    struct timespec start, next, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+    uint8_t sequence = 0;
+    long packetsSent = 0;
+
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        // Art-Net reserves 0 for "not sequenced"; skip it in both protocols.
+        if (++sequence == 0)
+            sequence = 1;
+        for (int u = 0; u < universes; u++)
+        {
+            fillUniverse(dmxData, u, frame);
+            iovs[u].iov_len = artnet?
+                buildArtDmx(packets[u], firstUniverse + u, sequence, dmxData) :
+                buildE131Data(packets[u], firstUniverse + u, sequence, 0, dmxData);
+        }
+        int count = universes;
+        if (useSync)
+        {
+            iovs[count].iov_len = artnet?
+                buildArtSync(packets[count]) : buildE131Sync(packets[count], sequence);
+            count++;
+        }
+
+        int sent = 0;
+        while (sent < count)
+        {
+            int ret = sendmmsg(sock, &msgs[sent], count - sent, 0);
+            if (ret < 0)
+                pabort("can't send packets");
+            sent += ret;
+        }
+        packetsSent += sent;
+
+        addNsec(next, FRAME_NSEC);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    if (!artnet)
+    {
+        // E1.31 says to send three stream-terminated packets per universe.
+        memset(dmxData, 0, sizeof(dmxData));
+        for (int repeat = 0; repeat < 3; repeat++)
+        {
+            if (++sequence == 0)
+                sequence = 1;
+            for (int u = 0; u < universes; u++)
+                iovs[u].iov_len = buildE131Data(packets[u], firstUniverse + u,
+                    sequence, E131_OPT_TERMINATED, dmxData);
+            if (sendmmsg(sock, msgs, universes, 0) < 0)
+                pabort("can't send packets");
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("sent %ld packets in %.2f s (%.1f fps)\n",
+        packetsSent, seconds, frameCount / seconds);
+
+    close(sock);
+    return 0;
+}
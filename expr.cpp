@@ -0,0 +1,598 @@
+/*
+* Compiled per-pixel pattern expressions for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "expr.h"
+
+enum exprOpCode_t
+{
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_POW, OP_MIN, OP_MAX,
+    OP_NEG, OP_SIN, OP_COS, OP_TAN, OP_SQRT, OP_ABS, OP_INT, OP_FLOOR,
+    OP_EXP, OP_LOG
+};
+
+// Pixel code only: which operands are vectors (the destination always is).
+static const uint8_t VEC_A = 0x40;
+static const uint8_t VEC_B = 0x80;
+static const uint8_t OP_MASK = 0x3F;
+
+// Fixed registers.
+static const int REG_T = 0;
+static const int REG_Y = 1;
+static const int REG_W = 2;
+static const int REG_H = 3;
+static const int VREG_X = 0;
+
+// Every nested (, function argument, - and ^ goes back through
+// parseUnary(); past this many levels the text is refused rather than
+// recursing off the end of the stack.
+static const int MAX_DEPTH = 64;
+
+enum level_t { LEVEL_CONST, LEVEL_FRAME, LEVEL_ROW, LEVEL_PIXEL };
+
+struct value_t
+{
+    level_t level;
+    int reg;                    // vector register at LEVEL_PIXEL, else scalar
+};
+
+struct binding_t
+{
+    char name[32];
+    value_t value;
+};
+
+struct compiler_t
+{
+    exprProgram_t* pProgram;
+    const char* pText;
+    const char* pPos;
+    bool failed;
+    int depth;                  // parseUnary() nesting
+    binding_t bindings[64];
+    int bindingCount;
+    bool vectorBusy[EXPR_VECTORS];
+    bool vectorPinned[EXPR_VECTORS];    // named, so never reused
+};
+
+struct function_t
+{
+    const char* name;
+    int op;
+    int args;
+};
+
+static const function_t functions[] =
+{
+    { "sin", OP_SIN, 1 }, { "cos", OP_COS, 1 }, { "tan", OP_TAN, 1 },
+    { "sqrt", OP_SQRT, 1 }, { "abs", OP_ABS, 1 }, { "int", OP_INT, 1 },
+    { "floor", OP_FLOOR, 1 }, { "exp", OP_EXP, 1 }, { "log", OP_LOG, 1 },
+    { "min", OP_MIN, 2 }, { "max", OP_MAX, 2 }, { "pow", OP_POW, 2 },
+};
+
+// One operation on scalars: frame and row code, and constant folding.
+static double applyOp(int op, double a, double b)
+{
+    switch (op)
+    {
+        case OP_ADD:   return a + b;
+        case OP_SUB:   return a - b;
+        case OP_MUL:   return a * b;
+        case OP_DIV:   return a / b;
+        case OP_MOD:   return fmod(a, b);
+        case OP_POW:   return pow(a, b);
+        case OP_MIN:   return a < b? a : b;
+        case OP_MAX:   return a > b? a : b;
+        case OP_NEG:   return -a;
+        case OP_SIN:   return sin(a);
+        case OP_COS:   return cos(a);
+        case OP_TAN:   return tan(a);
+        case OP_SQRT:  return sqrt(a);
+        case OP_ABS:   return fabs(a);
+        case OP_INT:   return trunc(a);
+        case OP_FLOOR: return floor(a);
+        case OP_EXP:   return exp(a);
+        case OP_LOG:   return log(a);
+    }
+    return 0;
+}
+
+static void fail(compiler_t* pC, const char* message)
+{
+    if (!pC->failed)
+        snprintf(pC->pProgram->error, sizeof(pC->pProgram->error), "%s at column %d",
+            message, (int)(pC->pPos - pC->pText) + 1);
+    pC->failed = true;
+}
+
+static void skipSpace(compiler_t* pC)
+{
+    while (*pC->pPos == ' ' || *pC->pPos == '\t' || *pC->pPos == '\r')
+        pC->pPos++;
+}
+
+static bool accept(compiler_t* pC, char c)
+{
+    skipSpace(pC);
+    if (*pC->pPos != c)
+        return false;
+    pC->pPos++;
+    return true;
+}
+
+static int newScalar(compiler_t* pC, double value)
+{
+    exprProgram_t* pProgram = pC->pProgram;
+    if (pProgram->scalarCount == EXPR_SCALARS)
+    {
+        fail(pC, "too many values");
+        return 0;
+    }
+    pProgram->scalars[pProgram->scalarCount] = value;
+    return pProgram->scalarCount++;
+}
+
+static int newVector(compiler_t* pC)
+{
+    for (int reg = 0; reg < EXPR_VECTORS; reg++)
+    {
+        if (!pC->vectorBusy[reg])
+        {
+            pC->vectorBusy[reg] = true;
+            if (reg >= pC->pProgram->vectorCount)
+                pC->pProgram->vectorCount = reg + 1;
+            return reg;
+        }
+    }
+    fail(pC, "expression too deep");
+    return 0;
+}
+
+static void release(compiler_t* pC, value_t value)
+{
+    if (value.level == LEVEL_PIXEL && !pC->vectorPinned[value.reg])
+        pC->vectorBusy[value.reg] = false;
+}
+
+static void emit(compiler_t* pC, exprOp_t* code, int* pCount, int op, int dst, int a, int b)
+{
+    if (*pCount == EXPR_MAX_OPS)
+    {
+        fail(pC, "expression too long");
+        return;
+    }
+    exprOp_t& instruction = code[(*pCount)++];
+    instruction.op = op;
+    instruction.dst = dst;
+    instruction.a = a;
+    instruction.b = b;
+}
+
+// Emit op into the code block for the level its operands need, folding
+// it away if they are constants.
+static value_t operate(compiler_t* pC, int op, value_t a, value_t b, int args)
+{
+    exprProgram_t* pProgram = pC->pProgram;
+    level_t level = args == 2 && b.level > a.level? b.level : a.level;
+    value_t result = { level, 0 };
+
+    if (level == LEVEL_CONST)
+    {
+        double value = applyOp(op, pProgram->scalars[a.reg],
+            args == 2? pProgram->scalars[b.reg] : 0);
+        result.reg = newScalar(pC, value);
+    }
+    else if (level < LEVEL_PIXEL)
+    {
+        result.reg = newScalar(pC, 0);
+        if (level == LEVEL_FRAME)
+            emit(pC, pProgram->frameCode, &pProgram->frameOps, op, result.reg, a.reg, b.reg);
+        else
+            emit(pC, pProgram->rowCode, &pProgram->rowOps, op, result.reg, a.reg, b.reg);
+    }
+    else
+    {
+        // Element-wise, so the result may take an operand's register.
+        release(pC, a);
+        if (args == 2)
+            release(pC, b);
+        result.reg = newVector(pC);
+        int flags = (a.level == LEVEL_PIXEL? VEC_A : 0) |
+            (args == 2 && b.level == LEVEL_PIXEL? VEC_B : 0);
+        emit(pC, pProgram->pixelCode, &pProgram->pixelOps, op | flags, result.reg,
+            a.reg, args == 2? b.reg : 0);
+    }
+    return result;
+}
+
+static value_t parseExpression(compiler_t* pC);
+
+static value_t parsePrimary(compiler_t* pC)
+{
+    value_t value = { LEVEL_CONST, 0 };
+    skipSpace(pC);
+    const char* pStart = pC->pPos;
+
+    if (isdigit((unsigned char)*pStart) || *pStart == '.')
+    {
+        char* pEnd;
+        double number = strtod(pStart, &pEnd);
+        pC->pPos = pEnd;
+        value.reg = newScalar(pC, number);
+        return value;
+    }
+
+    if (accept(pC, '('))
+    {
+        value = parseExpression(pC);
+        if (!accept(pC, ')'))
+            fail(pC, "missing )");
+        return value;
+    }
+
+    if (!isalpha((unsigned char)*pStart) && *pStart != '_')
+    {
+        fail(pC, "expected a value");
+        return value;
+    }
+    char name[32];
+    int len = 0;
+    while (isalnum((unsigned char)*pC->pPos) || *pC->pPos == '_')
+    {
+        if (len < (int)sizeof(name) - 1)
+            name[len++] = *pC->pPos;
+        pC->pPos++;
+    }
+    name[len] = '\0';
+
+    if (accept(pC, '('))
+    {
+        for (size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++)
+        {
+            if (strcmp(name, functions[i].name) != 0)
+                continue;
+            value_t a = parseExpression(pC);
+            value_t b = { LEVEL_CONST, 0 };
+            if (functions[i].args == 2)
+            {
+                if (!accept(pC, ','))
+                    fail(pC, "expected ,");
+                b = parseExpression(pC);
+            }
+            if (!accept(pC, ')'))
+                fail(pC, "missing )");
+            return operate(pC, functions[i].op, a, b, functions[i].args);
+        }
+        fail(pC, "unknown function");
+        return value;
+    }
+
+    // Later bindings shadow earlier ones.
+    for (int i = pC->bindingCount - 1; i >= 0; i--)
+    {
+        if (strcmp(name, pC->bindings[i].name) == 0)
+            return pC->bindings[i].value;
+    }
+    fail(pC, "unknown name");
+    return value;
+}
+
+static value_t parseUnary(compiler_t* pC)
+{
+    value_t value = { LEVEL_CONST, 0 };
+    if (pC->depth >= MAX_DEPTH)
+    {
+        fail(pC, "expression too deep");
+        return value;
+    }
+    pC->depth++;
+    if (accept(pC, '-'))
+    {
+        value_t a = parseUnary(pC);
+        value = operate(pC, OP_NEG, a, a, 1);
+    }
+    else
+    {
+        value = parsePrimary(pC);
+        if (accept(pC, '^'))
+        {
+            value_t exponent = parseUnary(pC);
+            value = operate(pC, OP_POW, value, exponent, 2);
+        }
+    }
+    pC->depth--;
+    return value;
+}
+
+static value_t parseTerm(compiler_t* pC)
+{
+    value_t value = parseUnary(pC);
+    while (!pC->failed)
+    {
+        int op;
+        if (accept(pC, '*'))
+            op = OP_MUL;
+        else if (accept(pC, '/'))
+            op = OP_DIV;
+        else if (accept(pC, '%'))
+            op = OP_MOD;
+        else
+            break;
+        value_t b = parseUnary(pC);
+        value = operate(pC, op, value, b, 2);
+    }
+    return value;
+}
+
+static value_t parseExpression(compiler_t* pC)
+{
+    value_t value = parseTerm(pC);
+    while (!pC->failed)
+    {
+        int op;
+        if (accept(pC, '+'))
+            op = OP_ADD;
+        else if (accept(pC, '-'))
+            op = OP_SUB;
+        else
+            break;
+        value_t b = parseTerm(pC);
+        value = operate(pC, op, value, b, 2);
+    }
+    return value;
+}
+
+static void bind(compiler_t* pC, const char* name, value_t value)
+{
+    if (pC->bindingCount == (int)(sizeof(pC->bindings) / sizeof(pC->bindings[0])))
+    {
+        fail(pC, "too many names");
+        return;
+    }
+    binding_t& binding = pC->bindings[pC->bindingCount++];
+    snprintf(binding.name, sizeof(binding.name), "%s", name);
+    binding.value = value;
+    if (value.level == LEVEL_PIXEL)
+        pC->vectorPinned[value.reg] = true;
+}
+
+bool exprCompile(exprProgram_t* pProgram, const char* text)
+{
+    memset(pProgram, 0, sizeof(*pProgram));
+    compiler_t c;
+    memset(&c, 0, sizeof(c));
+    c.pProgram = pProgram;
+    c.pText = text;
+    c.pPos = text;
+
+    pProgram->scalarCount = REG_H + 1;
+    pProgram->vectorCount = VREG_X + 1;
+    c.vectorBusy[VREG_X] = true;
+    value_t x = { LEVEL_PIXEL, VREG_X };
+    value_t y = { LEVEL_ROW, REG_Y };
+    value_t t = { LEVEL_FRAME, REG_T };
+    value_t w = { LEVEL_FRAME, REG_W };
+    value_t h = { LEVEL_FRAME, REG_H };
+    value_t pi = { LEVEL_CONST, newScalar(&c, M_PI) };
+    bind(&c, "x", x);
+    bind(&c, "y", y);
+    bind(&c, "t", t);
+    bind(&c, "w", w);
+    bind(&c, "h", h);
+    bind(&c, "pi", pi);
+
+    // Statements are name = expression, separated by ; or newlines.
+    while (!c.failed)
+    {
+        while (accept(&c, ';') || accept(&c, '\n'))
+            ;
+        skipSpace(&c);
+        if (*c.pPos == '\0' || *c.pPos == '#')
+        {
+            // A # comment runs to the end of its line.
+            while (*c.pPos != '\0' && *c.pPos != '\n')
+                c.pPos++;
+            if (*c.pPos == '\0')
+                break;
+            continue;
+        }
+
+        char name[32];
+        int len = 0;
+        while (isalnum((unsigned char)*c.pPos) || *c.pPos == '_')
+        {
+            if (len < (int)sizeof(name) - 1)
+                name[len++] = *c.pPos;
+            c.pPos++;
+        }
+        name[len] = '\0';
+        if (len == 0 || !accept(&c, '='))
+        {
+            fail(&c, "expected name =");
+            break;
+        }
+        value_t value = parseExpression(&c);
+        bind(&c, name, value);
+
+        skipSpace(&c);
+        if (*c.pPos != '\0' && *c.pPos != ';' && *c.pPos != '\n' && *c.pPos != '#')
+            fail(&c, "expected end of statement");
+    }
+    if (c.failed)
+        return false;
+
+    static const char* outputNames[3] = { "red", "green", "blue" };
+    for (int i = 0; i < 3; i++)
+    {
+        pProgram->outputs[i] = -1;
+        for (int j = c.bindingCount - 1; j >= 0; j--)
+        {
+            if (strcmp(outputNames[i], c.bindings[j].name) == 0)
+            {
+                pProgram->outputs[i] = c.bindings[j].value.reg;
+                pProgram->outputVector[i] = c.bindings[j].value.level == LEVEL_PIXEL;
+                break;
+            }
+        }
+    }
+    if (pProgram->outputs[0] < 0 && pProgram->outputs[1] < 0 && pProgram->outputs[2] < 0)
+    {
+        snprintf(pProgram->error, sizeof(pProgram->error), "no red, green or blue");
+        return false;
+    }
+    return true;
+}
+
+static void runScalar(const exprOp_t* code, int count, double* s)
+{
+    for (int i = 0; i < count; i++)
+        s[code[i].dst] = applyOp(code[i].op, s[code[i].a], s[code[i].b]);
+}
+
+// Vector operations, a scalar operand standing for a span of copies.
+struct addOp_t   { static inline double apply(double a, double b) { return a + b; } };
+struct subOp_t   { static inline double apply(double a, double b) { return a - b; } };
+struct mulOp_t   { static inline double apply(double a, double b) { return a * b; } };
+struct divOp_t   { static inline double apply(double a, double b) { return a / b; } };
+struct minOp_t   { static inline double apply(double a, double b) { return a < b? a : b; } };
+struct maxOp_t   { static inline double apply(double a, double b) { return a > b? a : b; } };
+struct modOp_t   { static inline double apply(double a, double b) { return fmod(a, b); } };
+struct powOp_t   { static inline double apply(double a, double b) { return pow(a, b); } };
+struct negOp_t   { static inline double apply(double a) { return -a; } };
+struct sinOp_t   { static inline double apply(double a) { return sin(a); } };
+struct cosOp_t   { static inline double apply(double a) { return cos(a); } };
+struct tanOp_t   { static inline double apply(double a) { return tan(a); } };
+struct sqrtOp_t  { static inline double apply(double a) { return sqrt(a); } };
+struct absOp_t   { static inline double apply(double a) { return fabs(a); } };
+struct intOp_t   { static inline double apply(double a) { return trunc(a); } };
+struct floorOp_t { static inline double apply(double a) { return floor(a); } };
+struct expOp_t   { static inline double apply(double a) { return exp(a); } };
+struct logOp_t   { static inline double apply(double a) { return log(a); } };
+
+template <class F> static void vectorBinary(double* d, const double* a, const double* b,
+    int flags, int n)
+{
+    if ((flags & (VEC_A | VEC_B)) == (VEC_A | VEC_B))
+    {
+        for (int i = 0; i < n; i++)
+            d[i] = F::apply(a[i], b[i]);
+    }
+    else if (flags & VEC_A)
+    {
+        const double sb = *b;
+        for (int i = 0; i < n; i++)
+            d[i] = F::apply(a[i], sb);
+    }
+    else
+    {
+        const double sa = *a;
+        for (int i = 0; i < n; i++)
+            d[i] = F::apply(sa, b[i]);
+    }
+}
+
+template <class F> static void vectorUnary(double* d, const double* a, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = F::apply(a[i]);
+}
+
+static void runVector(const exprOp_t* code, int count, const double* s,
+    double (*v)[EXPR_SPAN], int n)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const exprOp_t& instruction = code[i];
+        double* d = v[instruction.dst];
+        const double* a = instruction.op & VEC_A? v[instruction.a] : &s[instruction.a];
+        const double* b = instruction.op & VEC_B? v[instruction.b] : &s[instruction.b];
+        int flags = instruction.op & (VEC_A | VEC_B);
+
+        switch (instruction.op & OP_MASK)
+        {
+            case OP_ADD:   vectorBinary<addOp_t>(d, a, b, flags, n); break;
+            case OP_SUB:   vectorBinary<subOp_t>(d, a, b, flags, n); break;
+            case OP_MUL:   vectorBinary<mulOp_t>(d, a, b, flags, n); break;
+            case OP_DIV:   vectorBinary<divOp_t>(d, a, b, flags, n); break;
+            case OP_MOD:   vectorBinary<modOp_t>(d, a, b, flags, n); break;
+            case OP_POW:   vectorBinary<powOp_t>(d, a, b, flags, n); break;
+            case OP_MIN:   vectorBinary<minOp_t>(d, a, b, flags, n); break;
+            case OP_MAX:   vectorBinary<maxOp_t>(d, a, b, flags, n); break;
+            case OP_NEG:   vectorUnary<negOp_t>(d, a, n); break;
+            case OP_SIN:   vectorUnary<sinOp_t>(d, a, n); break;
+            case OP_COS:   vectorUnary<cosOp_t>(d, a, n); break;
+            case OP_TAN:   vectorUnary<tanOp_t>(d, a, n); break;
+            case OP_SQRT:  vectorUnary<sqrtOp_t>(d, a, n); break;
+            case OP_ABS:   vectorUnary<absOp_t>(d, a, n); break;
+            case OP_INT:   vectorUnary<intOp_t>(d, a, n); break;
+            case OP_FLOOR: vectorUnary<floorOp_t>(d, a, n); break;
+            case OP_EXP:   vectorUnary<expOp_t>(d, a, n); break;
+            case OP_LOG:   vectorUnary<logOp_t>(d, a, n); break;
+        }
+    }
+}
+
+static inline uint8_t toChannel(double value)
+{
+    // NaN falls into the first case.
+    if (!(value > 0))
+        return 0;
+    return value >= 255? 255 : (uint8_t)value;
+}
+
+void exprRender(const exprProgram_t* pProgram, double t, surface_t* pDst, rect_t tile)
+{
+    double s[EXPR_SCALARS];
+    memcpy(s, pProgram->scalars, pProgram->scalarCount * sizeof(double));
+    s[REG_T] = t;
+    s[REG_W] = pDst->width;
+    s[REG_H] = pDst->height;
+    runScalar(pProgram->frameCode, pProgram->frameOps, s);
+
+    double v[EXPR_VECTORS][EXPR_SPAN];
+    uint8_t channels[3][EXPR_SPAN];
+
+    for (int row = tile.y; row < tile.y + tile.height; row++)
+    {
+        s[REG_Y] = row;
+        runScalar(pProgram->rowCode, pProgram->rowOps, s);
+        rgbPixel_t* pRow = &pDst->pixels[row * pDst->stride];
+
+        for (int col = tile.x; col < tile.x + tile.width; col += EXPR_SPAN)
+        {
+            int n = tile.x + tile.width - col;
+            if (n > EXPR_SPAN)
+                n = EXPR_SPAN;
+            for (int i = 0; i < n; i++)
+                v[VREG_X][i] = col + i;
+            runVector(pProgram->pixelCode, pProgram->pixelOps, s, v, n);
+
+            for (int c = 0; c < 3; c++)
+            {
+                int reg = pProgram->outputs[c];
+                if (reg < 0)
+                    memset(channels[c], 0, n);
+                else if (pProgram->outputVector[c])
+                    for (int i = 0; i < n; i++)
+                        channels[c][i] = toChannel(v[reg][i]);
+                else
+                    memset(channels[c], toChannel(s[reg]), n);
+            }
+            for (int i = 0; i < n; i++)
+                makeRgbPixel(pRow[col + i], channels[0][i], channels[1][i], channels[2][i]);
+        }
+    }
+}
+
+void exprShader(const void* params, surface_t* pDst, rect_t tile)
+{
+    const exprParams_t* pParams = (const exprParams_t*)params;
+    exprRender(pParams->pProgram, pParams->t, pDst, tile);
+}
@@ -0,0 +1,80 @@
+/*
+* Compiled per-pixel pattern expressions for the SPI NEOPixel display
+* By R. Blansett
+*
+* A pattern written as a few assignments instead of C++, e.g.
+*
+*   K = 3.1415*3/2; blue = 32 - int(32*sin(K + t/10 + y + x))
+*
+* which is pattern 97. x and y are the pixel's column and row, t the
+* frame number, w and h the surface size. Any other name is a parameter
+* or a temporary defined by an earlier assignment; red, green and blue
+* (missing ones are 0) set the pixel, clamped to 0..255 and truncated.
+* Operators are + - * / % (fmod) and ^ (pow); functions are sin, cos,
+* tan, sqrt, abs, int (toward zero), floor, exp, log, min, max and pow.
+*
+* The text is compiled once into a register bytecode, 4 bytes an
+* instruction, split by what each value depends on: the frame code
+* (t and constants) runs once per frame, the row code (y) once per row,
+* and only what depends on x runs per pixel, as vector instructions over
+* a span of up to EXPR_SPAN pixels at a time. So the interpreter's
+* dispatch costs one switch per instruction per span, and the inner
+* loops are plain array arithmetic the compiler can vectorize.
+*/
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+#include "raster.h"
+
+static const int EXPR_MAX_OPS = 256;        // per code block
+static const int EXPR_SCALARS = 250;        // registers (8-bit indices)
+static const int EXPR_VECTORS = 32;
+static const int EXPR_SPAN = 64;            // pixels per vector instruction
+
+struct exprOp_t
+{
+    uint8_t op;
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+};
+
+struct exprProgram_t
+{
+    exprOp_t frameCode[EXPR_MAX_OPS];
+    exprOp_t rowCode[EXPR_MAX_OPS];
+    exprOp_t pixelCode[EXPR_MAX_OPS];
+    int frameOps;
+    int rowOps;
+    int pixelOps;
+
+    double scalars[EXPR_SCALARS];   // constants; the rest filled at run time
+    int scalarCount;
+    int vectorCount;
+
+    int outputs[3];                 // register of red, green, blue; -1 = 0
+    bool outputVector[3];
+
+    char error[128];
+};
+
+// Returns false, with the reason in pProgram->error, if text doesn't parse.
+bool exprCompile(exprProgram_t* pProgram, const char* text);
+
+// Fill tile of pDst for frame t.
+void exprRender(const exprProgram_t* pProgram, double t, surface_t* pDst, rect_t tile);
+
+// Tile shader form (see tilepool.h).
+struct exprParams_t
+{
+    const exprProgram_t* pProgram;
+    double t;
+};
+
+void exprShader(const void* params, surface_t* pDst, rect_t tile);
+
+#endif // EXPR_H
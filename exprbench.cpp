@@ -0,0 +1,166 @@
+/*
+* Pattern expression benchmark
+* By R. Blansett
+*
+* Renders the sine (pattern 97) and plasma shaders both as hand-written
+* C++ and as compiled expressions, checks the expressions give the same
+* pixels, and times both on a 256x128 wall. The interpreter should stay
+* within a small factor of the C++.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "raster.h"
+#include "tilepool.h"
+#include "patterns.h"
+#include "expr.h"
+
+static const char* SINE_EXPR =
+    "K = 3.1415*3/2; blue = 32 - int(32*sin(K + t/10 + y + x))";
+
+static const char* PLASMA_EXPR =
+    "k = 2*pi/48; T = t*0.05\n"
+    "X = x*k; Y = y*k\n"
+    "v = sin(X + T) + sin(Y*0.5 + T*1.3) + sin((X + Y)*0.5 + T*0.7) +"
+    " sin(sqrt(X*X + Y*Y)*0.5 + T)\n"
+    "p = v*pi*0.25\n"
+    "red = 32 + 31*sin(p); green = 32 + 31*sin(p + 2.094); blue = 32 + 31*sin(p + 4.189)\n";
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+struct benchPattern_t
+{
+    const char* name;
+    const char* text;
+    tileShader_t shader;
+    void (*setFrame)(void* params, int frame);
+    void* params;
+    int frames;                 // to compare over
+};
+
+static sineParams_t sine;
+static plasmaParams_t plasma = { 0.0f, 48.0f };
+
+static void sineFrame(void* params, int frame)
+{
+    ((sineParams_t*)params)->pass = frame;
+}
+
+static void plasmaFrame(void* params, int frame)
+{
+    ((plasmaParams_t*)params)->time = frame * 0.05f;
+}
+
+// Pixels that differ, and by more than one level, over frames frames.
+static void compare(benchPattern_t* pPattern, const exprProgram_t* pProgram,
+    surface_t* pWant, surface_t* pGot, long* pDiffer, long* pOff)
+{
+    int area = pWant->width * pWant->height;
+    *pDiffer = 0;
+    *pOff = 0;
+    for (int frame = 0; frame < pPattern->frames; frame++)
+    {
+        pPattern->setFrame(pPattern->params, frame);
+        tileRenderSerial(pWant, pPattern->shader, pPattern->params);
+        exprParams_t params = { pProgram, (double)frame };
+        tileRenderSerial(pGot, exprShader, &params);
+
+        for (int i = 0; i < area; i++)
+        {
+            const rgbPixel_t& a = pWant->pixels[i];
+            const rgbPixel_t& b = pGot->pixels[i];
+            int d = abs(a.r - b.r) + abs(a.g - b.g) + abs(a.b - b.b);
+            if (d > 0)
+                (*pDiffer)++;
+            if (abs(a.r - b.r) > 1 || abs(a.g - b.g) > 1 || abs(a.b - b.b) > 1)
+                (*pOff)++;
+        }
+    }
+}
+
+int main()
+{
+    const int wallWidth = 256, wallHeight = 128, frames = 100;
+    int area = wallWidth * wallHeight;
+    rgbPixel_t* wantPixels = new rgbPixel_t[area];
+    rgbPixel_t* gotPixels = new rgbPixel_t[area];
+    int failures = 0;
+
+    benchPattern_t patterns[] = {
+        { "sine", SINE_EXPR, sineShader, sineFrame, &sine, 6283 },
+        { "plasma", PLASMA_EXPR, plasmaShader, plasmaFrame, &plasma, 600 },
+    };
+
+    for (size_t p = 0; p < ARRAY_SIZE(patterns); p++)
+    {
+        benchPattern_t* pPattern = &patterns[p];
+        static exprProgram_t program;
+        if (!exprCompile(&program, pPattern->text))
+        {
+            printf("%-8s doesn't compile: %s\n", pPattern->name, program.error);
+            failures++;
+            continue;
+        }
+        printf("%-8s %d frame, %d row, %d pixel instructions, %d vector registers\n",
+            pPattern->name, program.frameOps, program.rowOps, program.pixelOps,
+            program.vectorCount);
+
+        // Over every frame of the pattern on the 16x16 grid. The plasma
+        // shader works in float and the expression in double, so it
+        // may round the other way now and then; the sine must be exact.
+        surface_t want = makeSurface(wantPixels, GRID_WIDTH, GRID_HEIGHT);
+        surface_t got = makeSurface(gotPixels, GRID_WIDTH, GRID_HEIGHT);
+        long differ, off;
+        compare(pPattern, &program, &want, &got, &differ, &off);
+        bool ok = off == 0 && (p > 0 || differ == 0);
+        printf("%-8s %ld of %ld pixels differ, %ld by more than 1  %s\n", pPattern->name,
+            differ, (long)pPattern->frames * GRID_AREA, off, ok? "ok" : "MISMATCH");
+        if (!ok)
+            failures++;
+
+        want = makeSurface(wantPixels, wallWidth, wallHeight);
+        got = makeSurface(gotPixels, wallWidth, wallHeight);
+        double start = now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            pPattern->setFrame(pPattern->params, frame);
+            tileRenderSerial(&want, pPattern->shader, pPattern->params);
+        }
+        double native = (now() - start) / frames;
+
+        start = now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            exprParams_t params = { &program, (double)frame };
+            tileRenderSerial(&got, exprShader, &params);
+        }
+        double compiled = (now() - start) / frames;
+        printf("%-8s %dx%d: C++ %.3f ms/frame, expression %.3f ms/frame (%.2fx)\n",
+            pPattern->name, wallWidth, wallHeight, native * 1e3, compiled * 1e3,
+            compiled / native);
+    }
+
+    const char* bad[] = { "blue = sin(x", "blue = q + 1", "x y", "red = foo(1)", "z = 1" };
+    for (size_t i = 0; i < ARRAY_SIZE(bad); i++)
+    {
+        static exprProgram_t program;
+        bool compiled = exprCompile(&program, bad[i]);
+        printf("\"%s\": %s\n", bad[i], compiled? "COMPILED" : program.error);
+        if (compiled)
+            failures++;
+    }
+
+    delete[] wantPixels;
+    delete[] gotPixels;
+    return failures? 1 : 0;
+}
@@ -0,0 +1,100 @@
+/*
+* Fixed-point FFT for the audio visualizer
+* By R. Blansett
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "fft.h"
+
+bool fftInit(fft_t* pFft, int size)
+{
+    memset(pFft, 0, sizeof(*pFft));
+    if (size < FFT_MIN_SIZE || size > FFT_MAX_SIZE || (size & (size - 1)) != 0)
+        return false;
+
+    pFft->size = size;
+    while ((1 << pFft->log2Size) < size)
+        pFft->log2Size++;
+
+    pFft->cosTable = new int16_t[size / 2];
+    pFft->sinTable = new int16_t[size / 2];
+    pFft->bitReverse = new uint16_t[size];
+    pFft->window = new int16_t[size];
+    pFft->re = new int32_t[size];
+    pFft->im = new int32_t[size];
+
+    for (int k = 0; k < size / 2; k++)
+    {
+        double angle = 2 * M_PI * k / size;
+        pFft->cosTable[k] = (int16_t)lrint(cos(angle) * 32767);
+        pFft->sinTable[k] = (int16_t)lrint(sin(angle) * 32767);
+    }
+    for (int i = 0; i < size; i++)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < pFft->log2Size; bit++)
+            reversed |= ((i >> bit) & 1) << (pFft->log2Size - 1 - bit);
+        pFft->bitReverse[i] = reversed;
+        pFft->window[i] = (int16_t)lrint((0.5 - 0.5 * cos(2 * M_PI * i / size)) * 32767);
+    }
+    return true;
+}
+
+void fftFree(fft_t* pFft)
+{
+    delete[] pFft->cosTable;
+    delete[] pFft->sinTable;
+    delete[] pFft->bitReverse;
+    delete[] pFft->window;
+    delete[] pFft->re;
+    delete[] pFft->im;
+    memset(pFft, 0, sizeof(*pFft));
+}
+
+void fftForward(fft_t* pFft, const int16_t* samples)
+{
+    const int size = pFft->size;
+    int32_t* re = pFft->re;
+    int32_t* im = pFft->im;
+
+    // Window straight into bit-reversed order.
+    for (int i = 0; i < size; i++)
+    {
+        int j = pFft->bitReverse[i];
+        re[j] = (samples[i] * pFft->window[i]) >> 15;
+        im[j] = 0;
+    }
+
+    for (int half = 1, step = size / 2; half < size; half <<= 1, step >>= 1)
+    {
+        for (int k = 0; k < half; k++)
+        {
+            // W = exp(-2 pi i k / (2 half)).
+            int64_t wr = pFft->cosTable[k * step];
+            int64_t wi = -pFft->sinTable[k * step];
+            for (int i = k; i < size; i += 2 * half)
+            {
+                int j = i + half;
+                int32_t tr = (int32_t)((wr * re[j] - wi * im[j]) >> 15);
+                int32_t ti = (int32_t)((wr * im[j] + wi * re[j]) >> 15);
+                re[j] = re[i] - tr;
+                im[j] = im[i] - ti;
+                re[i] += tr;
+                im[i] += ti;
+            }
+        }
+    }
+}
+
+void fftPower(const fft_t* pFft, uint64_t* power)
+{
+    for (int bin = 0; bin <= pFft->size / 2; bin++)
+    {
+        int64_t re = pFft->re[bin];
+        int64_t im = pFft->im[bin];
+        power[bin] = re * re + im * im;
+    }
+}
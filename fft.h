@@ -0,0 +1,43 @@
+/*
+* Fixed-point FFT for the audio visualizer
+* By R. Blansett
+*
+* Radix-2, in place, on 32-bit integers with Q15 twiddles. The twiddles,
+* the bit-reversal permutation and a Hann window are computed once per
+* size, and the work buffers are allocated once, so a transform is only
+* integer multiply-adds. Windowed 16-bit samples grow by at most
+* log2(size) bits through the stages, so at FFT_MAX_SIZE they still fit
+* 32 bits without per-stage scaling (and without its precision loss);
+* products are widened to 64 bits (one smull on ARM).
+*/
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+
+static const int FFT_MIN_SIZE = 16;
+static const int FFT_MAX_SIZE = 4096;
+
+struct fft_t
+{
+    int size;                   // points, a power of two
+    int log2Size;
+    int16_t* cosTable;          // Q15 cos(2 pi k / size), k < size / 2
+    int16_t* sinTable;
+    uint16_t* bitReverse;
+    int16_t* window;            // Q15 Hann window
+    int32_t* re;                // work buffers, reused every transform
+    int32_t* im;
+};
+
+bool fftInit(fft_t* pFft, int size);
+void fftFree(fft_t* pFft);
+
+// Window samples[0 .. size) into re/im and transform them in place.
+void fftForward(fft_t* pFft, const int16_t* samples);
+
+// Power of bins [0, size / 2] after fftForward, in units of samples^2.
+void fftPower(const fft_t* pFft, uint64_t* power);
+
+#endif // FFT_H
@@ -0,0 +1,107 @@
+/*
+* Fixed-point FFT benchmark
+* By R. Blansett
+*
+* Checks the Q15 FFT against a double-precision DFT of the same windowed
+* signal (a few tones plus noise) and times it at the sizes the audio
+* patterns use. At 30 fps a frame is 33 ms; the transform should be a
+* tiny part of that.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "fft.h"
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Signal to noise of the fixed-point spectrum against an exact one, in dB.
+static double checkSize(int size)
+{
+    fft_t fft;
+    fftInit(&fft, size);
+
+    int16_t* samples = new int16_t[size];
+    for (int i = 0; i < size; i++)
+    {
+        double t = (double)i / size;
+        double v = 9000 * sin(2 * M_PI * 5 * t) + 4000 * sin(2 * M_PI * 37.5 * t) +
+            300 * sin(2 * M_PI * (size / 5) * t) + (rand() % 200 - 100);
+        samples[i] = (int16_t)lrint(v);
+    }
+    fftForward(&fft, samples);
+
+    double signal = 0, error = 0;
+    for (int bin = 0; bin <= size / 2; bin++)
+    {
+        double re = 0, im = 0;
+        for (int i = 0; i < size; i++)
+        {
+            double windowed = samples[i] * (0.5 - 0.5 * cos(2 * M_PI * i / size));
+            re += windowed * cos(2 * M_PI * bin * i / size);
+            im -= windowed * sin(2 * M_PI * bin * i / size);
+        }
+        signal += re * re + im * im;
+        error += (re - fft.re[bin]) * (re - fft.re[bin]) + (im - fft.im[bin]) * (im - fft.im[bin]);
+    }
+
+    delete[] samples;
+    fftFree(&fft);
+    return 10 * log10(signal / (error > 0? error : 1e-9));
+}
+
+static void timeSize(int size)
+{
+    fft_t fft;
+    fftInit(&fft, size);
+    int16_t* samples = new int16_t[size];
+    uint64_t* power = new uint64_t[size / 2 + 1];
+    for (int i = 0; i < size; i++)
+        samples[i] = rand() % 20000 - 10000;
+
+    const int runs = 20000;
+    uint64_t sum = 0;
+    double start = now();
+    for (int run = 0; run < runs; run++)
+    {
+        samples[run % size] ^= 1;
+        fftForward(&fft, samples);
+        fftPower(&fft, power);
+        sum += power[run % (size / 2)];
+    }
+    double elapsed = (now() - start) / runs;
+    printf("%5d points  %7.2f us per transform + power  (%.2f%% of a 30 fps frame)  (%08X)\n",
+        size, elapsed * 1e6, elapsed * 30 * 100, (uint32_t)sum);
+
+    delete[] samples;
+    delete[] power;
+    fftFree(&fft);
+}
+
+int main()
+{
+    const int sizes[] = { 256, 512, 1024 };
+    int failures = 0;
+
+    srand(1);
+    for (int i = 0; i < 3; i++)
+    {
+        double snr = checkSize(sizes[i]);
+        printf("%5d points  %5.1f dB SNR against a double DFT  %s\n", sizes[i], snr,
+            snr > 60? "ok" : "POOR");
+        if (snr <= 60)
+            failures++;
+    }
+    for (int i = 0; i < 3; i++)
+        timeSize(sizes[i]);
+
+    return failures? 1 : 0;
+}
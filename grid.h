@@ -0,0 +1,217 @@
+/*
+* Compile-time specialized LED grid for the SPI NEOPixel display
+* By R. Blansett
+*
+* Grid<W, H, ORDER, WIRING> owns one display's RGB frame and its wire
+* image (the SPI bytes plus the REFRESH tail). Size, channel order and
+* wiring are template parameters, so each instantiation gets its own
+* fully specialized encode loops, and any number of displays can live
+* side by side in one process.
+*
+* Each color byte goes out as 4 SPI bytes (2 LED bits per SPI byte, see
+* the _0_0 .. _1_1 symbols); a 256 entry table built at compile time
+* does that in one 4 byte copy.
+*/
+
+// spiled.h includes this file part way through, after the pixel types;
+// pulling it in first keeps either include order working.
+#include "spiled.h"
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdint.h>
+#include <string.h>
+
+enum channelOrder_t
+{
+    ORDER_GRB,          // WS2812 and most NEOPixels
+    ORDER_RGB,
+    ORDER_RGBW,         // white channel is the common part of r, g, b
+};
+
+enum wiring_t
+{
+    WIRING_SERPENTINE,  // row 0 right to left, row 1 left to right, ...
+    WIRING_PROGRESSIVE, // every row left to right
+    WIRING_MAPPED,      // any layout, through a logical -> LED table
+};
+
+struct wireTable_t
+{
+    uint8_t bytes[256][SPI_BYTES_PER_BYTE];
+
+    constexpr wireTable_t() : bytes()
+    {
+        const uint8_t symbols[4] = { _0_0, _0_1, _1_0, _1_1 };
+        for (int value = 0; value < 256; value++)
+        {
+            // Most significant bit pair first.
+            for (int i = 0; i < SPI_BYTES_PER_BYTE; i++)
+                bytes[value][i] = symbols[(value >> (6 - 2 * i)) & 0x03];
+        }
+    }
+};
+
+static constexpr wireTable_t WIRE_TABLE;
+
+template <int W, int H, channelOrder_t ORDER, wiring_t WIRING>
+class Grid
+{
+public:
+    static const int WIDTH = W;
+    static const int HEIGHT = H;
+    static const int AREA = W * H;
+    static const int CHANNELS = ORDER == ORDER_RGBW? 4 : 3;
+    static const int WIRE_PIXEL_SIZE = CHANNELS * SPI_BYTES_PER_BYTE;
+    static const int WIRE_SIZE = AREA * WIRE_PIXEL_SIZE;
+    static const int TX_SIZE = WIRE_SIZE + REFRESH_SIZE;
+
+    rgbPixel_t rgb[AREA];
+    uint8_t tx[TX_SIZE];
+
+    // Logical index -> LED index, for WIRING_MAPPED.
+    const uint16_t* map;
+
+    explicit Grid(const uint16_t* ledMap = NULL) : map(ledMap)
+    {
+        clear();
+    }
+
+    // Black frame, all-zero wire image, REFRESH tail.
+    void clear()
+    {
+        memset(rgb, 0, sizeof(rgb));
+        const rgbPixel_t black = { 0, 0, 0, 0 };
+        for (int led = 0; led < AREA; led++)
+            encodePixel(&tx[led * WIRE_PIXEL_SIZE], black);
+        memset(&tx[WIRE_SIZE], REFRESH, REFRESH_SIZE);
+    }
+
+    // Wire bytes for one color, in this grid's channel order.
+    static inline void encodePixel(uint8_t* out, const rgbPixel_t& pixel)
+    {
+        switch (ORDER)
+        {
+            case ORDER_GRB:
+                memcpy(out, WIRE_TABLE.bytes[pixel.g], SPI_BYTES_PER_BYTE);
+                memcpy(out + 4, WIRE_TABLE.bytes[pixel.r], SPI_BYTES_PER_BYTE);
+                memcpy(out + 8, WIRE_TABLE.bytes[pixel.b], SPI_BYTES_PER_BYTE);
+                break;
+
+            case ORDER_RGB:
+                memcpy(out, WIRE_TABLE.bytes[pixel.r], SPI_BYTES_PER_BYTE);
+                memcpy(out + 4, WIRE_TABLE.bytes[pixel.g], SPI_BYTES_PER_BYTE);
+                memcpy(out + 8, WIRE_TABLE.bytes[pixel.b], SPI_BYTES_PER_BYTE);
+                break;
+
+            case ORDER_RGBW:
+            {
+                uint8_t w = pixel.r < pixel.g? pixel.r : pixel.g;
+                w = pixel.b < w? pixel.b : w;
+                memcpy(out, WIRE_TABLE.bytes[pixel.r - w], SPI_BYTES_PER_BYTE);
+                memcpy(out + 4, WIRE_TABLE.bytes[pixel.g - w], SPI_BYTES_PER_BYTE);
+                memcpy(out + 8, WIRE_TABLE.bytes[pixel.b - w], SPI_BYTES_PER_BYTE);
+                memcpy(out + 12, WIRE_TABLE.bytes[w], SPI_BYTES_PER_BYTE);
+                break;
+            }
+        }
+    }
+
+    // LED position of logical (col, row).
+    inline int ledIndex(int row, int col) const
+    {
+        switch (WIRING)
+        {
+            case WIRING_SERPENTINE:
+                return row * W + ((row & 1)? col : W - 1 - col);
+            case WIRING_PROGRESSIVE:
+                return row * W + col;
+            default:
+                return map[row * W + col];
+        }
+    }
+
+    uint8_t* wirePixel(int row, int col)
+    {
+        return &tx[ledIndex(row, col) * WIRE_PIXEL_SIZE];
+    }
+
+    // Re-encode the whole frame into tx.
+    void encode()
+    {
+        for (int row = 0; row < H; row++)
+            encodeRow(row);
+    }
+
+    // Re-encode just these rows; the rest of tx is left as it was.
+    void encodeRows(rowMask_t rows)
+    {
+        static_assert(H <= 64, "row masks are 64 bits");
+        for (int row = 0; row < H; row++)
+        {
+            if (rows & ((rowMask_t)1 << row))
+                encodeRow(row);
+        }
+    }
+
+    inline void encodeRow(int row)
+    {
+        const rgbPixel_t* pIn = &rgb[row * W];
+
+        if (WIRING == WIRING_MAPPED)
+        {
+            const uint16_t* pMap = &map[row * W];
+            for (int col = 0; col < W; col++)
+                encodePixel(&tx[pMap[col] * WIRE_PIXEL_SIZE], pIn[col]);
+        }
+        else if (WIRING == WIRING_SERPENTINE && !(row & 1))
+        {
+            // Reversed row: walk the wire backwards from the row's end.
+            uint8_t* pOut = &tx[((row + 1) * W - 1) * WIRE_PIXEL_SIZE];
+            for (int col = 0; col < W; col++, pOut -= WIRE_PIXEL_SIZE)
+                encodePixel(pOut, pIn[col]);
+        }
+        else
+        {
+            uint8_t* pOut = &tx[row * W * WIRE_PIXEL_SIZE];
+            for (int col = 0; col < W; col++, pOut += WIRE_PIXEL_SIZE)
+                encodePixel(pOut, pIn[col]);
+        }
+    }
+
+    // Indexed frames: one byte per pixel, and palette[i] is entry i already
+    // in wire form (see palette.h), so each pixel is a single copy.
+    void encodeIndexed(const uint8_t* indices, const uint8_t (*palette)[WIRE_PIXEL_SIZE])
+    {
+        for (int row = 0; row < H; row++)
+            encodeIndexedRow(row, indices, palette);
+    }
+
+    inline void encodeIndexedRow(int row, const uint8_t* indices,
+        const uint8_t (*palette)[WIRE_PIXEL_SIZE])
+    {
+        const uint8_t* pIn = &indices[row * W];
+
+        if (WIRING == WIRING_MAPPED)
+        {
+            const uint16_t* pMap = &map[row * W];
+            for (int col = 0; col < W; col++)
+                memcpy(&tx[pMap[col] * WIRE_PIXEL_SIZE], palette[pIn[col]], WIRE_PIXEL_SIZE);
+        }
+        else if (WIRING == WIRING_SERPENTINE && !(row & 1))
+        {
+            uint8_t* pOut = &tx[((row + 1) * W - 1) * WIRE_PIXEL_SIZE];
+            for (int col = 0; col < W; col++, pOut -= WIRE_PIXEL_SIZE)
+                memcpy(pOut, palette[pIn[col]], WIRE_PIXEL_SIZE);
+        }
+        else
+        {
+            uint8_t* pOut = &tx[row * W * WIRE_PIXEL_SIZE];
+            for (int col = 0; col < W; col++, pOut += WIRE_PIXEL_SIZE)
+                memcpy(pOut, palette[pIn[col]], WIRE_PIXEL_SIZE);
+        }
+    }
+};
+
+#endif // GRID_H
@@ -0,0 +1,185 @@
+/*
+* Grid encode benchmark
+* By R. Blansett
+*
+* Runs several Grid<> instantiations side by side in one process, checks
+* that the 16x16 GRB ones produce exactly the bytes of the original
+* encoder (makeSpiPixel per pixel, row & 1 test, copy into txBuffer),
+* and times both. The indexed encode is checked against the RGB one and
+* timed the same way.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "palette.h"
+
+typedef Grid<GRID_WIDTH, GRID_HEIGHT, ORDER_GRB, WIRING_SERPENTINE> serpentine_t;
+typedef Grid<GRID_WIDTH, GRID_HEIGHT, ORDER_GRB, WIRING_MAPPED> mapped_t;
+typedef Grid<GRID_WIDTH, GRID_HEIGHT, ORDER_RGBW, WIRING_SERPENTINE> rgbw_t;
+typedef Grid<32, 8, ORDER_RGB, WIRING_PROGRESSIVE> strip_t;
+
+// The encoder spiled.cpp used before Grid<>.
+static spiRgbPixel_t legacyGrid[GRID_AREA];
+static uint8_t legacyTx[GRID_AREA * sizeof(spiRgbPixel_t) + REFRESH_SIZE];
+
+static void legacyEncode(const rgbPixel_t* rgb)
+{
+    for (int row = 0; row < GRID_HEIGHT; row++)
+    {
+        for (int col = 0; col < GRID_WIDTH; col++)
+        {
+            int led = row * GRID_WIDTH + ((row & 1)? col : GRID_WIDTH - 1 - col);
+            makeSpiPixel(legacyGrid[led], rgb[row * GRID_WIDTH + col]);
+        }
+    }
+    memcpy(legacyTx, legacyGrid, sizeof(legacyGrid));
+    memset(&legacyTx[sizeof(legacyGrid)], REFRESH, REFRESH_SIZE);
+}
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+template <class G> static void randomFill(G& grid)
+{
+    for (int i = 0; i < G::AREA; i++)
+        makeRgbPixel(grid.rgb[i], rand() & 0xFF, rand() & 0xFF, rand() & 0xFF);
+}
+
+// Frames per second for encode(), with a checksum so nothing is optimized away.
+template <class G> static void timeEncode(const char* name, G& grid)
+{
+    const int frames = 200000;
+    uint32_t sum = 0;
+    double start = now();
+    for (int i = 0; i < frames; i++)
+    {
+        grid.rgb[i % G::AREA].r = i & 0x3F;
+        grid.encode();
+        sum += grid.tx[i % G::WIRE_SIZE];
+    }
+    double elapsed = now() - start;
+    printf("%-28s %4dx%-3d %5d bytes  %8.0f frames/s  %6.1f ns/pixel  (%08X)\n",
+        name, G::WIDTH, G::HEIGHT, G::TX_SIZE, frames / elapsed,
+        elapsed * 1e9 / frames / G::AREA, sum);
+}
+
+// The same for encodeIndexed(), with a palette entry changing each frame.
+template <class G> static void timeIndexed(const char* name, G& grid,
+    const uint8_t* indices, palette_t* pPalette)
+{
+    const int frames = 200000;
+    uint32_t sum = 0;
+    double start = now();
+    for (int i = 0; i < frames; i++)
+    {
+        rgbPixel_t color = makeRgbPixel(color, i & 0x3F, 0, 0);
+        paletteSet(pPalette, i % pPalette->count, color);
+        grid.encodeIndexed(indices, pPalette->wire);
+        sum += grid.tx[i % G::WIRE_SIZE];
+    }
+    double elapsed = now() - start;
+    printf("%-28s %4dx%-3d %5d bytes  %8.0f frames/s  %6.1f ns/pixel  (%08X)\n",
+        name, G::WIDTH, G::HEIGHT, G::TX_SIZE, frames / elapsed,
+        elapsed * 1e9 / frames / G::AREA, sum);
+}
+
+static void timeLegacy(rgbPixel_t* rgb)
+{
+    const int frames = 200000;
+    uint32_t sum = 0;
+    double start = now();
+    for (int i = 0; i < frames; i++)
+    {
+        rgb[i % GRID_AREA].r = i & 0x3F;
+        legacyEncode(rgb);
+        sum += legacyTx[i % (GRID_AREA * sizeof(spiRgbPixel_t))];
+    }
+    double elapsed = now() - start;
+    printf("%-28s %4dx%-3d %5d bytes  %8.0f frames/s  %6.1f ns/pixel  (%08X)\n",
+        "legacy makeSpiPixel", GRID_WIDTH, GRID_HEIGHT, (int)sizeof(legacyTx),
+        frames / elapsed, elapsed * 1e9 / frames / GRID_AREA, sum);
+}
+
+int main()
+{
+    // spiled's default panel: serpentine with row 0 reversed.
+    static uint16_t serpentineMap[GRID_AREA];
+    for (int row = 0; row < GRID_HEIGHT; row++)
+        for (int col = 0; col < GRID_WIDTH; col++)
+            serpentineMap[row * GRID_WIDTH + col] =
+                row * GRID_WIDTH + ((row & 1)? col : GRID_WIDTH - 1 - col);
+
+    static serpentine_t serpentine;
+    static mapped_t mapped(serpentineMap);
+    static rgbw_t rgbw;
+    static strip_t strip;
+
+    srand(1);
+    randomFill(serpentine);
+    memcpy(mapped.rgb, serpentine.rgb, sizeof(serpentine.rgb));
+    randomFill(rgbw);
+    randomFill(strip);
+
+    // Every possible byte value, through both encoders.
+    int mismatches = 0;
+    for (int pass = 0; pass < 256; pass++)
+    {
+        for (int i = 0; i < GRID_AREA; i++)
+        {
+            rgbPixel_t& pixel = serpentine.rgb[i];
+            pixel.r = pass;
+            pixel.g = pass + i;
+            pixel.b = pass ^ i;
+        }
+        memcpy(mapped.rgb, serpentine.rgb, sizeof(serpentine.rgb));
+        serpentine.encode();
+        mapped.encode();
+        legacyEncode(serpentine.rgb);
+        if (memcmp(serpentine.tx, legacyTx, sizeof(legacyTx)) != 0 ||
+            memcmp(mapped.tx, legacyTx, sizeof(legacyTx)) != 0)
+        {
+            mismatches++;
+        }
+    }
+    printf("Wire bytes vs legacy encoder: %s\n", mismatches? "MISMATCH" : "identical");
+
+    // Indexed: a 64 color frame, through the palette and through RGB.
+    static uint8_t indices[GRID_AREA];
+    static palette_t palette;
+    static serpentine_t indexed;
+    static mapped_t indexedMapped(serpentineMap);
+    for (int i = 0; i < GRID_AREA; i++)
+        makeRgbPixel(serpentine.rgb[i], (i & 3) * 20, ((i >> 2) & 3) * 20, ((i >> 4) & 3) * 20);
+    if (!paletteIndexFrame(&palette, serpentine.rgb, GRID_AREA, indices))
+        mismatches++;
+    serpentine.encode();
+    indexed.encodeIndexed(indices, palette.wire);
+    indexedMapped.encodeIndexed(indices, palette.wire);
+    bool indexedOk = memcmp(indexed.tx, serpentine.tx, sizeof(indexed.tx)) == 0 &&
+        memcmp(indexedMapped.tx, serpentine.tx, sizeof(indexed.tx)) == 0;
+    if (!indexedOk)
+        mismatches++;
+    printf("Indexed (%d colors) vs RGB encode: %s\n", palette.count,
+        indexedOk? "identical" : "MISMATCH");
+
+    static rgbPixel_t legacyRgb[GRID_AREA];
+    memcpy(legacyRgb, serpentine.rgb, sizeof(legacyRgb));
+    timeLegacy(legacyRgb);
+    timeEncode("Grid GRB serpentine", serpentine);
+    timeEncode("Grid GRB mapped", mapped);
+    timeEncode("Grid RGBW serpentine", rgbw);
+    timeEncode("Grid RGB progressive", strip);
+    timeIndexed("Grid GRB serpentine indexed", indexed, indices, &palette);
+    timeIndexed("Grid GRB mapped indexed", indexedMapped, indices, &palette);
+
+    return mismatches? 1 : 0;
+}
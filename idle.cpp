@@ -0,0 +1,55 @@
+/*
+* Idle-frame suppression for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <string.h>
+
+#include "idle.h"
+
+void idleInit(idleFilter_t* pIdle, int keepaliveMs)
+{
+    memset(pIdle, 0, sizeof(*pIdle));
+    pIdle->keepaliveMs = keepaliveMs;
+}
+
+uint64_t idleHash(const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = 0xCBF29CE484222325ull ^ len;
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 32;
+    }
+    for (; len > 0; len--, p++)
+        h = (h ^ *p) * 0x100000001B3ull;
+    return h;
+}
+
+static long msSince(const struct timespec& then, const struct timespec& now)
+{
+    return (now.tv_sec - then.tv_sec) * 1000L + (now.tv_nsec - then.tv_nsec) / 1000000L;
+}
+
+bool idleShouldSend(idleFilter_t* pIdle, const void* frame, size_t len)
+{
+    uint64_t hash = idleHash(frame, len);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (pIdle->keepaliveMs > 0 && pIdle->primed && hash == pIdle->lastHash &&
+        msSince(pIdle->lastSent, now) < pIdle->keepaliveMs)
+    {
+        pIdle->suppressed++;
+        return false;
+    }
+
+    pIdle->primed = true;
+    pIdle->lastHash = hash;
+    pIdle->lastSent = now;
+    pIdle->sent++;
+    return true;
+}
@@ -0,0 +1,40 @@
+/*
+* Idle-frame suppression for the SPI NEOPixel display
+* By R. Blansett
+*
+* The LEDs hold the last frame they latched, so sending the same bytes
+* again only burns SPI bandwidth and CPU. The filter keeps a hash of the
+* last frame sent and skips identical ones, except that it still resends
+* once every keepalive interval (in case an LED glitched or was plugged
+* in since).
+*/
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+static const int DEFAULT_KEEPALIVE_MS = 1000;
+
+struct idleFilter_t
+{
+    int keepaliveMs;            // 0 = never suppress
+    bool primed;                // something has been sent
+    uint64_t lastHash;
+    struct timespec lastSent;
+
+    uint32_t sent;
+    uint32_t suppressed;
+};
+
+void idleInit(idleFilter_t* pIdle, int keepaliveMs);
+
+// 64-bit hash of a frame, 8 bytes per step.
+uint64_t idleHash(const void* data, size_t len);
+
+// Should this frame go out? Counts it as sent or suppressed.
+bool idleShouldSend(idleFilter_t* pIdle, const void* frame, size_t len);
+
+#endif // IDLE_H
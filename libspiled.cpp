@@ -0,0 +1,494 @@
+/*
+* libspiled: C API for the SPI NEOPixel 16x16 RGB LED display
+* By R. Blansett
+*/
+
+#include <stdint.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include <linux/spi/spidev.h>
+
+#include "libspiled.h"
+#include "spiled.h"
+#include "pixelmap.h"
+#include "idle.h"
+#include "present.h"
+#include "batch.h"
+
+static_assert(sizeof(spiledPixel_t) == sizeof(rgbPixel_t), "pixel layouts must match");
+
+struct spiled
+{
+    int fd;
+    spiledConfig_t config;
+    uint16_t map[GRID_AREA];    // this handle's layout; frames point at it
+
+    // Two frames with their own wire images: one to draw, one in flight.
+    display_t* frames[2];
+    int back;
+
+    idleFilter_t idle;
+    spiledStats_t stats;
+
+    // Transmit thread, started by the first non-blocking present.
+    pthread_t thread;
+    bool threadStarted;
+    pthread_mutex_t lock;       // guards everything below, idle and stats
+    pthread_cond_t changed;
+    bool inFlight;
+    int sendIndex;
+    bool stop;
+
+    // Presentation queue, started by the first spiledSubmit.
+    presentQueue_t queue;
+    bool queueStarted;
+    display_t* queued;          // frame the scheduler is sending
+
+    // spiledWriteBatch's transfer list, grown to the largest batch seen.
+    struct spi_ioc_transfer* batch;
+    int batchCapacity;
+};
+
+static long usecsSince(const struct timespec& start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000000L + (now.tv_nsec - start.tv_nsec) / 1000L;
+}
+
+static int transfer(spiled_t* pLed, const uint8_t* wire, size_t len)
+{
+    // The LEDs never talk back, so there is no receive buffer.
+    struct spi_ioc_transfer tr;
+    memset(&tr, 0, sizeof(tr));
+    tr.tx_buf = (unsigned long)wire;
+    tr.len = len;
+    tr.speed_hz = pLed->config.speedHz;
+    tr.delay_usecs = pLed->config.delayUsecs;
+    tr.bits_per_word = pLed->config.bits;
+
+    return ioctl(pLed->fd, SPI_IOC_MESSAGE(1), &tr) < 1? -1 : 0;
+}
+
+// Encode one frame and put it on the wire (unless it is unchanged).
+static int sendFrame(spiled_t* pLed, display_t* pFrame)
+{
+    pFrame->encode();
+    pthread_mutex_lock(&pLed->lock);
+    bool changed = idleShouldSend(&pLed->idle, pFrame->tx, sizeof(pFrame->tx));
+    if (!changed)
+        pLed->stats.suppressed++;
+    pthread_mutex_unlock(&pLed->lock);
+    if (!changed)
+        return 0;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ret = transfer(pLed, pFrame->tx, sizeof(pFrame->tx));
+    int err = errno;
+
+    pthread_mutex_lock(&pLed->lock);
+    if (ret < 0)
+    {
+        pLed->stats.errors++;
+    }
+    else
+    {
+        pLed->stats.sent++;
+        pLed->stats.bytes += sizeof(pFrame->tx);
+        pLed->stats.lastTransferUsecs = usecsSince(start);
+    }
+    pthread_mutex_unlock(&pLed->lock);
+
+    errno = err;
+    return ret;
+}
+
+static void* transmitThread(void* arg)
+{
+    spiled_t* pLed = (spiled_t*)arg;
+
+    pthread_mutex_lock(&pLed->lock);
+    while (true)
+    {
+        while (!pLed->inFlight && !pLed->stop)
+            pthread_cond_wait(&pLed->changed, &pLed->lock);
+        if (pLed->stop)
+            break;
+
+        display_t* pFrame = pLed->frames[pLed->sendIndex];
+        pthread_mutex_unlock(&pLed->lock);
+        sendFrame(pLed, pFrame);
+        pthread_mutex_lock(&pLed->lock);
+
+        pLed->inFlight = false;
+        pthread_cond_broadcast(&pLed->changed);
+    }
+    pthread_mutex_unlock(&pLed->lock);
+    return NULL;
+}
+
+static void queueSink(void* ctx, const void* frame)
+{
+    spiled_t* pLed = (spiled_t*)ctx;
+    memcpy(pLed->queued->rgb, frame, sizeof(pLed->queued->rgb));
+    sendFrame(pLed, pLed->queued);
+}
+
+int spiledApiVersion(void)
+{
+    return SPILED_API_VERSION;
+}
+
+void spiledDefaultConfig(spiledConfig_t* pConfig)
+{
+    memset(pConfig, 0, sizeof(*pConfig));
+    pConfig->size = sizeof(*pConfig);
+    pConfig->speedHz = 8000000;
+    pConfig->bits = 8;
+    pConfig->layout = NULL;
+    pConfig->keepaliveMs = DEFAULT_KEEPALIVE_MS;
+    pConfig->queueFps = 60;
+    pConfig->queueDepth = DEFAULT_PRESENT_DEPTH;
+}
+
+spiled_t* spiledOpen(const char* device, const spiledConfig_t* pConfig)
+{
+    spiledConfig_t config;
+    spiledDefaultConfig(&config);
+    if (pConfig != NULL)
+    {
+        // Older callers pass a shorter struct; the rest keep their defaults.
+        size_t size = pConfig->size < sizeof(config)? pConfig->size : sizeof(config);
+        memcpy(&config, pConfig, size);
+        config.size = sizeof(config);
+    }
+
+    uint16_t map[GRID_AREA];
+    if (!pixelMapBuild(config.layout != NULL? config.layout : DEFAULT_LAYOUT, map))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int fd = open(device, O_RDWR);
+    if (fd < 0)
+        return NULL;
+
+    if (ioctl(fd, SPI_IOC_WR_MODE, &config.mode) == -1 ||
+        ioctl(fd, SPI_IOC_RD_MODE, &config.mode) == -1 ||
+        ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &config.bits) == -1 ||
+        ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &config.bits) == -1 ||
+        ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &config.speedHz) == -1 ||
+        ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &config.speedHz) == -1)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+
+    if (!config.quiet)
+    {
+        printf("spi mode: %d\n", config.mode);
+        printf("bits per word: %d\n", config.bits);
+        printf("max speed: %d Hz (%d KHz)\n", config.speedHz, config.speedHz/1000);
+    }
+
+    spiled_t* pLed = new spiled;
+    pLed->fd = fd;
+    pLed->config = config;
+    memcpy(pLed->map, map, sizeof(pLed->map));
+    pLed->frames[0] = new display_t(pLed->map);
+    pLed->frames[1] = new display_t(pLed->map);
+    pLed->back = 0;
+    idleInit(&pLed->idle, config.keepaliveMs);
+    memset(&pLed->stats, 0, sizeof(pLed->stats));
+    pLed->stats.size = sizeof(pLed->stats);
+    pLed->threadStarted = false;
+    pthread_mutex_init(&pLed->lock, NULL);
+    pthread_cond_init(&pLed->changed, NULL);
+    pLed->inFlight = false;
+    pLed->sendIndex = 0;
+    pLed->stop = false;
+    pLed->queueStarted = false;
+    pLed->queued = NULL;
+    pLed->batch = NULL;
+    pLed->batchCapacity = 0;
+
+    return pLed;
+}
+
+void spiledClose(spiled_t* pLed)
+{
+    if (pLed == NULL)
+        return;
+
+    spiledWait(pLed);
+    if (pLed->queueStarted)
+        presentFree(&pLed->queue);
+    if (pLed->threadStarted)
+    {
+        pthread_mutex_lock(&pLed->lock);
+        pLed->stop = true;
+        pthread_cond_broadcast(&pLed->changed);
+        pthread_mutex_unlock(&pLed->lock);
+        pthread_join(pLed->thread, NULL);
+    }
+
+    pthread_cond_destroy(&pLed->changed);
+    pthread_mutex_destroy(&pLed->lock);
+    close(pLed->fd);
+    delete pLed->frames[0];
+    delete pLed->frames[1];
+    delete pLed->queued;
+    free(pLed->batch);
+    delete pLed;
+}
+
+int spiledWidth(const spiled_t*)
+{
+    return display_t::WIDTH;
+}
+
+int spiledHeight(const spiled_t*)
+{
+    return display_t::HEIGHT;
+}
+
+spiledPixel_t* spiledFrame(spiled_t* pLed)
+{
+    return (spiledPixel_t*)pLed->frames[pLed->back]->rgb;
+}
+
+int spiledPresent(spiled_t* pLed, int flags)
+{
+    if (flags & SPILED_NONBLOCK)
+    {
+        pthread_mutex_lock(&pLed->lock);
+        if (pLed->inFlight)
+        {
+            pLed->stats.busy++;
+            pthread_mutex_unlock(&pLed->lock);
+            return SPILED_BUSY;
+        }
+        if (!pLed->threadStarted)
+        {
+            if (pthread_create(&pLed->thread, NULL, transmitThread, pLed) != 0)
+            {
+                pthread_mutex_unlock(&pLed->lock);
+                errno = EAGAIN;
+                return -1;
+            }
+            pLed->threadStarted = true;
+        }
+
+        // Hand the drawn frame over and give the caller the other one.
+        pLed->sendIndex = pLed->back;
+        pLed->back ^= 1;
+        pLed->inFlight = true;
+        pLed->stats.presented++;
+        pthread_cond_broadcast(&pLed->changed);
+        pthread_mutex_unlock(&pLed->lock);
+        return 0;
+    }
+
+    spiledWait(pLed);
+    pthread_mutex_lock(&pLed->lock);
+    pLed->stats.presented++;
+    pthread_mutex_unlock(&pLed->lock);
+    return sendFrame(pLed, pLed->frames[pLed->back]);
+}
+
+int spiledSubmit(spiled_t* pLed, const spiledPixel_t* frame, int64_t targetNs)
+{
+    if (!pLed->queueStarted)
+    {
+        pLed->queued = new display_t(pLed->map);
+        if (!presentInit(&pLed->queue, sizeof(pLed->queued->rgb), pLed->config.queueDepth,
+            pLed->config.queueFps, queueSink, pLed))
+        {
+            delete pLed->queued;
+            pLed->queued = NULL;
+            errno = ENOMEM;
+            return -1;
+        }
+        pLed->queueStarted = true;
+    }
+
+    presentSubmit(&pLed->queue, frame, targetNs);
+    return 0;
+}
+
+int64_t spiledNow(void)
+{
+    return presentNow();
+}
+
+void spiledWait(spiled_t* pLed)
+{
+    if (pLed->queueStarted)
+        presentFlush(&pLed->queue);
+
+    pthread_mutex_lock(&pLed->lock);
+    while (pLed->inFlight)
+        pthread_cond_wait(&pLed->changed, &pLed->lock);
+    pthread_mutex_unlock(&pLed->lock);
+}
+
+int spiledWrite(spiled_t* pLed, const uint8_t* wire, size_t len)
+{
+    int ret = transfer(pLed, wire, len);
+    int err = errno;
+
+    pthread_mutex_lock(&pLed->lock);
+    pLed->stats.rawTransfers++;
+    if (ret < 0)
+        pLed->stats.errors++;
+    else
+        pLed->stats.bytes += len;
+    pthread_mutex_unlock(&pLed->lock);
+
+    errno = err;
+    return ret;
+}
+
+// Transfers idling delayUsecs after the one at pTr (which may carry data);
+// returns how many were used.
+static int addDelay(struct spi_ioc_transfer* pTr, uint32_t delayUsecs, uint32_t speedHz)
+{
+    int used = 0;
+    do
+    {
+        pTr[used].speed_hz = speedHz;
+        pTr[used].delay_usecs = delayUsecs > MAX_DELAY_USECS? MAX_DELAY_USECS : delayUsecs;
+        delayUsecs -= pTr[used].delay_usecs;
+        used++;
+    } while (delayUsecs > 0);
+    return used;
+}
+
+int spiledWriteBatch(spiled_t* pLed, const uint8_t* wire, size_t frameLen, int count,
+    uint32_t gapUsecs)
+{
+    // Whatever is in flight or queued goes first, so the batch's frames
+    // follow it on the wire and the idle filter sees them in order.
+    spiledWait(pLed);
+
+    // Worst case every frame is suppressed and idles its whole period.
+    uint32_t wireUsecs = (uint32_t)((uint64_t)frameLen * 8 * 1000000 / pLed->config.speedHz);
+    int perFrame = batchTransfersPerFrame(wireUsecs + gapUsecs);
+    int worst = count * perFrame;
+    if (count < 1 || worst > MAX_TRANSFERS)
+    {
+        errno = E2BIG;
+        return -1;
+    }
+    if (worst > pLed->batchCapacity)
+    {
+        struct spi_ioc_transfer* batch = (struct spi_ioc_transfer*)
+            realloc(pLed->batch, worst * sizeof(struct spi_ioc_transfer));
+        if (batch == NULL)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        pLed->batch = batch;
+        pLed->batchCapacity = worst;
+    }
+
+    // An unchanged frame stays in the batch as idle time of the same
+    // length, so the kernel's pacing of the others holds.
+    struct spi_ioc_transfer* pTr = pLed->batch;
+    memset(pTr, 0, worst * sizeof(struct spi_ioc_transfer));
+    int used = 0;
+    int sent = 0;
+    pthread_mutex_lock(&pLed->lock);
+    for (int i = 0; i < count; i++)
+    {
+        const uint8_t* frame = wire + i * frameLen;
+        if (idleShouldSend(&pLed->idle, frame, frameLen))
+        {
+            pTr[used].tx_buf = (unsigned long)frame;
+            pTr[used].len = frameLen;
+            pTr[used].bits_per_word = pLed->config.bits;
+            used += addDelay(&pTr[used], gapUsecs, pLed->config.speedHz);
+            sent++;
+        }
+        else
+        {
+            used += addDelay(&pTr[used], wireUsecs + gapUsecs, pLed->config.speedHz);
+        }
+    }
+    pthread_mutex_unlock(&pLed->lock);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ret = ioctl(pLed->fd, SPI_IOC_MESSAGE(used), pTr) < 0? -1 : 0;
+    int err = errno;
+
+    pthread_mutex_lock(&pLed->lock);
+    pLed->stats.batches++;
+    pLed->stats.suppressed += count - sent;
+    if (ret < 0)
+    {
+        pLed->stats.errors++;
+    }
+    else
+    {
+        pLed->stats.sent += sent;
+        pLed->stats.bytes += (uint64_t)sent * frameLen;
+        pLed->stats.lastTransferUsecs = usecsSince(start);
+    }
+    pthread_mutex_unlock(&pLed->lock);
+
+    errno = err;
+    return ret < 0? -1 : sent;
+}
+
+uint32_t spiledSpeed(const spiled_t* pLed)
+{
+    return pLed->config.speedHz;
+}
+
+int spiledFd(const spiled_t* pLed)
+{
+    return pLed->fd;
+}
+
+int spiledGetStats(const spiled_t* pLed, spiledStats_t* pStats)
+{
+    if (pStats == NULL || pStats->size < sizeof(uint32_t))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t size = pStats->size < sizeof(pLed->stats)? pStats->size : sizeof(pLed->stats);
+    spiledStats_t stats;
+    pthread_mutex_lock((pthread_mutex_t*)&pLed->lock);
+    stats = pLed->stats;
+    pthread_mutex_unlock((pthread_mutex_t*)&pLed->lock);
+
+    if (pLed->queueStarted)
+    {
+        presentQueue_t* pQueue = (presentQueue_t*)&pLed->queue;
+        pthread_mutex_lock(&pQueue->lock);
+        stats.submitted = pQueue->submitted;
+        stats.late = pQueue->late;
+        stats.superseded = pQueue->superseded + pQueue->overflows;
+        stats.maxErrorUsecs = pQueue->maxErrorNs / 1000;
+        pthread_mutex_unlock(&pQueue->lock);
+    }
+    memcpy(pStats, &stats, size);
+    pStats->size = size;
+    return 0;
+}
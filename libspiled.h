@@ -0,0 +1,157 @@
+/*
+* libspiled: C API for the SPI NEOPixel 16x16 RGB LED display
+* By R. Blansett
+*
+* The conversion and transfer core of spitest, for applications that
+* want to drive the display in-process instead of exec'ing spitest.
+* Built as libspiled.so and libspiled.a by mk.
+*
+* Typical use:
+*
+*   spiledConfig_t config;
+*   spiledDefaultConfig(&config);
+*   spiled_t* pLed = spiledOpen("/dev/spidev0.0", &config);
+*   while (running)
+*   {
+*       spiledPixel_t* frame = spiledFrame(pLed);   // draw straight into it
+*       ...
+*       spiledPresent(pLed, SPILED_BLOCK);
+*   }
+*   spiledClose(pLed);
+*
+* The handle owns two frames. A blocking present encodes and sends the
+* frame you drew, and it stays yours to keep drawing on. A non-blocking
+* present hands that frame to a transmit thread and gives you the other
+* one back, which still holds the frame presented before it (redraw it
+* fully, or copy). If the previous frame is still going out, it returns
+* SPILED_BUSY and nothing changes.
+*
+* Frames produced on their own clock (a media player, a network feed)
+* can instead be submitted with a CLOCK_MONOTONIC target time; a
+* scheduler thread puts each up in the frame slot nearest that time and
+* drops the ones whose slot has passed (see present.h). Use either
+* spiledPresent or spiledSubmit on a handle, not both.
+*
+* The ABI is stable: structs start with their own size, so fields are
+* only ever added at the end. Errors return -1 (or NULL) with errno set.
+*/
+
+#ifndef LIBSPILED_H
+#define LIBSPILED_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPILED_API __attribute__((visibility("default")))
+
+#define SPILED_API_VERSION  3
+
+#define SPILED_BLOCK        0
+#define SPILED_NONBLOCK     1
+
+#define SPILED_BUSY         1   // spiledPresent: previous frame still in flight
+
+typedef struct spiled spiled_t;
+
+// Same layout as spiled's rgbPixel_t; a is unused by the display.
+typedef struct
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} spiledPixel_t;
+
+typedef struct
+{
+    uint32_t size;              // sizeof(spiledConfig_t)
+    uint32_t speedHz;           // SPI clock
+    uint8_t mode;               // SPI_MODE_* flags
+    uint8_t bits;               // bits per word
+    uint16_t delayUsecs;        // after each transfer
+    const char* layout;         // LED wiring (see pixelmap.h), NULL = default
+    int keepaliveMs;            // resend unchanged frames this often; 0 = always send
+    int quiet;                  // don't print the SPI settings on open
+    int queueFps;               // spiledSubmit: frame slots per second
+    int queueDepth;             // spiledSubmit: most frames waiting
+} spiledConfig_t;
+
+typedef struct
+{
+    uint32_t size;              // sizeof(spiledStats_t)
+    uint32_t presented;         // spiledPresent calls that took a frame
+    uint32_t busy;              // non-blocking presents refused
+    uint32_t sent;              // frames put on the wire
+    uint32_t suppressed;        // unchanged frames not resent
+    uint32_t rawTransfers;      // spiledWrite calls
+    uint64_t bytes;             // total bytes sent
+    uint32_t errors;            // failed transfers
+    uint32_t lastTransferUsecs; // duration of the latest frame transfer
+    uint32_t submitted;         // spiledSubmit calls
+    uint32_t late;              // submitted frames dropped, their slot had passed
+    uint32_t superseded;        // replaced by a later frame in their slot, or
+                                // pushed out of a full queue
+    uint32_t maxErrorUsecs;     // worst |presented - target| so far
+    uint32_t batches;           // spiledWriteBatch calls
+} spiledStats_t;
+
+SPILED_API int spiledApiVersion(void);
+
+SPILED_API void spiledDefaultConfig(spiledConfig_t* pConfig);
+
+// Open and configure the SPI device (and build the handle's own LED map
+// for the layout, so handles with different layouts don't interfere). Both frames start black; nothing is sent until a present.
+SPILED_API spiled_t* spiledOpen(const char* device, const spiledConfig_t* pConfig);
+
+// Waits for any frame in flight, then closes the device.
+SPILED_API void spiledClose(spiled_t* pLed);
+
+SPILED_API int spiledWidth(const spiled_t* pLed);
+SPILED_API int spiledHeight(const spiled_t* pLed);
+
+// The frame to draw into: width * height pixels, row-major, row 0 at top.
+SPILED_API spiledPixel_t* spiledFrame(spiled_t* pLed);
+
+// Encode the frame and send it. Returns 0, SPILED_BUSY, or -1.
+SPILED_API int spiledPresent(spiled_t* pLed, int flags);
+
+// Queue a copy of frame (width * height pixels) to go up at targetNs on
+// the CLOCK_MONOTONIC clock. Returns 0 or -1.
+SPILED_API int spiledSubmit(spiled_t* pLed, const spiledPixel_t* frame, int64_t targetNs);
+
+// CLOCK_MONOTONIC now, in ns.
+SPILED_API int64_t spiledNow(void);
+
+// Wait until no frame is in flight (submitted frames included).
+SPILED_API void spiledWait(spiled_t* pLed);
+
+// Send ready-made wire bytes (symbols plus REFRESH tail) as they are.
+SPILED_API int spiledWrite(spiled_t* pLed, const uint8_t* wire, size_t len);
+
+// Send count wire images of frameLen bytes, back to back in wire, as one
+// SPI_IOC_MESSAGE with the kernel idling gapUsecs after each, so a
+// pre-computed sequence costs one syscall. Frames are idle-filtered like
+// presented ones; an unchanged frame is replaced by idle time of the same
+// length, keeping the pacing. Waits for any frame in flight or queued
+// first; don't present from another thread while a batch is going out. Returns the number of frames put on the
+// wire, or -1 (E2BIG if the batch is too long for one message).
+SPILED_API int spiledWriteBatch(spiled_t* pLed, const uint8_t* wire, size_t frameLen,
+    int count, uint32_t gapUsecs);
+
+// The configured SPI clock (as read back from the device) and its fd,
+// for callers that issue their own SPI_IOC_MESSAGE calls.
+SPILED_API uint32_t spiledSpeed(const spiled_t* pLed);
+SPILED_API int spiledFd(const spiled_t* pLed);
+
+// Copies up to pStats->size bytes of the counters; set size first.
+SPILED_API int spiledGetStats(const spiled_t* pLed, spiledStats_t* pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBSPILED_H
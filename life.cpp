@@ -0,0 +1,210 @@
+/*
+* Bit-packed cellular automaton engine for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "life.h"
+
+// Parse "B3/S23" into the two neighbor-count masks.
+static bool parseRule(const char* rule, uint16_t* pBorn, uint16_t* pSurvive)
+{
+    *pBorn = 0;
+    *pSurvive = 0;
+    uint16_t* pMask = NULL;
+    for (const char* p = rule; *p != '\0'; p++)
+    {
+        if (*p == 'B' || *p == 'b')
+            pMask = pBorn;
+        else if (*p == 'S' || *p == 's')
+            pMask = pSurvive;
+        else if (*p >= '0' && *p <= '8' && pMask != NULL)
+            *pMask |= 1 << (*p - '0');
+        else if (*p != '/')
+            return false;
+    }
+    return *pBorn != 0 || *pSurvive != 0;
+}
+
+bool lifeInit(lifeWorld_t* pWorld, int width, int height, const char* rule)
+{
+    memset(pWorld, 0, sizeof(*pWorld));
+    if (width < 2 || height < 2)
+        return false;
+    if (!parseRule(rule != NULL? rule : "B3/S23", &pWorld->born, &pWorld->survive))
+        return false;
+
+    pWorld->width = width;
+    pWorld->height = height;
+    pWorld->words = (width + 63) / 64;
+    int tail = width % 64;
+    pWorld->lastMask = tail == 0? ~0ull : (1ull << tail) - 1;
+    pWorld->cells = (uint64_t*)calloc((size_t)pWorld->words * height, sizeof(uint64_t));
+    pWorld->next = (uint64_t*)calloc((size_t)pWorld->words * height, sizeof(uint64_t));
+    if (pWorld->cells == NULL || pWorld->next == NULL)
+    {
+        lifeFree(pWorld);
+        return false;
+    }
+    return true;
+}
+
+void lifeFree(lifeWorld_t* pWorld)
+{
+    free(pWorld->cells);
+    free(pWorld->next);
+    pWorld->cells = NULL;
+    pWorld->next = NULL;
+}
+
+void lifeSet(lifeWorld_t* pWorld, int x, int y, bool alive)
+{
+    uint64_t& word = pWorld->cells[y * pWorld->words + x / 64];
+    uint64_t bit = 1ull << (x % 64);
+    word = alive? word | bit : word & ~bit;
+}
+
+bool lifeGet(const lifeWorld_t* pWorld, int x, int y)
+{
+    return (pWorld->cells[y * pWorld->words + x / 64] >> (x % 64)) & 1;
+}
+
+void lifeRandomize(lifeWorld_t* pWorld, int percent, uint32_t seed)
+{
+    // xorshift, so a seed gives the same world everywhere.
+    uint32_t state = seed? seed : 1;
+    for (int y = 0; y < pWorld->height; y++)
+    {
+        for (int x = 0; x < pWorld->width; x++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            lifeSet(pWorld, x, y, (int)(state % 100) < percent);
+        }
+    }
+    pWorld->generation = 0;
+}
+
+uint32_t lifePopulation(const lifeWorld_t* pWorld)
+{
+    uint32_t count = 0;
+    for (int i = 0; i < pWorld->words * pWorld->height; i++)
+        count += __builtin_popcountll(pWorld->cells[i]);
+    return count;
+}
+
+// Bit-sliced adders: each bit position is a separate cell.
+static inline void fullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t* pSum, uint64_t* pCarry)
+{
+    uint64_t t = a ^ b;
+    *pSum = t ^ c;
+    *pCarry = (a & b) | (t & c);
+}
+
+// A row's words shifted so each cell lines up with its west and east
+// neighbor, wrapping around the row's ends.
+static inline uint64_t westOf(const lifeWorld_t* pWorld, const uint64_t* pRow, int word)
+{
+    uint64_t carry = word > 0? pRow[word - 1] >> 63 :
+        (pRow[pWorld->words - 1] >> ((pWorld->width - 1) % 64)) & 1;
+    return (pRow[word] << 1) | carry;
+}
+
+static inline uint64_t eastOf(const lifeWorld_t* pWorld, const uint64_t* pRow, int word)
+{
+    if (word < pWorld->words - 1)
+        return (pRow[word] >> 1) | (pRow[word + 1] << 63);
+    // The last word may be partial: cell 0 wraps in after the last cell.
+    return (pRow[word] >> 1) | ((pRow[0] & 1) << ((pWorld->width - 1) % 64));
+}
+
+void lifeStep(lifeWorld_t* pWorld)
+{
+    const int words = pWorld->words;
+
+    // Which neighbor counts matter. Conway's rule gets its own short form.
+    uint16_t rule = pWorld->born | pWorld->survive;
+    bool conway = pWorld->born == 1 << 3 && pWorld->survive == (1 << 2 | 1 << 3);
+
+    for (int y = 0; y < pWorld->height; y++)
+    {
+        const uint64_t* pAbove = &pWorld->cells[(y > 0? y - 1 : pWorld->height - 1) * words];
+        const uint64_t* pRow = &pWorld->cells[y * words];
+        const uint64_t* pBelow = &pWorld->cells[(y < pWorld->height - 1? y + 1 : 0) * words];
+        uint64_t* pOut = &pWorld->next[y * words];
+
+        for (int w = 0; w < words; w++)
+        {
+            // Eight neighbors, summed 64 cells at a time into count bits
+            // b0 (1s), b1 (2s), b2 (4s) and b3 (8s).
+            uint64_t s0, c0, s1, c1, s2, c2;
+            fullAdd(westOf(pWorld, pAbove, w), pAbove[w], eastOf(pWorld, pAbove, w), &s0, &c0);
+            fullAdd(westOf(pWorld, pBelow, w), pBelow[w], eastOf(pWorld, pBelow, w), &s1, &c1);
+            uint64_t west = westOf(pWorld, pRow, w);
+            uint64_t east = eastOf(pWorld, pRow, w);
+            s2 = west ^ east;
+            c2 = west & east;
+
+            uint64_t b0, c3;
+            fullAdd(s0, s1, s2, &b0, &c3);
+            uint64_t t, c4;
+            fullAdd(c0, c1, c2, &t, &c4);
+            uint64_t b1 = t ^ c3;
+            uint64_t c5 = t & c3;
+            uint64_t b2 = c4 ^ c5;
+            uint64_t b3 = c4 & c5;
+
+            uint64_t alive = pRow[w];
+            if (conway)
+            {
+                // 3 neighbors, or 2 and alive: 2s bit set, 4s and 8s clear.
+                pOut[w] = b1 & ~b2 & ~b3 & (b0 | alive);
+                continue;
+            }
+
+            uint64_t born = 0;
+            uint64_t survive = 0;
+            for (int n = 0; n <= 8; n++)
+            {
+                if (!(rule & (1 << n)))
+                    continue;
+                uint64_t count = ((n & 1)? b0 : ~b0) & ((n & 2)? b1 : ~b1) &
+                    ((n & 4)? b2 : ~b2) & ((n & 8)? b3 : ~b3);
+                if (pWorld->born & (1 << n))
+                    born |= count;
+                if (pWorld->survive & (1 << n))
+                    survive |= count;
+            }
+
+            pOut[w] = (~alive & born) | (alive & survive);
+        }
+        pOut[words - 1] &= pWorld->lastMask;
+    }
+
+    uint64_t* pTemp = pWorld->cells;
+    pWorld->cells = pWorld->next;
+    pWorld->next = pTemp;
+    pWorld->generation++;
+}
+
+void lifeRender(const lifeWorld_t* pWorld, int viewX, int viewY, uint8_t* heat,
+    const rgbPixel_t* colorMap, rgbPixel_t* dst, int width, int height)
+{
+    for (int row = 0; row < height; row++)
+    {
+        int y = ((viewY + row) % pWorld->height + pWorld->height) % pWorld->height;
+        for (int col = 0; col < width; col++)
+        {
+            int x = ((viewX + col) % pWorld->width + pWorld->width) % pWorld->width;
+            uint8_t& level = heat[row * width + col];
+            if (lifeGet(pWorld, x, y))
+                level = LIFE_COLORS - 1;
+            else if (level > 0)
+                level--;
+            dst[row * width + col] = colorMap[level];
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/*
+* Bit-packed cellular automaton engine for the SPI NEOPixel display
+* By R. Blansett
+*
+* Life-like automata (Conway's B3/S23, HighLife B36/S23, Seeds B2/S, ...)
+* on a toroidal world stored 64 cells to a 64-bit word. A step never
+* looks at a single cell: for each word the eight neighbor words are
+* lined up with shifts, counted in parallel by a bit-sliced adder tree
+* into four count planes, and the rule applied to all 64 cells with a
+* handful of AND/OR/XORs. So a big world steps far faster than it can
+* be shown, and the display sees it through a viewport.
+*
+* Rendering goes through a color map: a viewport cell is bright while
+* alive and fades down the map after it dies, which keeps the pattern
+* readable at 16x16.
+*/
+
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+static const int LIFE_COLORS = 16;  // color map entries, 0 = long dead
+
+struct lifeWorld_t
+{
+    int width;
+    int height;
+    int words;                  // per row
+    uint64_t lastMask;          // valid cells in the last word of a row
+    uint64_t* cells;
+    uint64_t* next;
+    uint16_t born;              // bit n: a dead cell with n neighbors is born
+    uint16_t survive;           // bit n: a live cell with n neighbors lives
+    uint32_t generation;
+};
+
+// Rule in B/S notation, e.g. "B3/S23". NULL is Conway's Life.
+bool lifeInit(lifeWorld_t* pWorld, int width, int height, const char* rule);
+void lifeFree(lifeWorld_t* pWorld);
+
+void lifeSet(lifeWorld_t* pWorld, int x, int y, bool alive);
+bool lifeGet(const lifeWorld_t* pWorld, int x, int y);
+void lifeRandomize(lifeWorld_t* pWorld, int percent, uint32_t seed);
+uint32_t lifePopulation(const lifeWorld_t* pWorld);
+
+void lifeStep(lifeWorld_t* pWorld);
+
+// Draw the width x height viewport at (viewX, viewY), wrapping around
+// the world. heat holds one fade level per viewport cell between calls.
+void lifeRender(const lifeWorld_t* pWorld, int viewX, int viewY, uint8_t* heat,
+    const rgbPixel_t* colorMap, rgbPixel_t* dst, int width, int height);
+
+#endif // LIFE_H
@@ -0,0 +1,152 @@
+/*
+* Cellular automaton benchmark
+* By R. Blansett
+*
+* Steps the bit-packed engine against a plain byte-per-cell version
+* written the way rgbGridPattern draws (a loop over every cell and its
+* eight neighbors), checks they agree cell for cell, then times both on
+* worlds up to 1024x1024, with a 16x16 viewport rendered each step.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "life.h"
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+struct naiveWorld_t
+{
+    int width;
+    int height;
+    uint8_t* cells;
+    uint8_t* next;
+};
+
+static void naiveStep(naiveWorld_t* pWorld, uint16_t born, uint16_t survive)
+{
+    for (int y = 0; y < pWorld->height; y++)
+    {
+        for (int x = 0; x < pWorld->width; x++)
+        {
+            int count = 0;
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    if (dx == 0 && dy == 0)
+                        continue;
+                    int nx = (x + dx + pWorld->width) % pWorld->width;
+                    int ny = (y + dy + pWorld->height) % pWorld->height;
+                    count += pWorld->cells[ny * pWorld->width + nx];
+                }
+            }
+            uint8_t alive = pWorld->cells[y * pWorld->width + x];
+            uint16_t rule = alive? survive : born;
+            pWorld->next[y * pWorld->width + x] = (rule >> count) & 1;
+        }
+    }
+    uint8_t* pTemp = pWorld->cells;
+    pWorld->cells = pWorld->next;
+    pWorld->next = pTemp;
+}
+
+// Run both for a few generations from the same start; true if they agree.
+static bool check(int width, int height, const char* rule)
+{
+    lifeWorld_t world;
+    lifeInit(&world, width, height, rule);
+    lifeRandomize(&world, 35, width * 31 + height);
+
+    naiveWorld_t naive = { width, height, new uint8_t[width * height], new uint8_t[width * height] };
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            naive.cells[y * width + x] = lifeGet(&world, x, y);
+
+    bool same = true;
+    for (int gen = 0; gen < 40 && same; gen++)
+    {
+        lifeStep(&world);
+        naiveStep(&naive, world.born, world.survive);
+        for (int y = 0; y < height && same; y++)
+            for (int x = 0; x < width && same; x++)
+                same = lifeGet(&world, x, y) == (naive.cells[y * width + x] != 0);
+    }
+    printf("%4dx%-4d %-8s %s\n", width, height, rule, same? "identical" : "MISMATCH");
+
+    delete[] naive.cells;
+    delete[] naive.next;
+    lifeFree(&world);
+    return same;
+}
+
+static void timeSize(int size)
+{
+    static rgbPixel_t colorMap[LIFE_COLORS];
+    static rgbPixel_t view[GRID_AREA];
+    static uint8_t heat[GRID_AREA];
+    for (int i = 0; i < LIFE_COLORS; i++)
+        makeRgbPixel(colorMap[i], i * 3, i * 2, 40 - i * 2);
+
+    lifeWorld_t world;
+    lifeInit(&world, size, size, NULL);
+    lifeRandomize(&world, 30, 7);
+    int gens = 0;
+    double start = now();
+    double elapsed = 0;
+    while (elapsed < 0.5)
+    {
+        lifeStep(&world);
+        lifeRender(&world, gens, gens / 2, heat, colorMap, view, GRID_WIDTH, GRID_HEIGHT);
+        gens++;
+        elapsed = now() - start;
+    }
+    double packed = gens / elapsed;
+
+    naiveWorld_t naive = { size, size, new uint8_t[size * size], new uint8_t[size * size] };
+    for (int i = 0; i < size * size; i++)
+        naive.cells[i] = rand() % 3 == 0;
+    int naiveGens = 0;
+    start = now();
+    elapsed = 0;
+    while (elapsed < 0.5)
+    {
+        naiveStep(&naive, 1 << 3, 1 << 2 | 1 << 3);
+        naiveGens++;
+        elapsed = now() - start;
+    }
+    double plain = naiveGens / elapsed;
+
+    printf("%4dx%-4d  %9.0f gens/s  %7.2f Gcells/s   per-cell %8.1f gens/s  %6.1fx  "
+        "(pop %u)\n", size, size, packed, packed * size * size / 1e9, plain,
+        packed / plain, lifePopulation(&world));
+
+    delete[] naive.cells;
+    delete[] naive.next;
+    lifeFree(&world);
+}
+
+int main()
+{
+    int failures = 0;
+    failures += !check(64, 64, "B3/S23");
+    failures += !check(100, 70, "B3/S23");
+    failures += !check(130, 9, "B36/S23");
+    failures += !check(16, 16, "B2/S");
+    failures += !check(200, 128, "B3678/S34678");
+
+    const int sizes[] = { 64, 256, 512, 1024 };
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+        timeSize(sizes[i]);
+
+    return failures? 1 : 0;
+}
@@ -0,0 +1,66 @@
+/*
+* Palette-indexed frames for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <string.h>
+
+#include "palette.h"
+
+void paletteInit(palette_t* pPalette)
+{
+    pPalette->count = 0;
+    const rgbPixel_t black = { 0, 0, 0, 0 };
+    for (int i = 0; i < PALETTE_SIZE; i++)
+        paletteSet(pPalette, i, black);
+}
+
+void paletteSet(palette_t* pPalette, int index, const rgbPixel_t& color)
+{
+    pPalette->colors[index] = color;
+    display_t::encodePixel(pPalette->wire[index], color);
+}
+
+static inline uint32_t colorKey(const rgbPixel_t& color)
+{
+    return (uint32_t)color.r << 16 | (uint32_t)color.g << 8 | color.b;
+}
+
+bool paletteIndexFrame(palette_t* pPalette, const rgbPixel_t* frame, int pixels,
+    uint8_t* indices)
+{
+    // Open-addressed color -> index table, twice the palette so probes
+    // stay short. Slots hold index + 1; 0 is empty.
+    const int SLOTS = 2 * PALETTE_SIZE;
+    uint16_t slots[SLOTS];
+    memset(slots, 0, sizeof(slots));
+    paletteInit(pPalette);
+
+    for (int pixel = 0; pixel < pixels; pixel++)
+    {
+        const rgbPixel_t& color = frame[pixel];
+        uint32_t key = colorKey(color);
+        int slot = (key * 0x9E3779B1u) >> 23;
+        while (slots[slot] != 0 && colorKey(pPalette->colors[slots[slot] - 1]) != key)
+            slot = (slot + 1) & (SLOTS - 1);
+
+        if (slots[slot] == 0)
+        {
+            if (pPalette->count == PALETTE_SIZE)
+                return false;
+            rgbPixel_t entry = color;
+            entry.a = 0;
+            paletteSet(pPalette, pPalette->count, entry);
+            slots[slot] = ++pPalette->count;
+        }
+        indices[pixel] = slots[slot] - 1;
+    }
+    return true;
+}
+
+void paletteExpand(const palette_t* pPalette, const uint8_t* indices, int pixels,
+    rgbPixel_t* frame)
+{
+    for (int pixel = 0; pixel < pixels; pixel++)
+        frame[pixel] = pPalette->colors[indices[pixel]];
+}
@@ -0,0 +1,47 @@
+/*
+* Palette-indexed frames for the SPI NEOPixel display
+* By R. Blansett
+*
+* Most of what the display shows (text, UI, pixel art like the built-in
+* red ball and Yoda) uses far fewer than 256 colors. An indexed frame is
+* one byte per pixel, a third of an RGB frame to produce, store and read.
+* The palette keeps every entry's wire bytes next to its color, so
+* encoding a pixel is one 12 byte copy (Grid<>::encodeIndexed and
+* streamFrameIndexed) instead of three table lookups.
+*
+* Changing an entry recolors every pixel that uses it without touching
+* the frame, so fades and color cycling cost 256 entries, not a redraw.
+*/
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+static const int PALETTE_SIZE = 256;
+
+struct palette_t
+{
+    int count;                  // entries in use
+    rgbPixel_t colors[PALETTE_SIZE];
+    uint8_t wire[PALETTE_SIZE][display_t::WIRE_PIXEL_SIZE];
+};
+
+// All entries black, none in use.
+void paletteInit(palette_t* pPalette);
+
+// Set an entry's color and re-encode its wire bytes.
+void paletteSet(palette_t* pPalette, int index, const rgbPixel_t& color);
+
+// Build a palette from an RGB frame and write its indices. Returns false
+// (leaving the palette partly built) if it has more than 256 colors.
+bool paletteIndexFrame(palette_t* pPalette, const rgbPixel_t* frame, int pixels,
+    uint8_t* indices);
+
+// Back to RGB, e.g. for dumps or blending.
+void paletteExpand(const palette_t* pPalette, const uint8_t* indices, int pixels,
+    rgbPixel_t* frame);
+
+#endif // PALETTE_H
@@ -0,0 +1,47 @@
+/*
+* Procedural pattern shaders for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <math.h>
+
+#include "patterns.h"
+
+void sineShader(const void* params, surface_t* pDst, rect_t tile)
+{
+    const sineParams_t* pParams = (const sineParams_t*)params;
+    for (int row = tile.y; row < tile.y + tile.height; row++)
+    {
+        rgbPixel_t* pRow = &pDst->pixels[row * pDst->stride];
+        for (int col = tile.x; col < tile.x + tile.width; col++)
+        {
+            const float K = 3.1415*3.0/2.0;
+            int x = 32 - int(32 * sin(K + pParams->pass/10.0 + row + col));
+            makeRgbPixel(pRow[col], 0, 0, x);
+        }
+    }
+}
+
+void plasmaShader(const void* params, surface_t* pDst, rect_t tile)
+{
+    const plasmaParams_t* pParams = (const plasmaParams_t*)params;
+    const float k = 2.0f * (float)M_PI / pParams->scale;
+    const float t = pParams->time;
+    for (int row = tile.y; row < tile.y + tile.height; row++)
+    {
+        rgbPixel_t* pRow = &pDst->pixels[row * pDst->stride];
+        float y = row * k;
+        for (int col = tile.x; col < tile.x + tile.width; col++)
+        {
+            float x = col * k;
+            float v = sinf(x + t) + sinf(y * 0.5f + t * 1.3f) +
+                sinf((x + y) * 0.5f + t * 0.7f) +
+                sinf(sqrtf(x * x + y * y) * 0.5f + t);
+            float phase = v * (float)M_PI * 0.25f;
+            makeRgbPixel(pRow[col],
+                (uint8_t)(32 + 31 * sinf(phase)),
+                (uint8_t)(32 + 31 * sinf(phase + 2.094f)),
+                (uint8_t)(32 + 31 * sinf(phase + 4.189f)));
+        }
+    }
+}
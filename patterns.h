@@ -0,0 +1,33 @@
+/*
+* Procedural pattern shaders for the SPI NEOPixel display
+* By R. Blansett
+*
+* Tile shaders (see tilepool.h): each pixel depends only on its position
+* and the params, so they run the same on the 16x16 grid or split across
+* threads on a large wall.
+*/
+
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include "spiled.h"
+#include "raster.h"
+
+// Blue sine wave moving diagonally (pattern 97).
+struct sineParams_t
+{
+    int pass;
+};
+
+void sineShader(const void* params, surface_t* pDst, rect_t tile);
+
+// Classic plasma: four summed sines, mapped through a color wheel.
+struct plasmaParams_t
+{
+    float time;
+    float scale;        // pattern size in pixels per cycle
+};
+
+void plasmaShader(const void* params, surface_t* pDst, rect_t tile);
+
+#endif // PATTERNS_H
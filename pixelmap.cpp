@@ -0,0 +1,229 @@
+/*
+* Logical (x,y) to physical LED index mapping for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spiled.h"
+#include "pixelmap.h"
+
+uint16_t ledMap[GRID_AREA];
+
+struct rowRun_t
+{
+    int16_t first;
+    int8_t step;        // 0 = not a run
+};
+
+static rowRun_t rowRuns[GRID_HEIGHT];
+
+static const int MAX_PANEL_ROTATIONS = 64;
+
+struct layout_t
+{
+    bool columns;
+    bool serpentine;
+    bool flipX;
+    bool flipY;
+    int rotation;       // degrees clockwise
+    int panelWidth;
+    int panelHeight;
+    bool panelSerpentine;
+    int panelRotations[MAX_PANEL_ROTATIONS];
+    int panelRotationCount;
+};
+
+static bool parseRotation(const char* text, int* pDegrees)
+{
+    int degrees = atoi(text);
+    if (degrees != 0 && degrees != 90 && degrees != 180 && degrees != 270)
+        return false;
+    *pDegrees = degrees;
+    return true;
+}
+
+static bool parseLayout(const char* text, layout_t* pLayout)
+{
+    memset(pLayout, 0, sizeof(*pLayout));
+    pLayout->serpentine = true;
+    pLayout->panelWidth = GRID_WIDTH;
+    pLayout->panelHeight = GRID_HEIGHT;
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", text);
+
+    char* savePtr = NULL;
+    for (char* token = strtok_r(buffer, ",", &savePtr); token != NULL;
+        token = strtok_r(NULL, ",", &savePtr))
+    {
+        if (strcmp(token, "rows") == 0)
+            pLayout->columns = false;
+        else if (strcmp(token, "columns") == 0)
+            pLayout->columns = true;
+        else if (strcmp(token, "serpentine") == 0)
+            pLayout->serpentine = true;
+        else if (strcmp(token, "progressive") == 0)
+            pLayout->serpentine = false;
+        else if (strcmp(token, "flipx") == 0)
+            pLayout->flipX = true;
+        else if (strcmp(token, "flipy") == 0)
+            pLayout->flipY = true;
+        else if (strncmp(token, "rot", 3) == 0 && parseRotation(token + 3, &pLayout->rotation))
+            ;
+        else if (sscanf(token, "panel=%dx%d", &pLayout->panelWidth, &pLayout->panelHeight) == 2)
+            ;
+        else if (strcmp(token, "panelserpentine") == 0)
+            pLayout->panelSerpentine = true;
+        else if (strncmp(token, "panelrot=", 9) == 0)
+        {
+            char* rotSave = NULL;
+            for (char* rot = strtok_r(token + 9, ":", &rotSave); rot != NULL;
+                rot = strtok_r(NULL, ":", &rotSave))
+            {
+                if (pLayout->panelRotationCount == MAX_PANEL_ROTATIONS ||
+                    !parseRotation(rot, &pLayout->panelRotations[pLayout->panelRotationCount++]))
+                {
+                    printf("layout: bad panel rotation \"%s\"\n", rot);
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            printf("layout: unknown item \"%s\"\n", token);
+            return false;
+        }
+    }
+
+    if (pLayout->panelWidth < 1 || pLayout->panelHeight < 1 ||
+        GRID_WIDTH % pLayout->panelWidth || GRID_HEIGHT % pLayout->panelHeight)
+    {
+        printf("layout: panels must tile the %dx%d grid\n", GRID_WIDTH, GRID_HEIGHT);
+        return false;
+    }
+    if ((pLayout->rotation % 180) && GRID_WIDTH != GRID_HEIGHT)
+    {
+        printf("layout: a 90 degree rotation needs a square grid\n");
+        return false;
+    }
+    for (int i = 0; i < pLayout->panelRotationCount; i++)
+    {
+        if ((pLayout->panelRotations[i] % 180) &&
+            pLayout->panelWidth != pLayout->panelHeight)
+        {
+            printf("layout: a 90 degree panel rotation needs square panels\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rotate (x, y) clockwise within a size x size square.
+static void rotate(int degrees, int size, int* pX, int* pY)
+{
+    int x = *pX;
+    int y = *pY;
+    switch (degrees)
+    {
+        case 90:  *pX = size - 1 - y; *pY = x; break;
+        case 180: *pX = size - 1 - x; *pY = size - 1 - y; break;
+        case 270: *pX = y; *pY = size - 1 - x; break;
+        default:  break;
+    }
+}
+
+static int physicalIndex(const layout_t* pLayout, int x, int y)
+{
+    // Where the whole display is mounted.
+    if (pLayout->flipX)
+        x = GRID_WIDTH - 1 - x;
+    if (pLayout->flipY)
+        y = GRID_HEIGHT - 1 - y;
+    rotate(pLayout->rotation, GRID_WIDTH, &x, &y);
+
+    // Which panel, and where it sits in the chain.
+    int pw = pLayout->panelWidth;
+    int ph = pLayout->panelHeight;
+    int panelsAcross = GRID_WIDTH / pw;
+    int panelCol = x / pw;
+    int panelRow = y / ph;
+    if (pLayout->panelSerpentine && (panelRow & 1))
+        panelCol = panelsAcross - 1 - panelCol;
+    int panel = panelRow * panelsAcross + panelCol;
+
+    // Position within the panel, after that panel's own rotation.
+    int lx = x % pw;
+    int ly = y % ph;
+    if (pLayout->panelRotationCount > 0)
+    {
+        int degrees = pLayout->panelRotations[panel % pLayout->panelRotationCount];
+        rotate(degrees, pw, &lx, &ly);
+    }
+
+    int line = pLayout->columns? lx : ly;
+    int pos = pLayout->columns? ly : lx;
+    int lineLength = pLayout->columns? ph : pw;
+    if (pLayout->serpentine && (line & 1))
+        pos = lineLength - 1 - pos;
+
+    return panel * pw * ph + line * lineLength + pos;
+}
+
+bool pixelMapBuild(const char* layout, uint16_t* pMap)
+{
+    layout_t parsed;
+    if (!parseLayout(layout, &parsed))
+        return false;
+
+    uint16_t map[GRID_AREA];
+    bool used[GRID_AREA];
+    memset(used, 0, sizeof(used));
+    for (int y = 0; y < GRID_HEIGHT; y++)
+    {
+        for (int x = 0; x < GRID_WIDTH; x++)
+        {
+            int index = physicalIndex(&parsed, x, y);
+            if (index < 0 || index >= GRID_AREA || used[index])
+            {
+                printf("layout: \"%s\" doesn't map every LED once\n", layout);
+                return false;
+            }
+            used[index] = true;
+            map[y * GRID_WIDTH + x] = index;
+        }
+    }
+    memcpy(pMap, map, sizeof(map));
+    return true;
+}
+
+bool pixelMapInit(const char* layout)
+{
+    if (!pixelMapBuild(layout, ledMap))
+        return false;
+
+    for (int y = 0; y < GRID_HEIGHT; y++)
+    {
+        const uint16_t* pRow = &ledMap[y * GRID_WIDTH];
+        int step = GRID_WIDTH > 1? pRow[1] - pRow[0] : 1;
+        if (step != 1 && step != -1)
+            step = 0;
+        for (int x = 1; x < GRID_WIDTH && step != 0; x++)
+        {
+            if (pRow[x] - pRow[x - 1] != step)
+                step = 0;
+        }
+        rowRuns[y].first = pRow[0];
+        rowRuns[y].step = step;
+    }
+    return true;
+}
+
+bool pixelMapRowRun(int row, int* pFirst, int* pStep)
+{
+    *pFirst = rowRuns[row].first;
+    *pStep = rowRuns[row].step;
+    return rowRuns[row].step != 0;
+}
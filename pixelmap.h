@@ -0,0 +1,47 @@
+/*
+* Logical (x,y) to physical LED index mapping for the SPI NEOPixel display
+* By R. Blansett
+*
+* Built once at startup from a layout description, then used by the
+* encoder to scatter pixels into wire order with no per-pixel branching.
+*
+* A layout is a comma separated list of:
+*   rows | columns          strips run along rows (default) or columns
+*   serpentine | progressive every other strip reversed (default) or not
+*   flipx, flipy            mirror the whole display
+*   rot90, rot180, rot270   rotate the whole display (clockwise)
+*   panel=WxH               display is tiled from WxH panels, chained in
+*                           row order; each panel is wired as above
+*   panelserpentine         every other row of panels chained right to left
+*   panelrot=A:B:...        per-panel rotation in degrees, by chain position
+*                           (the list repeats if shorter than the panels)
+*
+* The original 16x16 panel (row 0 right to left, row 1 left to right, ...)
+* is DEFAULT_LAYOUT.
+*/
+
+#ifndef PIXELMAP_H
+#define PIXELMAP_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+#define DEFAULT_LAYOUT "rows,serpentine,flipx"
+
+// ledMap[y * GRID_WIDTH + x] is the LED's position in the chain.
+extern uint16_t ledMap[GRID_AREA];
+
+// Parse layout into pMap (GRID_AREA entries, indexed like ledMap). On
+// error pMap is left unchanged and a message is printed.
+bool pixelMapBuild(const char* layout, uint16_t* pMap);
+
+// Parse layout and rebuild ledMap. On error ledMap is left unchanged and
+// a message is printed.
+bool pixelMapInit(const char* layout);
+
+// If logical row maps onto consecutive LEDs, give the LED of column 0 and
+// the step (+1 or -1) from one column to the next.
+bool pixelMapRowRun(int row, int* pFirst, int* pStep);
+
+#endif // PIXELMAP_H
@@ -0,0 +1,197 @@
+/*
+* Image-sequence playback for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "bmp24.h"
+#include "playback.h"
+#include "arena.h"
+#include "trace.h"
+#include "timing.h"
+
+// The ring is single-producer (loader thread) / single-consumer (display).
+// readySlots counts converted frames, freeSlots counts reusable slots.
+// The display side only ever does sem_trywait(), so it never blocks.
+struct frameRing_t
+{
+    rgbPixel_t (*frames)[GRID_AREA];
+    int size;
+    int head;                   // next slot the loader fills
+    int tail;                   // next slot the display takes
+    sem_t readySlots;
+    sem_t freeSlots;
+    sem_t primed;               // posted once the ring is full (or done)
+
+    char dir[256];
+    struct dirent **names;
+    int count;
+    bool loop;
+    arena_t* pArena;            // the loader's scratch for reading BMPs
+
+    bool stop;                  // accessed with __atomic builtins
+    bool done;                  // loader has queued its last frame
+    uint32_t loadErrors;
+    uint32_t framesLoaded;      // read by playbackRun after the join
+};
+
+static int isBmpFile(const struct dirent *entry)
+{
+    size_t len = strlen(entry->d_name);
+    return len > 4 && strcasecmp(entry->d_name + len - 4, ".bmp") == 0;
+}
+
+static void* prefetchThread(void* arg)
+{
+    frameRing_t* pRing = (frameRing_t*)arg;
+    traceThreadName("prefetch loader");
+    char path[512];
+    int queued = 0;
+    int loadedThisPass = 0;
+    int i = 0;
+
+    while (!__atomic_load_n(&pRing->stop, __ATOMIC_ACQUIRE))
+    {
+        if (i == pRing->count)
+        {
+            // A pass that loaded nothing would only fail the same way again.
+            if (!pRing->loop || loadedThisPass == 0)
+                break;
+            loadedThisPass = 0;
+            i = 0;
+        }
+
+        sem_wait(&pRing->freeSlots);
+        if (__atomic_load_n(&pRing->stop, __ATOMIC_ACQUIRE))
+            break;
+
+        snprintf(path, sizeof(path), "%s/%s", pRing->dir, pRing->names[i]->d_name);
+        uint64_t converted = traceBegin();
+        bool ok = bmpLoadFrame(path, pRing->pArena, pRing->frames[pRing->head]);
+        traceEnd(TRACE_CONVERT, converted);
+        if (!ok)
+        {
+            pRing->loadErrors++;
+            sem_post(&pRing->freeSlots);
+        }
+        else
+        {
+            pRing->head = (pRing->head + 1) % pRing->size;
+            loadedThisPass++;
+            pRing->framesLoaded++;
+            sem_post(&pRing->readySlots);
+            if (++queued == pRing->size)
+                sem_post(&pRing->primed);
+        }
+        i++;
+    }
+
+    __atomic_store_n(&pRing->done, true, __ATOMIC_RELEASE);
+    if (queued < pRing->size)
+        sem_post(&pRing->primed);
+    return NULL;
+}
+
+int playbackRun(int fd, const char* dir, int fps, int prefetch, bool loop,
+    arena_t* pArena, playbackStats_t* pStats)
+{
+    frameRing_t ring;
+    memset(&ring, 0, sizeof(ring));
+    memset(pStats, 0, sizeof(*pStats));
+
+    ring.count = scandir(dir, &ring.names, isBmpFile, versionsort);
+    if (ring.count < 0)
+        return -1;
+    if (ring.count == 0)
+    {
+        free(ring.names);
+        return 0;
+    }
+
+    if (fps < 1)
+        fps = 1;
+    if (prefetch < 1)
+        prefetch = 1;
+    ring.size = prefetch;
+    ring.frames = new rgbPixel_t[prefetch][GRID_AREA];
+    ring.loop = loop;
+    ring.pArena = pArena;
+    snprintf(ring.dir, sizeof(ring.dir), "%s", dir);
+    sem_init(&ring.readySlots, 0, 0);
+    sem_init(&ring.freeSlots, 0, prefetch);
+    sem_init(&ring.primed, 0, 0);
+
+    pthread_t loader;
+    if (pthread_create(&loader, NULL, prefetchThread, &ring) != 0)
+    {
+        perror("can't start prefetch thread");
+        exit(1);
+    }
+
+    // Let the loader get ahead before the clock starts.
+    sem_wait(&ring.primed);
+
+    const long FRAME_NSEC = 1000000000L / fps;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (true)
+    {
+        bool ready = sem_trywait(&ring.readySlots) == 0;
+        if (!ready && __atomic_load_n(&ring.done, __ATOMIC_ACQUIRE))
+        {
+            // The last frame may have landed after the trywait above.
+            ready = sem_trywait(&ring.readySlots) == 0;
+            if (!ready)
+                break;
+        }
+
+        if (ready)
+        {
+            memcpy(rgbGrid, ring.frames[ring.tail], sizeof(rgbGrid));
+            ring.tail = (ring.tail + 1) % ring.size;
+            sem_post(&ring.freeSlots);
+            pStats->framesShown++;
+        }
+        else
+        {
+            // Nothing ready: hold the previous frame on the display.
+            pStats->underruns++;
+        }
+
+        gridTransfer(fd);
+        pStats->transfers++;
+
+        addNsec(next, FRAME_NSEC);
+        uint64_t slept = traceBegin();
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        traceEnd(TRACE_SLEEP, slept);
+    }
+
+    __atomic_store_n(&ring.stop, true, __ATOMIC_RELEASE);
+    sem_post(&ring.freeSlots);
+    pthread_join(loader, NULL);
+    pStats->loadErrors = ring.loadErrors;
+    int found = ring.framesLoaded > 0? ring.count : -1;
+
+    sem_destroy(&ring.readySlots);
+    sem_destroy(&ring.freeSlots);
+    sem_destroy(&ring.primed);
+    delete[] ring.frames;
+    for (int i = 0; i < ring.count; i++)
+        free(ring.names[i]);
+    free(ring.names);
+
+    if (found < 0)
+        errno = EIO;
+    return found;
+}
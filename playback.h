@@ -0,0 +1,33 @@
+/*
+* Image-sequence playback for the SPI NEOPixel display
+* By R. Blansett
+*
+* Plays a directory of numbered BMP frames. A background prefetch thread
+* loads and converts the upcoming frames into a bounded ring so that the
+* transmit loop never touches the disk.
+*/
+
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include <stdint.h>
+
+struct arena_t;
+
+struct playbackStats_t
+{
+    uint32_t framesShown;   // ring frames put on the display
+    uint32_t underruns;     // transmit slots where no frame was ready
+    uint32_t loadErrors;    // frames that could not be read
+    uint32_t transfers;     // total gridTransfer() calls
+};
+
+// Play every *.bmp in dir (in version-sort order) at fps frames/second,
+// keeping up to prefetch converted frames queued ahead of the display.
+// The loader reads each BMP into pArena and releases it once converted.
+// Returns the number of frames found, or -1 if dir can't be read or none
+// of its frames could be loaded (EIO).
+int playbackRun(int fd, const char* dir, int fps, int prefetch, bool loop,
+    arena_t* pArena, playbackStats_t* pStats);
+
+#endif // PLAYBACK_H
@@ -0,0 +1,198 @@
+/*
+* Timestamped presentation queue for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "present.h"
+
+int64_t presentNow()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// The slot boundary nearest to t.
+static int64_t nearestSlot(const presentQueue_t* pQueue, int64_t t)
+{
+    int64_t offset = t - pQueue->epochNs + pQueue->slotNs / 2;
+    int64_t slot = offset / pQueue->slotNs;
+    if (offset < 0 && offset % pQueue->slotNs != 0)
+        slot--;
+    return pQueue->epochNs + slot * pQueue->slotNs;
+}
+
+// Drop the head entry, handing its buffer back.
+static void dropHead(presentQueue_t* pQueue)
+{
+    pQueue->freeList[pQueue->freeCount++] = pQueue->entries[0].buffer;
+    pQueue->count--;
+    memmove(&pQueue->entries[0], &pQueue->entries[1], pQueue->count * sizeof(presentEntry_t));
+}
+
+static void* schedulerThread(void* arg)
+{
+    presentQueue_t* pQueue = (presentQueue_t*)arg;
+
+    pthread_mutex_lock(&pQueue->lock);
+    while (true)
+    {
+        if (pQueue->count == 0)
+        {
+            if (pQueue->stop)
+                break;
+            pthread_cond_wait(&pQueue->changed, &pQueue->lock);
+            continue;
+        }
+
+        int64_t slot = nearestSlot(pQueue, pQueue->entries[0].targetNs);
+        int64_t current = nearestSlot(pQueue, presentNow());
+        if (slot < current)
+        {
+            dropHead(pQueue);
+            pQueue->late++;
+            continue;
+        }
+        if (slot > current)
+        {
+            // Sleep until its slot starts, or until a new frame arrives
+            // (it might go up sooner).
+            struct timespec until;
+            until.tv_sec = slot / 1000000000LL;
+            until.tv_nsec = slot % 1000000000LL;
+            pthread_cond_timedwait(&pQueue->changed, &pQueue->lock, &until);
+            continue;
+        }
+
+        // This slot: the last frame that falls in it goes up.
+        while (pQueue->count > 1 && nearestSlot(pQueue, pQueue->entries[1].targetNs) == slot)
+        {
+            dropHead(pQueue);
+            pQueue->superseded++;
+        }
+        presentEntry_t entry = pQueue->entries[0];
+        pQueue->count--;
+        memmove(&pQueue->entries[0], &pQueue->entries[1], pQueue->count * sizeof(presentEntry_t));
+        pQueue->presenting = true;
+        pthread_mutex_unlock(&pQueue->lock);
+
+        int64_t error = presentNow() - entry.targetNs;
+        pQueue->sink(pQueue->sinkCtx, &pQueue->buffers[entry.buffer * pQueue->frameSize]);
+
+        pthread_mutex_lock(&pQueue->lock);
+        pQueue->freeList[pQueue->freeCount++] = entry.buffer;
+        pQueue->presenting = false;
+        pQueue->presented++;
+        if (error < 0)
+            error = -error;
+        if (error > pQueue->maxErrorNs)
+            pQueue->maxErrorNs = error;
+        pthread_cond_broadcast(&pQueue->changed);
+    }
+    pthread_mutex_unlock(&pQueue->lock);
+    return NULL;
+}
+
+bool presentInit(presentQueue_t* pQueue, uint32_t frameSize, int depth, int fps,
+    presentSink_t sink, void* sinkCtx)
+{
+    memset(pQueue, 0, sizeof(*pQueue));
+    pQueue->frameSize = frameSize;
+    pQueue->depth = depth > 0? depth : DEFAULT_PRESENT_DEPTH;
+    pQueue->slotNs = 1000000000LL / (fps > 0? fps : 1);
+    pQueue->epochNs = presentNow();
+    pQueue->sink = sink;
+    pQueue->sinkCtx = sinkCtx;
+
+    pQueue->buffers = (uint8_t*)malloc((size_t)(pQueue->depth + 1) * frameSize);
+    pQueue->entries = (presentEntry_t*)malloc(pQueue->depth * sizeof(presentEntry_t));
+    pQueue->freeList = (int*)malloc((pQueue->depth + 1) * sizeof(int));
+    if (pQueue->buffers == NULL || pQueue->entries == NULL || pQueue->freeList == NULL)
+    {
+        free(pQueue->buffers);
+        free(pQueue->entries);
+        free(pQueue->freeList);
+        return false;
+    }
+    for (int i = 0; i <= pQueue->depth; i++)
+        pQueue->freeList[pQueue->freeCount++] = i;
+
+    // Targets are CLOCK_MONOTONIC, so the waits must be too.
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pQueue->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&pQueue->lock, NULL);
+
+    if (pthread_create(&pQueue->scheduler, NULL, schedulerThread, pQueue) != 0)
+    {
+        pthread_cond_destroy(&pQueue->changed);
+        pthread_mutex_destroy(&pQueue->lock);
+        free(pQueue->buffers);
+        free(pQueue->entries);
+        free(pQueue->freeList);
+        return false;
+    }
+    return true;
+}
+
+void presentFlush(presentQueue_t* pQueue)
+{
+    pthread_mutex_lock(&pQueue->lock);
+    while (pQueue->count > 0 || pQueue->presenting)
+        pthread_cond_wait(&pQueue->changed, &pQueue->lock);
+    pthread_mutex_unlock(&pQueue->lock);
+}
+
+void presentFree(presentQueue_t* pQueue)
+{
+    pthread_mutex_lock(&pQueue->lock);
+    pQueue->stop = true;
+    pthread_cond_broadcast(&pQueue->changed);
+    pthread_mutex_unlock(&pQueue->lock);
+    pthread_join(pQueue->scheduler, NULL);
+
+    pthread_cond_destroy(&pQueue->changed);
+    pthread_mutex_destroy(&pQueue->lock);
+    free(pQueue->buffers);
+    free(pQueue->entries);
+    free(pQueue->freeList);
+    pQueue->buffers = NULL;
+    pQueue->entries = NULL;
+    pQueue->freeList = NULL;
+}
+
+void presentSubmit(presentQueue_t* pQueue, const void* frame, int64_t targetNs)
+{
+    pthread_mutex_lock(&pQueue->lock);
+    if (pQueue->count == pQueue->depth)
+    {
+        // Full: the frame due soonest is the one most likely to be late.
+        dropHead(pQueue);
+        pQueue->overflows++;
+    }
+
+    int buffer = pQueue->freeList[--pQueue->freeCount];
+    memcpy(&pQueue->buffers[buffer * pQueue->frameSize], frame, pQueue->frameSize);
+
+    // Keep the entries sorted; frames almost always arrive in order, so
+    // this is normally an append.
+    int at = pQueue->count;
+    while (at > 0 && pQueue->entries[at - 1].targetNs > targetNs)
+    {
+        pQueue->entries[at] = pQueue->entries[at - 1];
+        at--;
+    }
+    pQueue->entries[at].targetNs = targetNs;
+    pQueue->entries[at].buffer = buffer;
+    pQueue->count++;
+    pQueue->submitted++;
+
+    pthread_cond_broadcast(&pQueue->changed);
+    pthread_mutex_unlock(&pQueue->lock);
+}
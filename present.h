@@ -0,0 +1,81 @@
+/*
+* Timestamped presentation queue for the SPI NEOPixel display
+* By R. Blansett
+*
+* Frames that come from outside (the network, other processes, libspiled
+* callers) should go up when they are meant to, not whenever they happen
+* to arrive. Each submitted frame carries a CLOCK_MONOTONIC target time.
+* A scheduler thread divides time into transfer slots, one frame period
+* each, and presents every frame in the slot nearest its target:
+*
+*   - a frame whose slot has already passed is dropped as late;
+*   - when several frames land in one slot, the last of them wins;
+*   - a frame whose slot is in the future waits for it.
+*
+* So the display follows the producer's clock (an audio or video stream,
+* a show controller) with at most half a slot of error, and a fixed
+* delay on arrival times turns the queue into a jitter buffer.
+*/
+
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+static const int DEFAULT_PRESENT_DEPTH = 16;
+
+// Puts one frame on the display; called on the scheduler thread.
+typedef void (*presentSink_t)(void* ctx, const void* frame);
+
+struct presentEntry_t
+{
+    int64_t targetNs;
+    int buffer;
+};
+
+struct presentQueue_t
+{
+    uint32_t frameSize;
+    int depth;
+    int64_t slotNs;
+    int64_t epochNs;            // slot boundaries are epochNs + k * slotNs
+
+    uint8_t* buffers;           // depth + 1: one is being presented
+    presentEntry_t* entries;    // waiting frames, sorted by target
+    int count;
+    int* freeList;
+    int freeCount;
+    bool presenting;
+
+    presentSink_t sink;
+    void* sinkCtx;
+    pthread_t scheduler;
+    pthread_mutex_t lock;       // guards everything here
+    pthread_cond_t changed;
+    bool stop;
+
+    uint32_t submitted;
+    uint32_t presented;
+    uint32_t late;              // slot had passed
+    uint32_t superseded;        // a later frame took the same slot
+    uint32_t overflows;         // queue full: the earliest frame made room
+    int64_t maxErrorNs;         // worst |present time - target|
+};
+
+// Current CLOCK_MONOTONIC time in ns, the clock targets are given in.
+int64_t presentNow();
+
+bool presentInit(presentQueue_t* pQueue, uint32_t frameSize, int depth, int fps,
+    presentSink_t sink, void* sinkCtx);
+
+// Waits for every queued frame to be presented or dropped, then stops.
+void presentFree(presentQueue_t* pQueue);
+
+// Copy frame into the queue, to go up at targetNs.
+void presentSubmit(presentQueue_t* pQueue, const void* frame, int64_t targetNs);
+
+// Wait until nothing is queued or being presented.
+void presentFlush(presentQueue_t* pQueue);
+
+#endif // PRESENT_H
@@ -0,0 +1,176 @@
+/*
+* Terminal preview of the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "preview.h"
+
+// Worst case per cell: a cursor move, both colors, the 3 byte block.
+static const int CELL_BYTES_MAX = 12 + 2 * 20 + 3;
+
+struct cellWriter_t
+{
+    char* pOut;
+    int row;                    // cursor position in panel cells;
+    int col;                    // row PREVIEW_ROWS is the line below
+    rgbPixel_t fg;
+    rgbPixel_t bg;
+    bool colorsSet;
+};
+
+static inline uint8_t visible(uint8_t value)
+{
+    return value >= 64? 255 : value * 4;
+}
+
+static inline bool sameColor(const rgbPixel_t& a, const rgbPixel_t& b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static void moveTo(cellWriter_t* pWriter, int row, int col)
+{
+    if (row < pWriter->row)
+        pWriter->pOut += sprintf(pWriter->pOut, "\x1b[%dA", pWriter->row - row);
+    else if (row > pWriter->row)
+        pWriter->pOut += sprintf(pWriter->pOut, "\x1b[%dB", row - pWriter->row);
+    if (col != pWriter->col || row != pWriter->row)
+        pWriter->pOut += sprintf(pWriter->pOut, "\x1b[%dG", col + 1);
+    pWriter->row = row;
+    pWriter->col = col;
+}
+
+static void writeCell(cellWriter_t* pWriter, const rgbPixel_t& top, const rgbPixel_t& bottom)
+{
+    if (!pWriter->colorsSet || !sameColor(top, pWriter->fg))
+    {
+        pWriter->pOut += sprintf(pWriter->pOut, "\x1b[38;2;%d;%d;%dm",
+            visible(top.r), visible(top.g), visible(top.b));
+        pWriter->fg = top;
+    }
+    if (!pWriter->colorsSet || !sameColor(bottom, pWriter->bg))
+    {
+        pWriter->pOut += sprintf(pWriter->pOut, "\x1b[48;2;%d;%d;%dm",
+            visible(bottom.r), visible(bottom.g), visible(bottom.b));
+        pWriter->bg = bottom;
+    }
+    pWriter->colorsSet = true;
+
+    memcpy(pWriter->pOut, "\xe2\x96\x80", 3);    // U+2580 upper half block
+    pWriter->pOut += 3;
+    pWriter->col++;
+}
+
+bool previewInit(preview_t* pPreview, int fd)
+{
+    memset(pPreview, 0, sizeof(*pPreview));
+    pPreview->fd = fd;
+    pPreview->bufferSize = PREVIEW_ROWS * (GRID_WIDTH * CELL_BYTES_MAX + 16) + 32;
+    pPreview->buffer = (char*)malloc(pPreview->bufferSize);
+    if (pPreview->buffer == NULL)
+        return false;
+
+    // Hold printf output until the next frame, so previewFrame() can tell
+    // that something was printed under the panel and start a fresh one.
+    if (fd == STDOUT_FILENO)
+    {
+        fflush(stdout);
+        setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+    }
+    return true;
+}
+
+void previewFree(preview_t* pPreview)
+{
+    if (pPreview->fd == STDOUT_FILENO && pPreview->buffer != NULL)
+    {
+        fflush(stdout);
+        setvbuf(stdout, NULL, isatty(STDOUT_FILENO)? _IOLBF : _IOFBF, BUFSIZ);
+    }
+    free(pPreview->buffer);
+    pPreview->buffer = NULL;
+}
+
+void previewInvalidate(preview_t* pPreview)
+{
+    pPreview->drawn = false;
+}
+
+void previewFrame(preview_t* pPreview, const rgbPixel_t* frame)
+{
+    const rgbPixel_t black = { 0, 0, 0, 0 };
+    cellWriter_t writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.pOut = pPreview->buffer;
+    writer.row = PREVIEW_ROWS;
+    if (pPreview->fd == STDOUT_FILENO && __fpending(stdout) > 0)
+        previewInvalidate(pPreview);
+
+    for (int row = 0; row < PREVIEW_ROWS; row++)
+    {
+        const rgbPixel_t* pTop = &frame[2 * row * GRID_WIDTH];
+        const rgbPixel_t* pBottom = 2 * row + 1 < GRID_HEIGHT? pTop + GRID_WIDTH : NULL;
+        const rgbPixel_t* pShownTop = &pPreview->shown[2 * row * GRID_WIDTH];
+        const rgbPixel_t* pShownBottom = pShownTop + GRID_WIDTH;
+
+        if (!pPreview->drawn)
+        {
+            // A fresh panel is written out line by line.
+            for (int col = 0; col < GRID_WIDTH; col++)
+                writeCell(&writer, pTop[col], pBottom != NULL? pBottom[col] : black);
+            writer.pOut += sprintf(writer.pOut, "\x1b[0m\n");
+            writer.colorsSet = false;
+            pPreview->cellsDrawn += GRID_WIDTH;
+            continue;
+        }
+
+        for (int col = 0; col < GRID_WIDTH; col++)
+        {
+            if (sameColor(pTop[col], pShownTop[col]) &&
+                (pBottom == NULL || sameColor(pBottom[col], pShownBottom[col])))
+                continue;
+            moveTo(&writer, row, col);
+            writeCell(&writer, pTop[col], pBottom != NULL? pBottom[col] : black);
+            pPreview->cellsDrawn++;
+        }
+    }
+
+    if (pPreview->drawn)
+    {
+        if (writer.pOut == pPreview->buffer)
+        {
+            pPreview->frames++;
+            return;             // nothing changed
+        }
+        writer.pOut += sprintf(writer.pOut, "\x1b[0m");
+        moveTo(&writer, PREVIEW_ROWS, 0);
+    }
+    memcpy(pPreview->shown, frame, sizeof(pPreview->shown));
+    pPreview->drawn = true;
+    pPreview->frames++;
+
+    // Anything printf'd so far goes first, then the frame in one write.
+    fflush(stdout);
+    size_t len = writer.pOut - pPreview->buffer;
+    const char* p = pPreview->buffer;
+    while (len > 0)
+    {
+        ssize_t n = write(pPreview->fd, p, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        p += n;
+        len -= n;
+    }
+    pPreview->bytes += writer.pOut - pPreview->buffer;
+}
@@ -0,0 +1,54 @@
+/*
+* Terminal preview of the SPI NEOPixel display
+* By R. Blansett
+*
+* Draws the grid as a virtual panel in a truecolor terminal, two LED rows
+* per text row: each cell is an upper half block with the top LED as its
+* foreground and the bottom LED as its background. The first frame draws
+* the whole panel; after that only cells whose colors changed are
+* redrawn, reached with relative cursor moves, and each frame goes out as
+* a single write(). So animations can be watched live, at full frame
+* rate, with no LEDs attached.
+*
+* Text printed to stdout in between (a playlist's load errors, a mode's
+* stats) would scroll the panel out from under the cursor, so while a
+* preview is open on stdout, stdout is fully buffered and a frame that
+* finds output pending flushes it and draws a fresh panel below.
+*
+* LED values are kept low (the panel is blinding at full scale), so the
+* preview scales them up by 4 to be visible.
+*/
+
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+static const int PREVIEW_ROWS = (GRID_HEIGHT + 1) / 2;
+
+struct preview_t
+{
+    int fd;
+    bool drawn;                 // the panel is on screen just above the cursor
+    rgbPixel_t shown[GRID_AREA];
+    char* buffer;
+    uint32_t bufferSize;
+
+    uint32_t frames;
+    uint32_t cellsDrawn;
+    uint64_t bytes;
+};
+
+bool previewInit(preview_t* pPreview, int fd);
+void previewFree(preview_t* pPreview);
+
+// Show frame (GRID_AREA pixels, row-major), redrawing only what changed.
+void previewFrame(preview_t* pPreview, const rgbPixel_t* frame);
+
+// Something else was written to the terminal (other than through stdout,
+// which is caught): draw the next frame as a fresh panel.
+void previewInvalidate(preview_t* pPreview);
+
+#endif // PREVIEW_H
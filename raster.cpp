@@ -0,0 +1,310 @@
+/*
+* 2D raster operations for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "spiled.h"
+#include "compositor.h"
+#include "raster.h"
+
+static const rect_t NO_RECT = { 0, 0, 0, 0 };
+
+// Clip (x, y, width, height) to the surface; false if nothing is left.
+static bool clipRect(const surface_t* pDst, rect_t* pRect)
+{
+    int x0 = pRect->x < 0? 0 : pRect->x;
+    int y0 = pRect->y < 0? 0 : pRect->y;
+    int x1 = pRect->x + pRect->width;
+    int y1 = pRect->y + pRect->height;
+    if (x1 > pDst->width)
+        x1 = pDst->width;
+    if (y1 > pDst->height)
+        y1 = pDst->height;
+    if (x0 >= x1 || y0 >= y1)
+        return false;
+
+    pRect->x = x0;
+    pRect->y = y0;
+    pRect->width = x1 - x0;
+    pRect->height = y1 - y0;
+    return true;
+}
+
+static inline bool sameColor(rgbPixel_t a, rgbPixel_t b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+rect_t rectUnion(rect_t a, rect_t b)
+{
+    if (a.width == 0)
+        return b;
+    if (b.width == 0)
+        return a;
+
+    int x0 = a.x < b.x? a.x : b.x;
+    int y0 = a.y < b.y? a.y : b.y;
+    int x1 = a.x + a.width > b.x + b.width? a.x + a.width : b.x + b.width;
+    int y1 = a.y + a.height > b.y + b.height? a.y + a.height : b.y + b.height;
+    rect_t rect = { x0, y0, x1 - x0, y1 - y0 };
+    return rect;
+}
+
+rect_t rasterFillRect(surface_t* pDst, int x, int y, int width, int height,
+    rgbPixel_t color)
+{
+    rect_t rect = { x, y, width, height };
+    if (!clipRect(pDst, &rect))
+        return NO_RECT;
+
+    // Fill the first row, then copy it down.
+    rgbPixel_t* pFirst = &pDst->pixels[rect.y * pDst->stride + rect.x];
+    for (int col = 0; col < rect.width; col++)
+        pFirst[col] = color;
+    for (int row = 1; row < rect.height; row++)
+        memcpy(pFirst + row * pDst->stride, pFirst, rect.width * sizeof(rgbPixel_t));
+
+    return rect;
+}
+
+rect_t rasterLine(surface_t* pDst, int x0, int y0, int x1, int y1,
+    rgbPixel_t color)
+{
+    // Straight lines are just thin rectangles.
+    if (y0 == y1)
+        return rasterFillRect(pDst, x0 < x1? x0 : x1, y0, abs(x1 - x0) + 1, 1, color);
+    if (x0 == x1)
+        return rasterFillRect(pDst, x0, y0 < y1? y0 : y1, 1, abs(y1 - y0) + 1, color);
+
+    // Bresenham
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1? 1 : -1;
+    int sy = y0 < y1? 1 : -1;
+    int err = dx + dy;
+    rect_t touched = NO_RECT;
+
+    while (true)
+    {
+        if (x0 >= 0 && x0 < pDst->width && y0 >= 0 && y0 < pDst->height)
+        {
+            pDst->pixels[y0 * pDst->stride + x0] = color;
+            rect_t dot = { x0, y0, 1, 1 };
+            touched = rectUnion(touched, dot);
+        }
+        if (x0 == x1 && y0 == y1)
+            break;
+        int e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+    return touched;
+}
+
+void rasterCopyRect(surface_t* pDst, const surface_t* pSrc, rect_t rect)
+{
+    if (!clipRect(pDst, &rect) || !clipRect(pSrc, &rect))
+        return;
+
+    for (int row = rect.y; row < rect.y + rect.height; row++)
+    {
+        memcpy(&pDst->pixels[row * pDst->stride + rect.x],
+            &pSrc->pixels[row * pSrc->stride + rect.x],
+            rect.width * sizeof(rgbPixel_t));
+    }
+}
+
+rect_t rasterBlit(surface_t* pDst, const sprite_t* pSprite, int x, int y,
+    blitMode_t mode, rgbPixel_t key)
+{
+    rect_t rect = { x, y, pSprite->width, pSprite->height };
+    if (!clipRect(pDst, &rect))
+        return NO_RECT;
+
+    const rgbPixel_t* pSrc = &pSprite->pixels[(rect.y - y) * pSprite->stride + (rect.x - x)];
+    rgbPixel_t* pOut = &pDst->pixels[rect.y * pDst->stride + rect.x];
+
+    for (int row = 0; row < rect.height; row++)
+    {
+        switch (mode)
+        {
+            case BLIT_COPY:
+                memcpy(pOut, pSrc, rect.width * sizeof(rgbPixel_t));
+                break;
+
+            case BLIT_COLORKEY:
+                for (int col = 0; col < rect.width; col++)
+                {
+                    if (!sameColor(pSrc[col], key))
+                        pOut[col] = pSrc[col];
+                }
+                break;
+
+            case BLIT_ALPHA:
+                compositorBlendRow(pOut, pOut, pSrc, rect.width);
+                break;
+        }
+        pSrc += pSprite->stride;
+        pOut += pDst->stride;
+    }
+    return rect;
+}
+
+// Coverage of one sprite texel (0 when outside the sprite).
+static inline int texelAlpha(const sprite_t* pSprite, int u, int v,
+    blitMode_t mode, rgbPixel_t key, const rgbPixel_t** ppTexel)
+{
+    if (u < 0 || v < 0 || u >= pSprite->width || v >= pSprite->height)
+        return 0;
+
+    const rgbPixel_t* pTexel = &pSprite->pixels[v * pSprite->stride + u];
+    *ppTexel = pTexel;
+    switch (mode)
+    {
+        case BLIT_COLORKEY:
+            return sameColor(*pTexel, key)? 0 : 255;
+        case BLIT_ALPHA:
+            return pTexel->a;
+        default:
+            return 255;
+    }
+}
+
+// Destination pixels sampled per pass along a row.
+static const int BLIT_CHUNK = 64;
+
+rect_t rasterBlitTransformed(surface_t* pDst, const sprite_t* pSprite,
+    fixed_t cx, fixed_t cy, int angle, fixed_t scale,
+    blitMode_t mode, rgbPixel_t key)
+{
+    if (scale <= 0)
+        return NO_RECT;
+
+    double theta = (angle & 1023) * (2.0 * M_PI / 1024.0);
+    fixed_t cosA = TO_FIXED(cos(theta));
+    fixed_t sinA = TO_FIXED(sin(theta));
+
+    // Bounding box of the rotated, scaled sprite (plus a pixel for the filter).
+    int64_t halfW = (int64_t)pSprite->width * scale / 2;
+    int64_t halfH = (int64_t)pSprite->height * scale / 2;
+    int64_t extentX = (llabs(halfW * cosA) + llabs(halfH * sinA)) >> 16;
+    int64_t extentY = (llabs(halfW * sinA) + llabs(halfH * cosA)) >> 16;
+    rect_t rect;
+    rect.x = (int)((cx - extentX) >> 16) - 1;
+    rect.y = (int)((cy - extentY) >> 16) - 1;
+    rect.width = (int)((cx + extentX) >> 16) + 2 - rect.x;
+    rect.height = (int)((cy + extentY) >> 16) + 2 - rect.y;
+    if (!clipRect(pDst, &rect))
+        return NO_RECT;
+
+    // Inverse mapping: destination step -> sprite step, in 16.16.
+    fixed_t duCol = (fixed_t)(((int64_t)cosA << 16) / scale);
+    fixed_t dvCol = (fixed_t)(-((int64_t)sinA << 16) / scale);
+    fixed_t duRow = -dvCol;
+    fixed_t dvRow = duCol;
+
+    // Sprite coordinates of the first pixel centre, shifted by half a texel
+    // so that the integer part indexes the top-left filter tap.
+    fixed_t dx = TO_FIXED(rect.x) + FIXED_ONE / 2 - cx;
+    fixed_t dy = TO_FIXED(rect.y) + FIXED_ONE / 2 - cy;
+    fixed_t uRow = (fixed_t)(((int64_t)dx * duCol + (int64_t)dy * duRow) >> 16)
+        + pSprite->width * FIXED_ONE / 2 - FIXED_ONE / 2;
+    fixed_t vRow = (fixed_t)(((int64_t)dx * dvCol + (int64_t)dy * dvRow) >> 16)
+        + pSprite->height * FIXED_ONE / 2 - FIXED_ONE / 2;
+
+    // Sampled a chunk at a time, so a wide destination needs no more stack.
+    rgbPixel_t sampled[BLIT_CHUNK];
+    rect_t touched = NO_RECT;
+
+    for (int row = 0; row < rect.height; row++)
+    {
+        fixed_t u = uRow;
+        fixed_t v = vRow;
+
+        for (int start = 0; start < rect.width; start += BLIT_CHUNK)
+        {
+            int count = rect.width - start < BLIT_CHUNK? rect.width - start : BLIT_CHUNK;
+            int first = -1;
+            int last = -1;
+
+            for (int col = 0; col < count; col++)
+            {
+                int iu = u >> 16;
+                int iv = v >> 16;
+                int fu = (u >> 8) & 0xFF;
+                int fv = (v >> 8) & 0xFF;
+                u += duCol;
+                v += dvCol;
+
+                // Bilinear weights in 0..256, summing to 256.
+                int w[4] = {
+                    ((256 - fu) * (256 - fv)) >> 8,
+                    (fu * (256 - fv)) >> 8,
+                    ((256 - fu) * fv) >> 8,
+                    0 };
+                w[3] = 256 - w[0] - w[1] - w[2];
+                const rgbPixel_t* pTexel[4] = { NULL, NULL, NULL, NULL };
+                int a[4] = {
+                    texelAlpha(pSprite, iu, iv, mode, key, &pTexel[0]),
+                    texelAlpha(pSprite, iu + 1, iv, mode, key, &pTexel[1]),
+                    texelAlpha(pSprite, iu, iv + 1, mode, key, &pTexel[2]),
+                    texelAlpha(pSprite, iu + 1, iv + 1, mode, key, &pTexel[3]) };
+
+                // Weight the colors by coverage so transparent texels don't bleed.
+                uint32_t sumA = 0, sumR = 0, sumG = 0, sumB = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    uint32_t wa = a[i] * w[i];
+                    if (wa == 0)
+                        continue;
+                    sumA += wa;
+                    sumR += pTexel[i]->r * wa;
+                    sumG += pTexel[i]->g * wa;
+                    sumB += pTexel[i]->b * wa;
+                }
+
+                rgbPixel_t& out = sampled[col];
+                out.a = sumA >> 8;
+                if (out.a == 0)
+                    continue;
+                out.r = sumR / sumA;
+                out.g = sumG / sumA;
+                out.b = sumB / sumA;
+                if (first < 0)
+                    first = col;
+                last = col;
+            }
+
+            if (first >= 0)
+            {
+                // Zero coverage inside the span blends to the destination.
+                for (int col = first; col <= last; col++)
+                {
+                    if (sampled[col].a == 0)
+                        sampled[col].r = sampled[col].g = sampled[col].b = 0;
+                }
+                int x = rect.x + start + first;
+                rgbPixel_t* pOut = &pDst->pixels[(rect.y + row) * pDst->stride + x];
+                compositorBlendRow(pOut, pOut, &sampled[first], last - first + 1);
+                rect_t span = { x, rect.y + row, last - first + 1, 1 };
+                touched = rectUnion(touched, span);
+            }
+        }
+
+        uRow += duRow;
+        vRow += dvRow;
+    }
+    return touched;
+}
@@ -0,0 +1,105 @@
+/*
+* 2D raster operations for the SPI NEOPixel display
+* By R. Blansett
+*
+* Fill, line and sprite blits onto any rgbPixel_t surface (rgbGrid, a
+* compositor layer, an off-screen buffer). Everything clips to the
+* surface and works a row at a time. Blits return the rectangle they
+* touched so callers can restore or re-encode just that part.
+*/
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+// 16.16 fixed point
+typedef int32_t fixed_t;
+#define FIXED_ONE   (1 << 16)
+#define TO_FIXED(x) ((fixed_t)((x) * FIXED_ONE))
+
+struct surface_t
+{
+    rgbPixel_t* pixels;
+    int width;
+    int height;
+    int stride;     // pixels from one row to the next
+};
+
+struct sprite_t
+{
+    const rgbPixel_t* pixels;
+    int width;
+    int height;
+    int stride;
+};
+
+struct rect_t
+{
+    int x;
+    int y;
+    int width;      // 0 = nothing touched
+    int height;
+};
+
+enum blitMode_t
+{
+    BLIT_COPY,      // opaque copy
+    BLIT_COLORKEY,  // skip pixels whose r,g,b equal the key
+    BLIT_ALPHA,     // blend using the sprite's a channel
+};
+
+static inline surface_t makeSurface(rgbPixel_t* pixels, int width, int height)
+{
+    surface_t surface = { pixels, width, height, width };
+    return surface;
+}
+
+static inline surface_t gridSurface()
+{
+    return makeSurface(rgbGrid, GRID_WIDTH, GRID_HEIGHT);
+}
+
+static inline sprite_t makeSprite(const rgbPixel_t* pixels, int width, int height)
+{
+    sprite_t sprite = { pixels, width, height, width };
+    return sprite;
+}
+
+rect_t rasterFillRect(surface_t* pDst, int x, int y, int width, int height,
+    rgbPixel_t color);
+
+rect_t rasterLine(surface_t* pDst, int x0, int y0, int x1, int y1,
+    rgbPixel_t color);
+
+// Copy a rectangle between two surfaces of the same size (e.g. to restore
+// the background under a sprite's previous position).
+void rasterCopyRect(surface_t* pDst, const surface_t* pSrc, rect_t rect);
+
+// Integer placement; the sprite's top left lands on (x, y).
+rect_t rasterBlit(surface_t* pDst, const sprite_t* pSprite, int x, int y,
+    blitMode_t mode, rgbPixel_t key);
+
+// The sprite's centre lands on (cx, cy), which may be between pixels.
+// It is rotated by angle (in 1/1024ths of a turn) and scaled by scale,
+// with bilinear sampling so sub-pixel motion and edges stay smooth.
+rect_t rasterBlitTransformed(surface_t* pDst, const sprite_t* pSprite,
+    fixed_t cx, fixed_t cy, int angle, fixed_t scale,
+    blitMode_t mode, rgbPixel_t key);
+
+// Smallest rectangle holding both.
+rect_t rectUnion(rect_t a, rect_t b);
+
+// The grid rows rect covers, for gridTransferRows().
+static inline rowMask_t rectRows(rect_t rect)
+{
+    if (rect.width <= 0 || rect.height <= 0)
+        return 0;
+    rowMask_t rows = rect.height >= 64? ~(rowMask_t)0 :
+        (((rowMask_t)1 << rect.height) - 1);
+    return (rows << rect.y) & ALL_ROWS;
+}
+
+#endif // RASTER_H
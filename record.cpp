@@ -0,0 +1,239 @@
+/*
+* Wire-frame recorder and replay for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "record.h"
+
+static const char MAGIC[4] = { 'S', 'P', 'L', 'R' };
+static const uint32_t VERSION = 1;
+static const int HEADER_SIZE = 16;
+static const int RECORD_HEADER_SIZE = 12;
+
+static uint64_t nowNs()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void writeHeader(recorder_t* pRec)
+{
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, MAGIC, 4);
+    put32(&header[4], VERSION);
+    put32(&header[8], pRec->maxLength);
+    put32(&header[12], pRec->recorded - pRec->dropped);
+    if (fwrite(header, sizeof(header), 1, pRec->pFile) != 1)
+        pRec->writeFailed = true;
+}
+
+static void* writerThread(void* arg)
+{
+    recorder_t* pRec = (recorder_t*)arg;
+
+    while (true)
+    {
+        sem_wait(&pRec->filled);
+        if (__atomic_load_n(&pRec->stop, __ATOMIC_ACQUIRE))
+            break;
+
+        int slot = pRec->tail;
+
+        uint8_t header[RECORD_HEADER_SIZE];
+        uint64_t time = pRec->times[slot];
+        put32(&header[0], (uint32_t)time);
+        put32(&header[4], (uint32_t)(time >> 32));
+        put32(&header[8], pRec->lengths[slot]);
+        if (fwrite(header, sizeof(header), 1, pRec->pFile) != 1 ||
+            fwrite(&pRec->ring[(size_t)slot * pRec->maxLength], pRec->lengths[slot], 1,
+                pRec->pFile) != 1)
+            pRec->writeFailed = true;
+
+        pRec->tail = (slot + 1) % pRec->slots;
+        sem_post(&pRec->free);
+    }
+    return NULL;
+}
+
+bool recordOpen(recorder_t* pRec, const char* path, uint32_t maxLength, int slots)
+{
+    memset(pRec, 0, sizeof(*pRec));
+    pRec->maxLength = maxLength;
+    pRec->slots = slots > 1? slots : DEFAULT_RECORD_SLOTS;
+    pRec->pFile = fopen(path, "wb");
+    if (pRec->pFile == NULL)
+        return false;
+
+    pRec->ring = (uint8_t*)malloc((size_t)pRec->slots * maxLength);
+    pRec->lengths = (uint32_t*)calloc(pRec->slots, sizeof(uint32_t));
+    pRec->times = (uint64_t*)calloc(pRec->slots, sizeof(uint64_t));
+    bool ok = pRec->ring != NULL && pRec->lengths != NULL && pRec->times != NULL;
+
+    // The record count is filled in on close.
+    if (ok)
+    {
+        writeHeader(pRec);
+        sem_init(&pRec->filled, 0, 0);
+        sem_init(&pRec->free, 0, pRec->slots);
+        ok = pthread_create(&pRec->writer, NULL, writerThread, pRec) == 0;
+        if (!ok)
+        {
+            sem_destroy(&pRec->filled);
+            sem_destroy(&pRec->free);
+        }
+    }
+    if (!ok)
+    {
+        fclose(pRec->pFile);
+        free(pRec->ring);
+        free(pRec->lengths);
+        free(pRec->times);
+    }
+    return ok;
+}
+
+void recordFrame(recorder_t* pRec, const uint8_t* data, uint32_t len, uint64_t atNs)
+{
+    if (atNs == 0)
+        atNs = nowNs();
+    if (pRec->recorded++ == 0)
+        pRec->startNs = atNs;
+
+    if (sem_trywait(&pRec->free) != 0)
+    {
+        pRec->dropped++;
+        return;
+    }
+
+    if (len > pRec->maxLength)
+    {
+        len = pRec->maxLength;
+        pRec->truncated++;
+    }
+    int slot = pRec->head;
+    memcpy(&pRec->ring[(size_t)slot * pRec->maxLength], data, len);
+    pRec->lengths[slot] = len;
+    pRec->times[slot] = atNs - pRec->startNs;
+    pRec->bytes += len;
+    pRec->head = (slot + 1) % pRec->slots;
+    sem_post(&pRec->filled);
+}
+
+bool recordClose(recorder_t* pRec)
+{
+    // Once every slot is free again, everything queued is on its way out.
+    for (int i = 0; i < pRec->slots; i++)
+        sem_wait(&pRec->free);
+    __atomic_store_n(&pRec->stop, true, __ATOMIC_RELEASE);
+    sem_post(&pRec->filled);
+    pthread_join(pRec->writer, NULL);
+
+    rewind(pRec->pFile);
+    writeHeader(pRec);
+    if (fclose(pRec->pFile) != 0)
+        pRec->writeFailed = true;
+
+    sem_destroy(&pRec->filled);
+    sem_destroy(&pRec->free);
+    free(pRec->ring);
+    free(pRec->lengths);
+    free(pRec->times);
+    pRec->ring = NULL;
+    return !pRec->writeFailed;
+}
+
+bool replayRun(const char* path, bool maxSpeed, replaySink_t sink, void* ctx,
+    replayStats_t* pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const uint8_t* pData = (const uint8_t*)map;
+    if (memcmp(pData, MAGIC, 4) != 0 || get32(&pData[4]) != VERSION)
+    {
+        munmap(map, size);
+        return false;
+    }
+    uint32_t maxLength = get32(&pData[8]);
+    uint32_t count = get32(&pData[12]);
+
+    // The whole capture is faulted in up front, so a max-speed run
+    // measures the transport and not the disk.
+    madvise(map, size, MADV_WILLNEED);
+    volatile uint8_t touch = 0;
+    for (size_t i = 0; i < size; i += 4096)
+        touch += pData[i];
+
+    uint64_t start = nowNs();
+    size_t offset = HEADER_SIZE;
+    for (uint32_t i = 0; i < count && offset + RECORD_HEADER_SIZE <= size; i++)
+    {
+        const uint8_t* pRecord = &pData[offset];
+        uint64_t time = get32(pRecord) | (uint64_t)get32(&pRecord[4]) << 32;
+        uint32_t len = get32(&pRecord[8]);
+        if (len > maxLength || offset + RECORD_HEADER_SIZE + len > size)
+            break;
+
+        if (!maxSpeed)
+        {
+            uint64_t due = start + time;
+            uint64_t now = nowNs();
+            if (now < due)
+            {
+                struct timespec t = { (time_t)(due / 1000000000ull), (long)(due % 1000000000ull) };
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+            }
+            else if (now - due > 1000000)
+            {
+                pStats->late++;
+                if (now - due > pStats->maxLateNs)
+                    pStats->maxLateNs = now - due;
+            }
+        }
+
+        sink(ctx, pRecord + RECORD_HEADER_SIZE, len);
+        pStats->frames++;
+        pStats->bytes += len;
+        offset += RECORD_HEADER_SIZE + len;
+    }
+    pStats->elapsedNs = nowNs() - start;
+
+    munmap(map, size);
+    return true;
+}
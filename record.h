@@ -0,0 +1,81 @@
+/*
+* Wire-frame recorder and replay for the SPI NEOPixel display
+* By R. Blansett
+*
+* The recorder keeps a copy of every buffer handed to the SPI driver,
+* exactly as sent (symbols, REFRESH tail, stream chunks and all), with
+* the time it went out. The frame loop only copies the bytes into a ring
+* slot; a writer thread takes them from there to disk. If the writer
+* falls behind and the ring fills, frames are dropped and counted rather
+* than ever making the frame loop wait.
+*
+* A recording replays either at its original timing, to reproduce what
+* a panel was shown, or back to back as fast as the transport takes it,
+* which makes it a repeatable throughput benchmark.
+*
+* File: "SPLR", then version, most bytes per record and record count
+* (uint32 each, little endian), then the records, each a uint64 time in
+* ns since the first, a uint32 length and that many bytes.
+*/
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+static const int DEFAULT_RECORD_SLOTS = 64;
+
+struct recorder_t
+{
+    FILE* pFile;
+    uint32_t maxLength;         // bytes per slot
+    int slots;
+    uint8_t* ring;
+    uint32_t* lengths;
+    uint64_t* times;
+    int head;                   // next slot to fill (recording thread)
+    int tail;                   // next slot to write (writer thread)
+    sem_t filled;
+    sem_t free;
+    pthread_t writer;
+    bool stop;                  // accessed with __atomic builtins
+    bool writeFailed;
+    uint64_t startNs;
+
+    uint32_t recorded;
+    uint32_t dropped;           // ring full
+    uint32_t truncated;         // longer than a slot
+    uint64_t bytes;
+};
+
+// Record into path, frames of up to maxLength bytes.
+bool recordOpen(recorder_t* pRec, const char* path, uint32_t maxLength, int slots);
+
+// Copy one buffer as sent at atNs (CLOCK_MONOTONIC, 0 for now). Only one
+// thread at a time may record; it never blocks.
+void recordFrame(recorder_t* pRec, const uint8_t* data, uint32_t len, uint64_t atNs);
+
+// Write out what is queued and finish the file. False if any write failed.
+bool recordClose(recorder_t* pRec);
+
+// Sends one recorded buffer.
+typedef void (*replaySink_t)(void* ctx, const uint8_t* data, uint32_t len);
+
+struct replayStats_t
+{
+    uint32_t frames;
+    uint64_t bytes;
+    uint64_t elapsedNs;
+    uint32_t late;              // sent over 1 ms after its original time
+    uint64_t maxLateNs;
+};
+
+// Send a recording through sink, at its own pace or, with maxSpeed,
+// back to back. Returns false if the file can't be read.
+bool replayRun(const char* path, bool maxSpeed, replaySink_t sink, void* ctx,
+    replayStats_t* pStats);
+
+#endif // RECORD_H
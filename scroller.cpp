@@ -0,0 +1,142 @@
+/*
+* Pre-rendered scrolling text for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "spiled.h"
+#include "raster.h"
+#include "scroller.h"
+#include "pixelmap.h"
+#include "font5x7.h"
+
+static const int GLYPH_WIDTH = 5;
+static const int GLYPH_HEIGHT = 7;
+static const int GLYPH_SPACING = 1;
+
+static const int PIXEL_BYTES = display_t::WIRE_PIXEL_SIZE;
+
+bool scrollerInit(scroller_t* pScroll, const char* text, rgbPixel_t color)
+{
+    memset(pScroll, 0, sizeof(*pScroll));
+
+    // 7-row glyphs with a row of margin: scale 2 on the 16-row panel.
+    pScroll->scale = GRID_HEIGHT / (GLYPH_HEIGHT + 1);
+    if (pScroll->scale < 1)
+        pScroll->scale = 1;
+    int scale = pScroll->scale;
+    int advance = (GLYPH_WIDTH + GLYPH_SPACING) * scale;
+    int textWidth = strlen(text) * advance;
+
+    pScroll->stripWidth = GRID_WIDTH + textWidth + GRID_WIDTH;
+    size_t area = (size_t)pScroll->stripWidth * GRID_HEIGHT;
+    pScroll->strip = (rgbPixel_t*)calloc(area, sizeof(rgbPixel_t));
+    pScroll->wire = (uint8_t*)malloc(area * PIXEL_BYTES);
+    pScroll->wireMirror = (uint8_t*)malloc(area * PIXEL_BYTES);
+    if (!pScroll->strip || !pScroll->wire || !pScroll->wireMirror)
+    {
+        scrollerFree(pScroll);
+        return false;
+    }
+
+    surface_t surface = makeSurface(pScroll->strip, pScroll->stripWidth, GRID_HEIGHT);
+    int top = (GRID_HEIGHT - GLYPH_HEIGHT * scale) / 2;
+    int x = GRID_WIDTH;
+
+    for (const char* p = text; *p; p++, x += advance)
+    {
+        unsigned char c = *p;
+        if (c < 0x20 || c > 0x7E)
+            c = '?';
+        const uint8_t* pGlyph = font5x7[c - 0x20];
+
+        for (int col = 0; col < GLYPH_WIDTH; col++)
+        {
+            for (int row = 0; row < GLYPH_HEIGHT; row++)
+            {
+                if (pGlyph[col] & (1 << row))
+                {
+                    rasterFillRect(&surface, x + col * scale, top + row * scale,
+                        scale, scale, color);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void scrollerFree(scroller_t* pScroll)
+{
+    free(pScroll->strip);
+    free(pScroll->wire);
+    free(pScroll->wireMirror);
+    memset(pScroll, 0, sizeof(*pScroll));
+}
+
+surface_t scrollerView(const scroller_t* pScroll, int offset)
+{
+    surface_t view = { pScroll->strip + offset, GRID_WIDTH, GRID_HEIGHT,
+        pScroll->stripWidth };
+    return view;
+}
+
+// Encode strip columns [from, to) into both wire images.
+static void encodeColumns(scroller_t* pScroll, int from, int to)
+{
+    int width = pScroll->stripWidth;
+    for (int row = 0; row < GRID_HEIGHT; row++)
+    {
+        const rgbPixel_t* pRow = &pScroll->strip[row * width];
+        uint8_t* pWire = &pScroll->wire[row * width * PIXEL_BYTES];
+        uint8_t* pMirror = &pScroll->wireMirror[row * width * PIXEL_BYTES];
+        for (int col = from; col < to; col++)
+        {
+            display_t::encodePixel(&pWire[col * PIXEL_BYTES], pRow[col]);
+            memcpy(&pMirror[(width - 1 - col) * PIXEL_BYTES],
+                &pWire[col * PIXEL_BYTES], PIXEL_BYTES);
+        }
+    }
+}
+
+void scrollerToTxBuffer(scroller_t* pScroll, int offset)
+{
+    if (offset < 0)
+        offset = 0;
+    if (offset > scrollerLength(pScroll))
+        offset = scrollerLength(pScroll);
+
+    int needed = offset + GRID_WIDTH;
+    if (needed > pScroll->encodedColumns)
+    {
+        encodeColumns(pScroll, pScroll->encodedColumns, needed);
+        pScroll->encodedColumns = needed;
+    }
+
+    // Rows wired as one run of LEDs (either direction) are a single copy
+    // out of the matching wire image; anything else is scattered.
+    int width = pScroll->stripWidth;
+    for (int row = 0; row < GRID_HEIGHT; row++)
+    {
+        int first, step;
+        if (pixelMapRowRun(row, &first, &step))
+        {
+            const uint8_t* pSrc = step > 0?
+                &pScroll->wire[(row * width + offset) * PIXEL_BYTES] :
+                &pScroll->wireMirror[(row * width + width - offset - GRID_WIDTH) * PIXEL_BYTES];
+            int start = step > 0? first : first - (GRID_WIDTH - 1);
+            memcpy(&txBuffer[start * PIXEL_BYTES], pSrc, GRID_WIDTH * PIXEL_BYTES);
+        }
+        else
+        {
+            const uint8_t* pSrc = &pScroll->wire[(row * width + offset) * PIXEL_BYTES];
+            const uint16_t* pMap = &ledMap[row * GRID_WIDTH];
+            for (int col = 0; col < GRID_WIDTH; col++)
+            {
+                memcpy(&txBuffer[pMap[col] * PIXEL_BYTES],
+                    &pSrc[col * PIXEL_BYTES], PIXEL_BYTES);
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+* Pre-rendered scrolling text for the SPI NEOPixel display
+* By R. Blansett
+*
+* A message is rendered once, with the 5x7 font scaled to fit the grid
+* height, into an off-screen strip one grid tall and as wide as the text
+* plus a blank grid on either side. Each frame is then just a viewport
+* offset into the strip.
+*
+* The strip is also kept in wire form (both column orders, to suit
+* serpentine rows), encoded lazily as columns first come into view.
+* Sending a frame is then one row copy per grid row, as long as each row
+* is wired as a single run of LEDs (see pixelmap.h).
+*/
+
+#ifndef SCROLLER_H
+#define SCROLLER_H
+
+#include "spiled.h"
+#include "raster.h"
+
+struct scroller_t
+{
+    rgbPixel_t* strip;          // GRID_HEIGHT rows of stripWidth pixels
+    uint8_t* wire;              // strip encoded in column order
+    uint8_t* wireMirror;        // strip encoded in reverse column order
+    int stripWidth;
+    int encodedColumns;         // columns [0, encodedColumns) are encoded
+    int scale;                  // glyph pixel size
+};
+
+// Render text into a new strip. Returns false if out of memory.
+bool scrollerInit(scroller_t* pScroll, const char* text, rgbPixel_t color);
+
+void scrollerFree(scroller_t* pScroll);
+
+// Offsets run from 0 (blank) to scrollerLength() (blank again).
+static inline int scrollerLength(const scroller_t* pScroll)
+{
+    return pScroll->stripWidth - GRID_WIDTH;
+}
+
+// Grid-sized RGB view of the strip at offset (no copy).
+surface_t scrollerView(const scroller_t* pScroll, int offset);
+
+// Put the viewport at offset straight into txBuffer (wire order),
+// encoding only the columns not seen before.
+void scrollerToTxBuffer(scroller_t* pScroll, int offset);
+
+#endif // SCROLLER_H
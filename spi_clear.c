@@ -1,6 +1,6 @@
 /*
  * Clear the Display
- * SPI NEOPixel 16x16 RGB LED display (using spidev driver)
+ * SPI NEOPixel 16x16 RGB LED display (using libspiled)
  * By Rob Blansett
  *
  * Initially derived from:
@@ -16,23 +16,13 @@
  */
 
 #include <stdint.h>
-#include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <linux/types.h>
 #include <linux/spi/spidev.h>
 
-#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
-
-#define REFRESH 0x00	// 00000000 - represents "RESET"
-#define _0_0	0x88	// 10001000 - represents 00
-#define _0_1 	0x8C	// 10001100 - represents 01
-#define _1_0 	0xC8	// 11001000 - represents 10
-#define _1_1 	0xCC	// 11001100 - represents 11
-
+#include "libspiled.h"
 
 static void pabort(const char *s)
 {
@@ -46,1105 +36,6 @@ static uint8_t bits = 8;
 static uint32_t speed = 8000000;
 static uint16_t delay;
 
-static void transfer(int fd)
-{
-	int ret;
-	uint8_t tx[] = {
-// Row 0
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 1
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 2
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 3
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 4
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 5
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 6
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 7
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 8
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 9
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 10
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 11
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 12
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 13
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 14
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Row 15
-		_0_0,_0_0,_0_0,_0_0, // 0
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 1
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 2
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 3
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 4
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 5
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 6
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 7
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 8
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 9
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 10
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 11
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 12
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 13
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 14
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-		_0_0,_0_0,_0_0,_0_0, // 15
-		_0_0,_0_0,_0_0,_0_0,
-		_0_0,_0_0,_0_0,_0_0,
-
-// Send REFRESH (zero) here to cause the freshly written data to be latched
-// Datasheet says it should be at least 280 us / at 8Mbs, that's 1 us per byte.
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 10
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 20
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 30
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 40
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 50
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 60
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 70
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 80
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 90
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 100
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 110
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 120
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 130
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 140
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 150
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 160
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 170
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 180
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 190
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 200
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 210
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 220
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 230
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 240
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 250
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 260
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 270
-		REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, REFRESH, // 280
-	};
-	uint8_t rx[ARRAY_SIZE(tx)] = {0, };
-	struct spi_ioc_transfer tr = {
-		.tx_buf = (unsigned long)tx,
-		.rx_buf = (unsigned long)rx,
-		.len = ARRAY_SIZE(tx),
-		.delay_usecs = delay,
-		.speed_hz = speed,
-		.bits_per_word = bits,
-	};
-
-	ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-	if (ret < 1)
-		pabort("can't send spi message");
-
-#if 0
-	for (ret = 0; ret < ARRAY_SIZE(tx); ret++) {
-		if (!(ret % 16))
-			puts("");
-		printf("%.2X ", rx[ret]);
-	}
-	puts("");
-#endif	
-}
-
 static void print_usage(const char *prog)
 {
 	printf("Usage: %s [-DsbdlHOLC3]\n", prog);
@@ -1232,55 +123,32 @@ static void parse_opts(int argc, char *argv[])
 
 int main(int argc, char *argv[])
 {
-	int ret = 0;
-	int fd;
+	spiledConfig_t config;
+	spiled_t *pLed;
+	spiledPixel_t *frame;
 
 	parse_opts(argc, argv);
 
-	fd = open(device, O_RDWR);
-	if (fd < 0)
-		pabort("can't open device");
-
-	/*
-	 * spi mode
-	 */
-	ret = ioctl(fd, SPI_IOC_WR_MODE, &mode);
-	if (ret == -1)
-		pabort("can't set spi mode");
-
-	ret = ioctl(fd, SPI_IOC_RD_MODE, &mode);
-	if (ret == -1)
-		pabort("can't get spi mode");
+	spiledDefaultConfig(&config);
+	config.speedHz = speed;
+	config.mode = mode;
+	config.bits = bits;
+	config.delayUsecs = delay;
+	config.keepaliveMs = 0;
 
-	/*
-	 * bits per word
-	 */
-	ret = ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits);
-	if (ret == -1)
-		pabort("can't set bits per word");
-
-	ret = ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &bits);
-	if (ret == -1)
-		pabort("can't get bits per word");
+	pLed = spiledOpen(device, &config);
+	if (pLed == NULL)
+		pabort("can't open device");
 
 	/*
-	 * max speed hz
+	 * all LEDs off
 	 */
-	ret = ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
-	if (ret == -1)
-		pabort("can't set max speed hz");
-
-	ret = ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed);
-	if (ret == -1)
-		pabort("can't get max speed hz");
-
-	printf("spi mode: %d\n", mode);
-	printf("bits per word: %d\n", bits);
-	printf("max speed: %d Hz (%d KHz)\n", speed, speed/1000);
-
-	transfer(fd);
+	frame = spiledFrame(pLed);
+	memset(frame, 0, spiledWidth(pLed) * spiledHeight(pLed) * sizeof(*frame));
+	if (spiledPresent(pLed, SPILED_BLOCK) < 0)
+		pabort("can't send spi message");
 
-	close(fd);
+	spiledClose(pLed);
 
-	return ret;
+	return 0;
 }
@@ -17,27 +17,43 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <linux/types.h>
-#include <linux/spi/spidev.h>
 #include <math.h>
 #include <time.h>
 
+#include "spiled.h"
+#include "libspiled.h"
+#include "bmp24.h"
+#include "playback.h"
+#include "dmxrecv.h"
+#include "compositor.h"
+#include "raster.h"
+#include "scroller.h"
+#include "pixelmap.h"
+#include "anim.h"
+#include "batch.h"
+#include "transition.h"
+#include "tilepool.h"
+#include "patterns.h"
+#include "stream.h"
+#include "idle.h"
+#include "wire.h"
+#include "assetcache.h"
+#include "palette.h"
+#include "present.h"
+#include "audio.h"
+#include "life.h"
+#include "preview.h"
+#include "trace.h"
+#include "record.h"
+#include "expr.h"
+#include "arena.h"
+#include "timing.h"
 #include "yoda16x16x24bit.h"
 #include "redball16x16x24bit.h"
 
 
-#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
-
-#define REFRESH 0x00	// 00000000 - represents "RESET"
-#define _0_0	0x88	// 10001000 - represents 00
-#define _0_1 	0x8C	// 10001100 - represents 01
-#define _1_0 	0xC8	// 11001000 - represents 10
-#define _1_1 	0xCC	// 11001100 - represents 11
-
-
 static void pabort(const char *s)
 {
     perror(s);
@@ -51,12 +67,38 @@ static uint8_t bits = 8;
 static uint32_t speed = 8000000;
 static uint16_t delay;
 static uint16_t pattern = 0;
-
-static const uint16_t GRID_WIDTH = 16;
-static const uint16_t GRID_HEIGHT = 16;
-static const uint16_t REFRESH_SIZE = 280;
-static const uint16_t BITS_PER_SPI_BYTE = 2;
-static const uint16_t SPI_BYTES_PER_BYTE = 4;
+static const char *animDir = NULL;
+static int frameRate = 30;
+static bool frameRateGiven = false;
+static const char *animFile = NULL;
+static int prefetchFrames = 8;
+static bool loopAnim = false;
+static const char *dmxProtocol = NULL;
+static const char *text = NULL;
+static const char *layout = DEFAULT_LAYOUT;
+static int latencyMs = 100;
+static int streamChunk = 0;
+static int keepaliveMs = DEFAULT_KEEPALIVE_MS;
+static const char *verifyChip = NULL;
+static const char *cacheDir = NULL;
+static int cacheKB = DEFAULT_CACHE_KB;
+static int arenaKB = DEFAULT_ARENA_KB;
+static int queueDelayMs = -1;
+static const char *audioPath = NULL;
+static int fftSize = DEFAULT_FFT_SIZE;
+static int lifeSize = 256;
+static const char *lifeRule = NULL;
+static bool previewing = false;
+static const char *traceFile = NULL;
+static const char *recordFile = NULL;
+static const char *replayFile = NULL;
+static bool replayMaxSpeed = false;
+static const char *exprText = NULL;
+static playlistConfig_t playlist = { TRANSITION_FADE, 1000, 3000, 30, false };
+static dmxConfig_t dmxConfig = { false, 0, 1, 0, NULL, 0 };
+
+// The device, opened and configured through libspiled.
+static spiled_t* pLed = NULL;
 
 // Space for 16x16 24-bit (8-bits per color) LEDs
 // My set up uses each SPI byte to encode 2 bits of the LED data.
@@ -64,101 +106,114 @@ static const uint16_t SPI_BYTES_PER_BYTE = 4;
 // Datasheet says it should be at least 280 us / at 8Mbs, that's 1 us per byte.
 // Hence 280 additional bytes.
 
-static const uint16_t txBuffer_SIZE = GRID_WIDTH * GRID_HEIGHT * (3*SPI_BYTES_PER_BYTE) + 280;
-static uint8_t txBuffer[txBuffer_SIZE] = {0, }; 
-static uint8_t rxBuffer[sizeof(txBuffer)] = {0, };
+display_t display(ledMap);
+rgbPixel_t (&rgbGrid)[GRID_AREA] = display.rgb;
+uint8_t (&txBuffer)[txBuffer_SIZE] = display.tx;
 
-struct rgbPixel_t
-{
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a; // alpha (make it an even number)
-} rgbGrid[GRID_WIDTH * GRID_HEIGHT];
+// With -S, frames go out in chunks through a stream instead of txBuffer.
+static wireStream_t stream;
+static bool streaming = false;
+static uint16_t ledToPixel[GRID_AREA];
 
+// Frames identical to the last one sent are skipped (see idle.h).
+static idleFilter_t idle;
 
-struct spiRgbPixel_t
-{
-    // My scheme requires SPI 4 bytes to make 8 bits:
-    // IMPORTANT: In the LED, Green is first 8 bits, so it's GRB
-    // IMPORTANT: In the 16x16 LED panel, the even rows are order-reversed.
-    uint8_t g[SPI_BYTES_PER_BYTE];
-    uint8_t r[SPI_BYTES_PER_BYTE];
-    uint8_t b[SPI_BYTES_PER_BYTE];
-} spiGrid[GRID_WIDTH * GRID_HEIGHT];
-
+// With -C, converted BMPs are kept on disk (see assetcache.h).
+static assetCache_t cache;
+static bool caching = false;
 
-static void gridTransfer(int fd);
+// BMPs are read into this, sized once with -k (see arena.h).
+static arena_t arena;
 
+// With -v, every frame sent is also drawn in the terminal (see preview.h).
+static preview_t preview;
 
-static void spiGridClear()
+static void previewShow(const rgbPixel_t* frame)
 {
-    static const uint16_t GRID_END = sizeof(spiGrid);
-    uint8_t * p2bits = &txBuffer[0];
-
-    for (int i = 0; i < GRID_END; i++)
-    {
-        *p2bits++ = _0_0;
-    }
-    for (int i = 0; i < REFRESH_SIZE; i++)
-    {
-        *p2bits++ = REFRESH;
-    }
+    if (previewing)
+        previewFrame(&preview, frame);
 }
 
-// NOTE: You have to pass in the spiPixel for this to fill and return.
-static spiRgbPixel_t& 
-    makeSpiPixel(spiRgbPixel_t& spiPixel, const rgbPixel_t& rgb)
+// Frames built straight into the wire image are decoded for the preview.
+static void previewShowWire(const uint8_t* tx)
 {
-    uint8_t mapBits [4] = {
-        _0_0,	// 10001000 - represents 00
-        _0_1, 	// 10001100 - represents 01
-        _1_0, 	// 11001000 - represents 10
-        _1_1, 	// 11001100 - represents 11
-    };
+    if (!previewing)
+        return;
+    static rgbPixel_t leds[GRID_AREA];
+    static rgbPixel_t frame[GRID_AREA];
+    wireDecode_t decode;
+    wireDecode(tx, sizeof(txBuffer), leds, GRID_AREA, &decode);
+    for (int pixel = 0; pixel < GRID_AREA; pixel++)
+        frame[pixel] = leds[ledMap[pixel]];
+    previewFrame(&preview, frame);
+}
 
-    // Get copies because shifting zeros the byte.
-    uint8_t r = rgb.r;
-    uint8_t g = rgb.g;
-    uint8_t b = rgb.b;
-    for (int8_t bytePos = SPI_BYTES_PER_BYTE-1; bytePos >= 0; bytePos--)
-    {
-        // Needs 1 SPI byte per 2 bits of LED color data.
-        spiPixel.r[bytePos] = mapBits[r & 0x03];
-        r >>= 2;
+// With -O, everything sent is also captured to a file (see record.h).
+static recorder_t recorder;
+static bool recording = false;
 
-        spiPixel.g[bytePos] = mapBits[g & 0x03];
-        g >>= 2;
+// The built-in 16x16 24-bit images, scaled down like a BMP.
+static void imageToFrame(const uint8_t* image, rgbPixel_t* frame)
+{
+    int gridPos = 0;
+    for (int i = 0; i < GRID_WIDTH*GRID_HEIGHT*3; i += 3)
+    {
+        rgbPixel_t color = makeRgbPixel(color, 
+            image[i] >> 2,          // red
+            image[i+1] >> 2,        // grn
+            image[i+2] >> 2);       // blu
 
-        spiPixel.b[bytePos] = mapBits[b & 0x03];
-        b >>= 2;
+        frame[gridPos++] = color;
     }
-
-    return spiPixel;
 }
 
-static rgbPixel_t&
-    makeRgbPixel(rgbPixel_t& pixel, uint8_t r, uint8_t g, uint8_t b)
+static bool loadBmp(const char* path, rgbPixel_t* frame)
 {
-    pixel.r = r < 64? r : 64;
-    pixel.g = g < 64? g : 64;
-    pixel.b = b < 64? b : 64;
-    pixel.a = 0;
-
-    return pixel;
+    uint64_t converted = traceBegin();
+    bool ok = bmpLoadFrame(path, &arena, frame);
+    traceEnd(TRACE_CONVERT, converted);
+    return ok;
 }
 
-static void rgbGridClear()
+// Playlist assets: 98 and 99 are the built-in images, anything else is
+// a BMP file. Runs on the playlist's loader thread.
+static bool loadAsset(const char* name, rgbPixel_t* frame)
 {
-    static const uint16_t GRID_AREA = GRID_HEIGHT * GRID_WIDTH;
-    rgbPixel_t * pPixel = &rgbGrid[0];
-
-    rgbPixel_t black = makeRgbPixel(black, 0, 0, 0);
+    if (strcmp(name, "98") == 0)
+    {
+        imageToFrame(redball16x16x24bit, frame);
+        return true;
+    }
+    if (strcmp(name, "99") == 0)
+    {
+        imageToFrame(yoda16x16x24bit, frame);
+        return true;
+    }
 
-    for (int i = 0; i < GRID_AREA; i++)
+    if (caching)
     {
-        *pPixel++ = black;
+        cacheEntry_t entry;
+        if (!cacheLoad(&cache, name, loadBmp, &entry))
+            return false;
+        memcpy(frame, entry.rgb, sizeof(rgbGrid));
+        cacheRelease(&entry);
+        return true;
     }
+
+    return loadBmp(name, frame);
+}
+
+static void gridTransferIndexed(int fd, const uint8_t* indices, const palette_t* pPalette);
+
+// Frames for a pre-computed sequence go out several per ioctl, paced by
+// the kernel (see batch.h).
+static void openBatch(frameBatch_t* pBatch, int fps)
+{
+    if (!batchInit(pBatch, sizeof(txBuffer), fps, latencyMs, speed))
+        pabort("can't allocate frame batch");
+    pBatch->pRecorder = recording? &recorder : NULL;
+    printf("batch: %d frames per message (spidev bufsiz %u), %u us gap\n",
+        pBatch->capacity, pBatch->bufsiz, pBatch->gapUsecs);
 }
 
 static void rgbGridPattern(int fd, int pattern)
@@ -264,62 +319,293 @@ static void rgbGridPattern(int fd, int pattern)
             }
             break;
 
-        case 97:
-            // Make a sine wave moderated color movement:
-            for (int pass = 0; pass < 6283; pass++)
+        case 91:
+        {
+            // A Life world much bigger than the display, stepped
+            // bit-packed and seen through a slowly drifting viewport.
+            lifeWorld_t world;
+            if (!lifeInit(&world, lifeSize, lifeSize, lifeRule))
             {
-                for (int row = 0; row < GRID_HEIGHT; row++)
+                printf("bad world size or rule\n");
+                break;
+            }
+            lifeRandomize(&world, 30, time(NULL));
+
+            // Live cells are pale cyan; dead ones fade out through blue.
+            rgbPixel_t colorMap[LIFE_COLORS];
+            for (int i = 0; i < LIFE_COLORS - 1; i++)
+                makeRgbPixel(colorMap[i], i / 2, 0, 3 * i);
+            makeRgbPixel(colorMap[LIFE_COLORS - 1], 24, 48, 48);
+            static uint8_t heat[GRID_AREA];
+            memset(heat, 0, sizeof(heat));
+
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            long stepUsecs = 0;
+            for (int pass = 0; pass < 600; pass++)
+            {
+                uint64_t generated = traceBegin();
+                struct timespec before, after;
+                clock_gettime(CLOCK_MONOTONIC, &before);
+                lifeStep(&world);
+                clock_gettime(CLOCK_MONOTONIC, &after);
+                stepUsecs += (after.tv_sec - before.tv_sec) * 1000000L +
+                    (after.tv_nsec - before.tv_nsec) / 1000L;
+
+                // Reseed a world that has settled down to nearly nothing.
+                if (pass % 60 == 59 && lifePopulation(&world) < (uint32_t)lifeSize * lifeSize / 100)
+                    lifeRandomize(&world, 30, pass);
+
+                lifeRender(&world, pass / 4, pass / 6, heat, colorMap, rgbGrid,
+                    GRID_WIDTH, GRID_HEIGHT);
+                traceEnd(TRACE_GENERATE, generated);
+                gridTransfer(fd);
+
+                static struct timespec sleeptime;
+                sleeptime.tv_sec  = 0;
+                sleeptime.tv_nsec = 16700000L; // 16.7ms
+                uint64_t slept = traceBegin();
+                nanosleep(&sleeptime, NULL);
+                traceEnd(TRACE_SLEEP, slept);
+            }
+            printf("life: %dx%d world, %u generations, %ld us per step, %u alive\n",
+                world.width, world.height, world.generation, stepUsecs / 600,
+                lifePopulation(&world));
+            lifeFree(&world);
+            break;
+        }
+
+        case 92:
+        case 93:
+        {
+            // Audio spectrum from --audio: a scrolling spectrogram (92)
+            // or bars (93), one band per column.
+            if (audioPath == NULL)
+            {
+                printf("pattern %d needs --audio\n", pattern);
+                break;
+            }
+            audioConfig_t config = { audioPath, fftSize, frameRate,
+                pattern == 92? AUDIO_SPECTROGRAM : AUDIO_BARS };
+            audioStats_t stats;
+            if (audioRun(fd, &config, &stats) < 0)
+                pabort("can't read audio (16-bit PCM WAV)");
+            long frames = stats.frames > 0? stats.frames : 1;
+            printf("audio: %u Hz x %d, %u frames, %d point FFT: analysis %ld us avg "
+                "(%ld max), latency %.1f ms avg (%.1f max) + %.1f ms window, "
+                "%u late\n", stats.sampleRate, stats.channels, stats.frames, fftSize,
+                stats.analysisUsecs / frames, stats.analysisMaxUsecs,
+                stats.latencyUsecs / 1e3 / frames, stats.latencyMaxUsecs / 1e3,
+                fftSize * 500.0 / stats.sampleRate, stats.lateFrames);
+            break;
+        }
+
+        case 94:
+        {
+            // Yoda as an indexed frame, faded in and out by rescaling
+            // the palette; the frame itself is never redrawn.
+            static uint8_t indices[GRID_AREA];
+            static palette_t palette;
+            imageToFrame(yoda16x16x24bit, rgbGrid);
+            if (!paletteIndexFrame(&palette, rgbGrid, GRID_AREA, indices))
+                pabort("too many colors for a palette");
+            rgbPixel_t base[PALETTE_SIZE];
+            memcpy(base, palette.colors, sizeof(base));
+
+            for (int pass = 0; pass < 240; pass++)
+            {
+                uint64_t generated = traceBegin();
+                int level = pass < 120? pass : 240 - pass;      // 0..120..1
+                for (int i = 0; i < palette.count; i++)
                 {
-                    for (int col = 0; col < GRID_WIDTH; col++)
-                    {
-                        const float K = 3.1415*3.0/2.0;
-                        int x = 32 - int(32 * sin(K + pass/10.0 + row + col));
-                        rgbPixel_t color = makeRgbPixel(color, 0, 0, x);
-                        rgbGrid[row * GRID_WIDTH + col] = color;
-                    }
+                    rgbPixel_t color = makeRgbPixel(color, base[i].r * level / 120,
+                        base[i].g * level / 120, base[i].b * level / 120);
+                    paletteSet(&palette, i, color);
                 }
-                // Transfer the grid data out to the real RGB LED Grid.
-                gridTransfer(fd);
+                traceEnd(TRACE_GENERATE, generated);
+                gridTransferIndexed(fd, indices, &palette);
 
-                // Wait a while..
                 static struct timespec sleeptime;
                 sleeptime.tv_sec  = 0;
                 sleeptime.tv_nsec = 16700000L; // 16.7ms
-                //sleeptime.tv_nsec = 100000000L; // 100ms
+                uint64_t slept = traceBegin();
                 nanosleep(&sleeptime, NULL);
+                traceEnd(TRACE_SLEEP, slept);
             }
+            paletteExpand(&palette, indices, GRID_AREA, rgbGrid);
+            printf("palette: %d colors, %d byte frame\n", palette.count, GRID_AREA);
             break;
-            
-        case 98:
+        }
+
+        case 95:
         {
-            int gridPos = 0;
-            for (int i = 0; i < GRID_WIDTH*GRID_HEIGHT*3; i += 3)
+            // The red ball, cut out of its green backdrop, bouncing and
+            // spinning at half size over a dim gradient. Each frame only
+            // restores and redraws the rectangle the ball covers.
+            static rgbPixel_t background[GRID_AREA];
+            static rgbPixel_t ball[GRID_AREA];
+            surface_t bgSurface = makeSurface(background, GRID_WIDTH, GRID_HEIGHT);
+            surface_t grid = gridSurface();
+
+            for (int row = 0; row < GRID_HEIGHT; row++)
+            {
+                rgbPixel_t color = makeRgbPixel(color, 0, row / 2, 2 + row);
+                rasterFillRect(&bgSurface, 0, row, GRID_WIDTH, 1, color);
+            }
+            for (int i = 0; i < GRID_AREA; i++)
+            {
+                uint8_t r = redball16x16x24bit[3*i];
+                uint8_t g = redball16x16x24bit[3*i+1];
+                uint8_t b = redball16x16x24bit[3*i+2];
+                makeRgbaPixel(ball[i], r >> 2, g >> 2, b >> 2, g > r? 0 : 255);
+            }
+            sprite_t sprite = makeSprite(ball, GRID_WIDTH, GRID_HEIGHT);
+
+            memcpy(rgbGrid, background, sizeof(rgbGrid));
+            fixed_t x = TO_FIXED(4), y = TO_FIXED(4);
+            fixed_t vx = TO_FIXED(0.13), vy = TO_FIXED(0.07);
+            rect_t drawn = { 0, 0, 0, 0 };
+            long pixelsTouched = 0;
+            long rowsEncoded = 0;
+
+            for (int pass = 0; pass < 600; pass++)
             {
-                rgbPixel_t color = makeRgbPixel(color, 
-                    redball16x16x24bit[i] >> 2,         // red
-                    redball16x16x24bit[i+1] >> 2,       // grn
-                    redball16x16x24bit[i+2] >> 2);      // blu
+                uint64_t generated = traceBegin();
+                x += vx;
+                y += vy;
+                if (x < TO_FIXED(4) || x > TO_FIXED(GRID_WIDTH - 4))
+                    vx = -vx;
+                if (y < TO_FIXED(4) || y > TO_FIXED(GRID_HEIGHT - 4))
+                    vy = -vy;
+
+                rasterCopyRect(&grid, &bgSurface, drawn);
+                rect_t old = drawn;
+                drawn = rasterBlitTransformed(&grid, &sprite, x, y,
+                    pass * 4, FIXED_ONE / 2, BLIT_ALPHA, background[0]);
+                rect_t dirty = rectUnion(old, drawn);
+                pixelsTouched += dirty.width * dirty.height;
+                traceEnd(TRACE_GENERATE, generated);
+
+                // Only the rows under the dirty rect are re-encoded; the
+                // first frame also has the whole background to send.
+                rowMask_t rows = pass == 0? ALL_ROWS : rectRows(dirty);
+                gridTransferRows(fd, rows);
+                rowsEncoded += __builtin_popcountll(rows);
 
-                rgbGrid[gridPos++] = color;
+                static struct timespec sleeptime;
+                sleeptime.tv_sec  = 0;
+                sleeptime.tv_nsec = 16700000L; // 16.7ms
+                uint64_t slept = traceBegin();
+                nanosleep(&sleeptime, NULL);
+                traceEnd(TRACE_SLEEP, slept);
             }
+            printf("sprite: %ld pixels touched, %.1f of %d rows encoded per frame "
+                "on average\n", pixelsTouched / 600, rowsEncoded / 600.0, GRID_HEIGHT);
             break;
         }
 
-        case 99:
+        case 96:
         {
-            int gridPos = 0;
-            for (int i = 0; i < GRID_WIDTH*GRID_HEIGHT*3; i += 3)
+            // Yoda behind a drifting sine-wave haze, with a highlight bar
+            // sweeping down over both. Only changed rows get re-blended.
+            static compositor_t comp;
+            compositorInit(&comp, 3);
+
+            rgbPixel_t* pYoda = compositorLayer(&comp, 0);
+            for (int i = 0; i < GRID_AREA; i++)
             {
-                rgbPixel_t color = makeRgbPixel(color, 
-                    yoda16x16x24bit[i] >> 2,         // red
-                    yoda16x16x24bit[i+1] >> 2,       // grn
-                    yoda16x16x24bit[i+2] >> 2);      // blu
+                makeRgbPixel(pYoda[i],
+                    yoda16x16x24bit[3*i] >> 2,
+                    yoda16x16x24bit[3*i+1] >> 2,
+                    yoda16x16x24bit[3*i+2] >> 2);
+            }
+
+            rgbPixel_t* pHaze = compositorLayer(&comp, 1);
+            rgbPixel_t* pBar = compositorLayer(&comp, 2);
+            int barRow = 0;
+
+            for (int pass = 0; pass < 600; pass++)
+            {
+                uint64_t generated = traceBegin();
+                if (pass % 4 == 0)
+                {
+                    for (int row = 0; row < GRID_HEIGHT; row++)
+                    {
+                        for (int col = 0; col < GRID_WIDTH; col++)
+                        {
+                            const float K = 3.1415*3.0/2.0;
+                            int x = 64 - int(64 * sin(K + pass/40.0 + row + col));
+                            makeRgbaPixel(pHaze[row * GRID_WIDTH + col], 0, 0, 48, x);
+                        }
+                    }
+                    compositorMarkDirty(&comp, 1);
+                }
+
+                // Clear the old bar row, draw the new one.
+                memset(&pBar[barRow * GRID_WIDTH], 0, GRID_WIDTH * sizeof(rgbPixel_t));
+                compositorMarkRows(&comp, 2, barRow, 1);
+                barRow = (pass / 2) % GRID_HEIGHT;
+                for (int col = 0; col < GRID_WIDTH; col++)
+                {
+                    makeRgbaPixel(pBar[barRow * GRID_WIDTH + col], 48, 48, 48, 160);
+                }
+                compositorMarkRows(&comp, 2, barRow, 1);
 
-                rgbGrid[gridPos++] = color;
+                rowMask_t changed = compositorRender(&comp, rgbGrid);
+                traceEnd(TRACE_GENERATE, generated);
+                if (changed != 0)
+                {
+                    gridTransferRows(fd, changed);
+                }
+
+                static struct timespec sleeptime;
+                sleeptime.tv_sec  = 0;
+                sleeptime.tv_nsec = 16700000L; // 16.7ms
+                uint64_t slept = traceBegin();
+                nanosleep(&sleeptime, NULL);
+                traceEnd(TRACE_SLEEP, slept);
             }
+            printf("compositor: %u layer rows blended, %u reused\n",
+                comp.rowsBlended, comp.rowsSkipped);
             break;
         }
 
+        case 97:
+        {
+            // Make a sine wave moderated color movement:
+            frameBatch_t batch;
+            openBatch(&batch, 60);
+            surface_t grid = gridSurface();
+            for (int pass = 0; pass < 6283; pass++)
+            {
+                uint64_t generated = traceBegin();
+                sineParams_t params = { pass };
+                tileRenderSerial(&grid, sineShader, &params);
+                traceEnd(TRACE_GENERATE, generated);
+                // Queue the frame; the kernel holds each one for 16.7ms.
+                uint64_t encoded = traceBegin();
+                display.encode();
+                traceEnd(TRACE_ENCODE, encoded);
+                previewShow(rgbGrid);
+                if (!batchPush(&batch, pLed, txBuffer))
+                    pabort("can't send spi message");
+            }
+            if (!batchFlush(&batch, pLed))
+                pabort("can't send spi message");
+            printf("sine: %ld frames in %ld messages, %ld unchanged\n", batch.framesSent,
+                batch.batches, batch.framesSuppressed);
+            batchFree(&batch);
+            break;
+        }
+            
+        case 98:
+            imageToFrame(redball16x16x24bit, rgbGrid);
+            break;
+
+        case 99:
+            imageToFrame(yoda16x16x24bit, rgbGrid);
+            break;
+
         case -1:
         default:
             printf("UNKNOWN pattern: %d.  Using default: Blue diag.\n", pattern);
@@ -336,152 +622,392 @@ static void rgbGridPattern(int fd, int pattern)
     }
 }
 
-static void copySpiGridBytes()
+void spiTransfer(int, const uint8_t* tx, uint32_t len)
+{
+    // The fd is pLed's; everything goes through libspiled now.
+    // SEND IT OUT:
+    if (recording)
+        recordFrame(&recorder, tx, len, 0);
+    uint64_t sent = traceBegin();
+    if (spiledWrite(pLed, tx, len) < 0)
+        pabort("can't send spi message");
+    traceEnd(TRACE_TRANSFER, sent);
+}
+
+void txTransfer(int fd)
+{
+    if (idleShouldSend(&idle, txBuffer, sizeof(txBuffer)))
+        spiTransfer(fd, txBuffer, sizeof(txBuffer));
+}
+
+static void streamSink(void* ctx, const uint8_t* data, uint32_t len)
+{
+    spiTransfer(*(int*)ctx, data, len);
+}
+
+static void openStream(int* pFd)
+{
+    // The stream walks the chain in LED order, so it needs the inverse map.
+    for (int pixel = 0; pixel < GRID_AREA; pixel++)
+        ledToPixel[ledMap[pixel]] = pixel;
+
+    streamConfig_t config = { GRID_AREA, GRID_WIDTH, WIRING_MAPPED, ledToPixel,
+        streamChunk, DEFAULT_STREAM_SLOTS };
+    if (!streamInit(&stream, &config, streamSink, pFd))
+        pabort("can't start stream");
+    streaming = true;
+    printf("stream: %d LEDs per chunk, %d slots, %u bytes\n",
+        stream.config.chunkLeds, stream.config.slots, streamFootprint(&stream));
+}
+
+// With -V, every encoded frame is decoded again and checked against rgbGrid.
+static uint32_t framesVerified = 0;
+static uint32_t framesMismatched = 0;
+
+static void verifyTxBuffer()
 {
-    static const uint16_t GRID_END = sizeof(spiGrid);
-    uint8_t * pBuf = &txBuffer[0];
-    uint8_t * pSpiGrid = (uint8_t*)(&spiGrid[0]);
+    static rgbPixel_t leds[GRID_AREA];
+    wireDecode_t decode;
+    wireDecode(txBuffer, sizeof(txBuffer), leds, GRID_AREA, &decode);
+
+    bool ok = decode.leds == GRID_AREA && decode.badSymbols == 0 &&
+        decode.refreshBytes == REFRESH_SIZE;
+    for (int pixel = 0; ok && pixel < GRID_AREA; pixel++)
+    {
+        const rgbPixel_t& want = rgbGrid[pixel];
+        const rgbPixel_t& got = leds[ledMap[pixel]];
+        ok = want.r == got.r && want.g == got.g && want.b == got.b;
+    }
 
-    // Note: Could use memcopy here.
-    for (int i = 0; i < GRID_END; i++)
+    framesVerified++;
+    if (!ok)
     {
-        *pBuf++ = *pSpiGrid++;
+        framesMismatched++;
+        if (framesMismatched == 1)
+            printf("verify: frame %u doesn't decode back to rgbGrid\n", framesVerified);
     }
 }
 
-static void gridConvertBits()
+// -f with -C: the cached wire frame goes out straight from the mapping.
+static bool sendCachedFile(int fd, const char* path)
 {
-    const int MAX_COL = GRID_WIDTH - 1;
-    for (int row = 0; row < GRID_HEIGHT; row++)
-    {
-//        printf("Row: %d\n", row);
-        for (int col = 0; col < GRID_WIDTH; col++)
-        {
-//            printf("Making spiPixel # %d\n", row*GRID_WIDTH+col);
-            spiRgbPixel_t spiPixel;
-                spiPixel = makeSpiPixel(spiPixel, rgbGrid[row * GRID_WIDTH + col]);
+    cacheEntry_t entry;
+    uint64_t converted = traceBegin();
+    if (!cacheLoad(&cache, path, loadBmp, &entry))
+        return false;
+    traceEnd(TRACE_CONVERT, converted);
+
+    printf("cache: %s %s in %ld us\n", entry.hit? "hit" : "miss", path, entry.usecs);
+    if (idleShouldSend(&idle, entry.wire, entry.wireLen))
+        spiTransfer(fd, entry.wire, entry.wireLen);
+
+    // Keep the display in step (-V checks what was sent).
+    memcpy(rgbGrid, entry.rgb, sizeof(rgbGrid));
+    memcpy(txBuffer, entry.wire, sizeof(txBuffer));
+    previewShow(rgbGrid);
+    if (verifyChip != NULL)
+        verifyTxBuffer();
+    cacheRelease(&entry);
+    return true;
+}
 
-            if (row & 1)
-            {
-                spiGrid[row * GRID_WIDTH + col] = spiPixel;
-            }
-            else
-            {
-                spiGrid[row * GRID_WIDTH - col + MAX_COL] = spiPixel;
-            }
-        }
+void gridTransfer(int fd)
+{
+    previewShow(rgbGrid);
+    if (streaming)
+    {
+        // The stream always encodes rgbGrid, so that is what to compare.
+        // (Encoding waits for free slots, so this includes the backlog.)
+        uint64_t encoded = traceBegin();
+        if (idleShouldSend(&idle, rgbGrid, sizeof(rgbGrid)))
+            streamFrame(&stream, rgbGrid);
+        traceEnd(TRACE_ENCODE, encoded);
+        return;
     }
+
+    // Convert the RGB grid straight into the SPI Transmit buffer.
+    // (The REFRESH part of the txBuffer remains unmodified.)
+    uint64_t encoded = traceBegin();
+    display.encode();
+    traceEnd(TRACE_ENCODE, encoded);
+    if (verifyChip != NULL)
+        verifyTxBuffer();
+
+    txTransfer(fd);
 }
 
-static void dumpSpiGrid()
+// Indexed frames skip rgbGrid: each pixel is one copy of its palette
+// entry's wire bytes (see palette.h).
+static void gridTransferIndexed(int fd, const uint8_t* indices, const palette_t* pPalette)
 {
-    printf("Dumping SPI RGB Grid values:\n");
-    
-    const int MAX_COL = GRID_WIDTH - 1;
-    for (int row = 0; row < GRID_HEIGHT; row++)
+    if (previewing)
     {
-        printf("Row: %d\n", row);
-        for (int col = 0; col < GRID_WIDTH; col++)
-        {
-            spiRgbPixel_t pixel;
-            
-            if (row & 1)
-            {
-                pixel = spiGrid[row * GRID_WIDTH + col];
-            }
-            else
-            {
-                pixel = spiGrid[row * GRID_WIDTH - col + MAX_COL];
-            }
-            
-            printf("%02X:%02X:%02X:%02X ", pixel.r[0], pixel.r[1], pixel.r[2], pixel.r[3] );
-            printf("%02X:%02X:%02X:%02X ", pixel.g[0], pixel.g[1], pixel.g[2], pixel.g[3] );
-            printf("%02X:%02X:%02X:%02X ", pixel.b[0], pixel.b[1], pixel.b[2], pixel.b[3] );
-        }
-        printf("\n");
+        paletteExpand(pPalette, indices, GRID_AREA, rgbGrid);
+        previewShow(rgbGrid);
+    }
+    if (streaming)
+    {
+        // A palette change alone is a new frame, so both go in the key.
+        uint64_t key[2] = { idleHash(indices, GRID_AREA),
+            idleHash(pPalette->colors, sizeof(pPalette->colors)) };
+        uint64_t encoded = traceBegin();
+        if (idleShouldSend(&idle, key, sizeof(key)))
+            streamFrameIndexed(&stream, indices, pPalette->wire);
+        traceEnd(TRACE_ENCODE, encoded);
+        return;
     }
-    printf("\n");
+
+    uint64_t encoded = traceBegin();
+    display.encodeIndexed(indices, pPalette->wire);
+    traceEnd(TRACE_ENCODE, encoded);
+    if (verifyChip != NULL)
+    {
+        if (!previewing)
+            paletteExpand(pPalette, indices, GRID_AREA, rgbGrid);
+        verifyTxBuffer();
+    }
+
+    txTransfer(fd);
 }
 
-static void dumpRgbGrid()
+// With -Q, DMX frames go up from the presentation queue's thread, so
+// they are encoded in their own display, apart from the rgbGrid the
+// receiver decodes into.
+static display_t presented(ledMap);
+static presentQueue_t presentQueue;
+
+static void presentSink(void* ctx, const void* frame)
 {
-    printf("Dumping RGB Grid values:\n");
-    for (int row = 0; row < GRID_HEIGHT; row++)
+    int fd = *(int*)ctx;
+    previewShow((const rgbPixel_t*)frame);
+    uint64_t encoded = traceBegin();
+    if (streaming)
     {
-        printf("Row: %d\n", row);
-        for (int col = 0; col < GRID_WIDTH; col++)
-        {
-            rgbPixel_t pixel = rgbGrid[row * GRID_WIDTH + col];
-            printf("%02X:%02X:%02X ", pixel.r, pixel.g, pixel.b);
-        }
-        printf("\n");
+        if (idleShouldSend(&idle, frame, sizeof(rgbGrid)))
+            streamFrame(&stream, (const rgbPixel_t*)frame);
+        traceEnd(TRACE_ENCODE, encoded);
+        return;
     }
-    printf("\n");
+
+    memcpy(presented.rgb, frame, sizeof(presented.rgb));
+    presented.encode();
+    traceEnd(TRACE_ENCODE, encoded);
+    if (idleShouldSend(&idle, presented.tx, sizeof(presented.tx)))
+        spiTransfer(fd, presented.tx, sizeof(presented.tx));
 }
 
-static void dumpTxBuffer()
+static void playAnimFile(int fd, const char* path)
 {
-    printf("Dumping SPI TX Buffer values:\n");
-    uint8_t* pByte = &txBuffer[0];
-    
-    for (int row = 0; row < GRID_HEIGHT; row++)
+    animReader_t reader;
+    if (!animOpen(&reader, path))
+        pabort("can't open animation");
+
+    int fps = frameRateGiven || reader.fps == 0? frameRate : reader.fps;
+    printf("animation: %s, %u frames at %d fps\n", path, reader.frameCount, fps);
+
+    const long FRAME_NSEC = 1000000000L / (fps > 0? fps : 1);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    long frames = 0;
+    long rowsEncoded = 0;
+
+    do
     {
-        printf("Row: %d\n", row);
-        // (4 bytes per color) * (3 colors per pixel)
-        for (int col = 0; col < GRID_WIDTH*SPI_BYTES_PER_BYTE*3; col += 4)
+        animRewind(&reader);
+        rowMask_t dirty;
+        int ret;
+        uint64_t converted = traceBegin();
+        while ((ret = animNextFrame(&reader, rgbGrid, &dirty)) == 1)
         {
-            printf("%02X:%02X:%02X:%02X ", pByte[0], pByte[1], pByte[2], pByte[3]);
-            pByte += 4;
+            traceEnd(TRACE_CONVERT, converted);
+            // Only the rows the frame touched get re-encoded.
+            gridTransferRows(fd, dirty);
+            frames++;
+            rowsEncoded += __builtin_popcountll(dirty);
+
+            addNsec(next, FRAME_NSEC);
+            uint64_t slept = traceBegin();
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            traceEnd(TRACE_SLEEP, slept);
+            converted = traceBegin();
         }
-        printf("\n");
-    }
-    printf("\n");
+        if (ret < 0)
+        {
+            printf("animation: corrupt frame %u\n", reader.frame);
+            break;
+        }
+    } while (loopAnim);
+
+    printf("animation: %ld frames, %.1f of %d rows encoded per frame\n",
+        frames, frames? (double)rowsEncoded / frames : 0.0, GRID_HEIGHT);
+    animClose(&reader);
 }
 
-static void gridTransfer(int fd)
+static void scrollText(const char* message)
 {
-    int ret;
+    scroller_t scroll;
+    rgbPixel_t color = makeRgbPixel(color, 48, 32, 8);
+    if (!scrollerInit(&scroll, message, color))
+        pabort("can't allocate text strip");
 
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)txBuffer,
-        .rx_buf = (unsigned long)rxBuffer,
-        .len = sizeof(txBuffer),
-        .speed_hz = speed,
-        .delay_usecs = delay,
-        .bits_per_word = bits,
-    };
+    printf("text: \"%s\" (%d columns) at %d fps\n",
+        message, scrollerLength(&scroll), frameRate);
 
-    // Convert the RGB grid to the SPI RGB grid.
-    gridConvertBits();
+    frameBatch_t batch;
+    openBatch(&batch, frameRate);
 
-    // Copy to SPI Transmit buffer:
-    // (The REFRESH part of the txBuffer remains unmodified.)
-    copySpiGridBytes();
+    do
+    {
+        for (int offset = 0; offset < scrollerLength(&scroll); offset++)
+        {
+            uint64_t encoded = traceBegin();
+            scrollerToTxBuffer(&scroll, offset);
+            traceEnd(TRACE_ENCODE, encoded);
+            previewShowWire(txBuffer);
+            if (!batchPush(&batch, pLed, txBuffer))
+                pabort("can't send spi message");
+        }
+    } while (loopAnim);
 
-    // SEND IT OUT:
-    ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-    if (ret < 1)
+    if (!batchFlush(&batch, pLed))
         pabort("can't send spi message");
+    printf("text: %ld frames in %ld messages, %ld unchanged\n", batch.framesSent,
+        batch.batches, batch.framesSuppressed);
+    batchFree(&batch);
+    scrollerFree(&scroll);
+}
+
+// -e: a pattern given as an expression (see expr.h), inline or @file,
+// shown for 600 frames at --rate with t counting frames.
+static void playExpression(int fd, const char* text)
+{
+    char* fileText = NULL;
+    if (text[0] == '@')
+    {
+        FILE* pFile = fopen(text + 1, "r");
+        if (pFile == NULL)
+            pabort("can't open expression file");
+        fseek(pFile, 0, SEEK_END);
+        long size = ftell(pFile);
+        rewind(pFile);
+        fileText = (char*)malloc(size + 1);
+        if (fileText == NULL)
+            pabort("can't allocate expression");
+        size = fread(fileText, 1, size, pFile);
+        fileText[size] = '\0';
+        fclose(pFile);
+        text = fileText;
+    }
+
+    static exprProgram_t program;
+    if (!exprCompile(&program, text))
+    {
+        printf("expression: %s\n", program.error);
+        free(fileText);
+        return;
+    }
+    free(fileText);
+    printf("expression: %d frame, %d row and %d pixel instructions at %d fps\n",
+        program.frameOps, program.rowOps, program.pixelOps, frameRate);
+
+    const long FRAME_NSEC = 1000000000L / (frameRate > 0? frameRate : 1);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    surface_t grid = gridSurface();
+    long evalNsec = 0;
+    int frames = 0;
+
+    do
+    {
+        for (int pass = 0; pass < 600; pass++, frames++)
+        {
+            uint64_t generated = traceBegin();
+            struct timespec before, after;
+            clock_gettime(CLOCK_MONOTONIC, &before);
+            exprParams_t params = { &program, (double)pass };
+            tileRenderSerial(&grid, exprShader, &params);
+            clock_gettime(CLOCK_MONOTONIC, &after);
+            evalNsec += (after.tv_sec - before.tv_sec) * 1000000000L +
+                after.tv_nsec - before.tv_nsec;
+            traceEnd(TRACE_GENERATE, generated);
+            gridTransfer(fd);
+
+            addNsec(next, FRAME_NSEC);
+            uint64_t slept = traceBegin();
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            traceEnd(TRACE_SLEEP, slept);
+        }
+    } while (loopAnim);
+
+    printf("expression: %d frames, %.1f us per frame to evaluate\n",
+        frames, frames? evalNsec / 1e3 / frames : 0.0);
+}
 
-#if 0
-    // LED is one-way device.
-    for (ret = 0; ret < sizeof(tx); ret++) {
-        if (!(ret % 16))
-            puts("");
-        printf("%.2X ", rx[ret]);
+void gridTransferRows(int fd, rowMask_t rows)
+{
+    if (streaming)
+    {
+        gridTransfer(fd);
+        return;
     }
-    puts("");
-#endif
+
+    // txBuffer still holds the previous encoding of the untouched rows.
+    previewShow(rgbGrid);
+    uint64_t encoded = traceBegin();
+    display.encodeRows(rows);
+    traceEnd(TRACE_ENCODE, encoded);
+    if (verifyChip != NULL)
+        verifyTxBuffer();
+    txTransfer(fd);
 }
 
 static void print_usage(const char *prog)
 {
-    printf("Usage: %s [-Dsdf]\n", prog);
+    printf("Usage: %s [-Dsdf] [asset...]\n", prog);
     puts("  -D --device   device to use (default /dev/spidev0.0)\n"
          "  -s --speed    max speed (Hz)\n"
          "  -d --delay    delay (use)\n"
          "  -p --pattern  pattern# to display\n"
          "  -f --file     file (BMP image to load)\n"
+         "  -a --anim     directory of numbered BMP frames to play\n"
+         "  -r --rate     animation frame rate (default 30)\n"
+         "  -A --animfile play a compressed .spla animation (see animenc)\n"
+         "  -n --prefetch frames to load ahead of the display (default 8)\n"
+         "  -l --loop     repeat the animation\n"
+         "  -w --audio    WAV file or - (stdin) for patterns 92 and 93\n"
+         "  -F --fft      FFT size for the audio patterns: 256, 512 or 1024\n"
+         "                (default 512)\n"
+         "  -G --world    Life world size for pattern 91 (default 256)\n"
+         "  -R --rule     Life rule for pattern 91 (default B3/S23)\n"
+         "  -m --map      LED wiring, e.g. columns,serpentine,rot90 (see pixelmap.h)\n"
+         "  -t --text     scroll a message (one column per frame at --rate)\n"
+         "  -e --expr     show a pattern expression, or @file of one (see expr.h)\n"
+         "  -E --dmx      receive frames over e131 or artnet\n"
+         "  -u --universe first DMX universe (default 1)\n"
+         "  -P --port     UDP port (default per protocol)\n"
+         "  -c --count    stop after this many DMX frames\n"
+         "  -Q --queue    show DMX frames this many ms after they arrive, in\n"
+         "                --rate slots (see present.h)\n"
+         "  -L --latency  most ms of frames to queue per SPI message (default 100)\n"
+         "  -K --keepalive resend an unchanged frame after this many ms\n"
+         "                (default 1000, 0 = send every frame)\n"
+         "  -V --verify   decode every frame sent and check timing for this chip\n"
+         "                (ws2812, ws2812b, ws2812b-v5, sk6812)\n"
+         "  -S --stream   send frames in chunks of this many LEDs (see stream.h)\n"
+         "  -X --transition cut, fade, wipe or dissolve[:ms] between assets\n"
+         "                (default fade:1000)\n"
+         "  -H --hold     ms each asset stays up (default 3000)\n"
+         "  -C --cache    keep converted BMPs in this directory (see assetcache.h)\n"
+         "  -Z --cache-size most KB the cache may hold (default 1024)\n"
+         "  -k --arena    KB set aside at startup for reading (and caching)\n"
+         "                BMPs; bigger files are refused (default 1024)\n"
+         "  -v --preview  draw every frame sent in the terminal (truecolor)\n"
+         "  -O --record   capture every buffer sent, with its time, to this file\n"
+         "  -I --replay   send a capture from --record again, at its own pace\n"
+         "  -M --max-speed replay back to back, as fast as the SPI link goes\n"
+         "  -T --trace    save a Chrome trace of every frame's stages to this\n"
+         "                file, for Perfetto (see trace.h)\n"
+         "  asset...      play a list of BMP files and images 98/99 in turn\n"
     );
     exit(1);
 }
@@ -495,11 +1021,42 @@ static void parse_opts(int argc, char *argv[])
             { "delay",   1, 0, 'd' },
             { "pattern", 1, 0, 'p' },
             { "file",    1, 0, 'f' },
+            { "anim",    1, 0, 'a' },
+            { "animfile", 1, 0, 'A' },
+            { "rate",    1, 0, 'r' },
+            { "prefetch", 1, 0, 'n' },
+            { "loop",    0, 0, 'l' },
+            { "audio",   1, 0, 'w' },
+            { "fft",     1, 0, 'F' },
+            { "world",   1, 0, 'G' },
+            { "rule",    1, 0, 'R' },
+            { "map",     1, 0, 'm' },
+            { "text",    1, 0, 't' },
+            { "expr",    1, 0, 'e' },
+            { "dmx",     1, 0, 'E' },
+            { "universe", 1, 0, 'u' },
+            { "port",    1, 0, 'P' },
+            { "count",   1, 0, 'c' },
+            { "queue",   1, 0, 'Q' },
+            { "latency", 1, 0, 'L' },
+            { "keepalive", 1, 0, 'K' },
+            { "verify",  1, 0, 'V' },
+            { "stream",  1, 0, 'S' },
+            { "transition", 1, 0, 'X' },
+            { "hold",    1, 0, 'H' },
+            { "cache",   1, 0, 'C' },
+            { "preview", 0, 0, 'v' },
+            { "trace",   1, 0, 'T' },
+            { "record",  1, 0, 'O' },
+            { "replay",  1, 0, 'I' },
+            { "max-speed", 0, 0, 'M' },
+            { "cache-size", 1, 0, 'Z' },
+            { "arena",   1, 0, 'k' },
             { NULL, 0, 0, 0 },
         };
         int c;
 
-        c = getopt_long(argc, argv, "D:s:d:p:f", lopts, NULL);
+        c = getopt_long(argc, argv, "D:s:d:p:f:a:A:r:n:lm:t:E:u:P:c:L:K:V:S:X:H:C:Z:Q:w:F:G:R:vT:O:I:Me:k:", lopts, NULL);
 
         if (c == -1)
             break;
@@ -520,6 +1077,104 @@ static void parse_opts(int argc, char *argv[])
         case 'f':
             file = optarg;
             break;
+        case 'a':
+            animDir = optarg;
+            break;
+        case 'A':
+            animFile = optarg;
+            break;
+        case 'r':
+            frameRate = atoi(optarg);
+            frameRateGiven = true;
+            break;
+        case 'n':
+            prefetchFrames = atoi(optarg);
+            break;
+        case 'l':
+            loopAnim = true;
+            break;
+        case 'w':
+            audioPath = optarg;
+            break;
+        case 'F':
+            fftSize = atoi(optarg);
+            if (fftSize < AUDIO_MIN_FFT_SIZE || fftSize > AUDIO_MAX_FFT_SIZE ||
+                (fftSize & (fftSize - 1)) != 0)
+                print_usage(argv[0]);
+            break;
+        case 'G':
+            lifeSize = atoi(optarg);
+            break;
+        case 'R':
+            lifeRule = optarg;
+            break;
+        case 'v':
+            previewing = true;
+            break;
+        case 'T':
+            traceFile = optarg;
+            break;
+        case 'O':
+            recordFile = optarg;
+            break;
+        case 'I':
+            replayFile = optarg;
+            break;
+        case 'M':
+            replayMaxSpeed = true;
+            break;
+        case 'e':
+            exprText = optarg;
+            break;
+        case 'm':
+            layout = optarg;
+            break;
+        case 't':
+            text = optarg;
+            break;
+        case 'E':
+            dmxProtocol = optarg;
+            break;
+        case 'u':
+            dmxConfig.firstUniverse = atoi(optarg);
+            break;
+        case 'P':
+            dmxConfig.port = atoi(optarg);
+            break;
+        case 'c':
+            dmxConfig.frameLimit = atoi(optarg);
+            break;
+        case 'Q':
+            queueDelayMs = atoi(optarg);
+            break;
+        case 'L':
+            latencyMs = atoi(optarg);
+            break;
+        case 'K':
+            keepaliveMs = atoi(optarg);
+            break;
+        case 'V':
+            verifyChip = optarg;
+            break;
+        case 'S':
+            streamChunk = atoi(optarg);
+            break;
+        case 'X':
+            if (!transitionParse(optarg, &playlist.kind, &playlist.transitionMs))
+                print_usage(argv[0]);
+            break;
+        case 'H':
+            playlist.holdMs = atoi(optarg);
+            break;
+        case 'C':
+            cacheDir = optarg;
+            break;
+        case 'Z':
+            cacheKB = atoi(optarg);
+            break;
+        case 'k':
+            arenaKB = atoi(optarg);
+            break;
         default:
             print_usage(argv[0]);
             break;
@@ -531,74 +1186,227 @@ int main(int argc, char *argv[])
 {
     int ret = 0;
     int fd;
+    bool finalSent = false;     // the last frame is already on the display
 
     parse_opts(argc, argv);
 
-    fd = open(device, O_RDWR);
-    if (fd < 0)
+    // Check the layout up front; libspiled builds the map again on open.
+    if (!pixelMapInit(layout))
+        exit(1);
+    if (traceFile != NULL && !traceStart(DEFAULT_TRACE_EVENTS))
+        pabort("can't start trace");
+    if (arenaKB < 1 || !arenaInit(&arena, (size_t)arenaKB * 1024))
+        pabort("can't allocate BMP arena");
+
+    spiledConfig_t config;
+    spiledDefaultConfig(&config);
+    config.speedHz = speed;
+    config.mode = mode;
+    config.bits = bits;
+    config.delayUsecs = delay;
+    config.layout = layout;
+    // Single frames are filtered here (see idle.h) and go out through
+    // spiledWrite, which doesn't filter; batches are filtered by libspiled.
+    config.keepaliveMs = keepaliveMs;
+    pLed = spiledOpen(device, &config);
+    if (pLed == NULL)
         pabort("can't open device");
+    fd = spiledFd(pLed);
+    speed = spiledSpeed(pLed);
+
+    if (verifyChip != NULL)
+    {
+        const ledTiming_t* pTiming = ledTimingFind(verifyChip);
+        if (pTiming == NULL)
+            print_usage(argv[0]);
+        wireTiming_t timing;
+        wireCheckTiming(speed, REFRESH_SIZE, pTiming, &timing);
+        wirePrintTiming(&timing, pTiming);
+    }
+
+    // 1) Clear the RGB grid (and its wire image) once.
+    display.clear();
+    idleInit(&idle, keepaliveMs);
+    if (streamChunk > 0)
+        openStream(&fd);
+    if (previewing && !previewInit(&preview, STDOUT_FILENO))
+        pabort("can't allocate preview");
+    if (cacheDir != NULL)
+    {
+        if (!cacheInit(&cache, cacheDir, cacheKB, &arena))
+            pabort("can't open asset cache");
+        caching = true;
+    }
 
-    /*
-    * spi mode
-    */
-    ret = ioctl(fd, SPI_IOC_WR_MODE, &mode);
-    if (ret == -1)
-        pabort("can't set spi mode");
-
-    ret = ioctl(fd, SPI_IOC_RD_MODE, &mode);
-    if (ret == -1)
-        pabort("can't get spi mode");
-
-    /*
-    * bits per word
-    */
-    ret = ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits);
-    if (ret == -1)
-        pabort("can't set bits per word");
-
-    ret = ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &bits);
-    if (ret == -1)
-        pabort("can't get bits per word");
-
-    /*
-    * max speed hz
-    */
-    ret = ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
-    if (ret == -1)
-        pabort("can't set max speed hz");
-
-    ret = ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed);
-    if (ret == -1)
-        pabort("can't get max speed hz");
-
-    printf("spi mode: %d\n", mode);
-    printf("bits per word: %d\n", bits);
-    printf("max speed: %d Hz (%d KHz)\n", speed, speed/1000);
-
-    // 1) Clear the RGB grid once.
-    rgbGridClear();
-    spiGridClear();
+    if (recordFile != NULL)
+    {
+        // Stream chunks can be longer than a frame.
+        uint32_t maxLength = sizeof(txBuffer);
+        if (streaming && stream.chunkSize > maxLength)
+            maxLength = stream.chunkSize;
+        if (!recordOpen(&recorder, recordFile, maxLength, DEFAULT_RECORD_SLOTS))
+            pabort("can't open recording");
+        recording = true;
+    }
 
     // 2) Plot a pattern to the RGB grid
-    if (file == NULL)
+    if (replayFile != NULL)
+    {
+        replayStats_t stats;
+        if (!replayRun(replayFile, replayMaxSpeed, streamSink, &fd, &stats))
+            pabort("can't read recording");
+        double seconds = stats.elapsedNs / 1e9;
+        printf("replay: %u buffers, %llu bytes in %.3f s (%.1f per second, %.2f MB/s)",
+            stats.frames, (unsigned long long)stats.bytes, seconds,
+            seconds > 0? stats.frames / seconds : 0.0, seconds > 0? stats.bytes / seconds / 1e6 : 0.0);
+        if (!replayMaxSpeed)
+            printf(", %u late (worst %.1f ms)", stats.late, stats.maxLateNs / 1e6);
+        printf("\n");
+        finalSent = true;
+    }
+    else if (animDir != NULL)
+    {
+        printf("animation: %s at %d fps, prefetch %d\n",
+            animDir, frameRate, prefetchFrames);
+        playbackStats_t stats;
+        arenaReset(&arena);
+        int count = playbackRun(fd, animDir, frameRate, prefetchFrames,
+            loopAnim, &arena, &stats);
+        if (count < 0)
+            pabort("can't play animation directory");
+        printf("frames: %d found, %u shown, %u load errors, %u underruns "
+            "(%u transfers)\n", count, stats.framesShown, stats.loadErrors,
+            stats.underruns, stats.transfers);
+    }
+    else if (optind < argc)
+    {
+        playlist.fps = frameRate;
+        playlist.loop = loopAnim;
+        playlistStats_t stats;
+        arenaReset(&arena);
+        if (!playlistRun(fd, &argv[optind], argc - optind, &playlist,
+            loadAsset, &stats))
+            pabort("can't load any playlist asset");
+        printf("playlist: %u assets shown, %u transitions (%u frames), "
+            "%u load errors, %u late loads\n", stats.assetsShown,
+            stats.transitions, stats.frames, stats.loadErrors, stats.lateLoads);
+    }
+    else if (animFile != NULL)
+    {
+        playAnimFile(fd, animFile);
+    }
+    else if (text != NULL)
+    {
+        scrollText(text);
+    }
+    else if (exprText != NULL)
+    {
+        playExpression(fd, exprText);
+    }
+    else if (dmxProtocol != NULL)
+    {
+        dmxConfig.artnet = strcmp(dmxProtocol, "artnet") == 0;
+        printf("receiving %s: %d universes from %d\n",
+            dmxConfig.artnet? "Art-Net" : "E1.31", dmxUniverseCount(),
+            dmxConfig.firstUniverse);
+        if (queueDelayMs >= 0)
+        {
+            if (!presentInit(&presentQueue, sizeof(rgbGrid), DEFAULT_PRESENT_DEPTH,
+                frameRate, presentSink, &fd))
+                pabort("can't start presentation queue");
+            dmxConfig.pQueue = &presentQueue;
+            dmxConfig.delayNs = queueDelayMs * 1000000LL;
+        }
+        dmxStats_t stats;
+        if (dmxReceiveRun(fd, &dmxConfig, &stats) < 0)
+            pabort("can't receive DMX");
+        if (dmxConfig.pQueue != NULL)
+        {
+            presentFree(&presentQueue);
+            printf("queue: %u frames, %u presented, %u late, %u superseded, "
+                "%u overflowed, worst %.1f ms off target\n", presentQueue.submitted,
+                presentQueue.presented, presentQueue.late, presentQueue.superseded,
+                presentQueue.overflows, presentQueue.maxErrorNs / 1e6);
+        }
+        printf("dmx: %u frames, %u packets in %u batches, %u syncs "
+            "(%u early), %u bad, %u ignored, %u out of sequence\n",
+            stats.frames, stats.packets, stats.batches, stats.syncs,
+            stats.earlySyncs, stats.badPackets, stats.ignored,
+            stats.outOfSequence);
+    }
+    else if (file == NULL)
     {
         printf("No image file selected. Using pattern: %d\n", pattern);
         rgbGridPattern(fd, pattern);
     }
+    else if (caching && !streaming)
+    {
+        printf("image file: %s\n", file);
+        finalSent = sendCachedFile(fd, file);
+        if (!finalSent)
+            printf("Failed to read BMP file: %s\n", file);
+    }
     else
     {
         printf("image file: %s\n", file);
+        if (!loadBmp(file, rgbGrid))
+            printf("Failed to read BMP file: %s\n", file);
     }
 
     // 3) Transfer the grid data out to the real RGB LED Grid.
-    gridTransfer(fd);
+    if (!finalSent)
+        gridTransfer(fd);
     
-    // 4) Get some DEBUG OUT
-    dumpRgbGrid();
-    dumpSpiGrid();
-    //dumpTxBuffer();
+    // 4) Get some DEBUG OUT: on a terminal, the final frame as a panel.
+    if (!previewing && isatty(STDOUT_FILENO) && previewInit(&preview, STDOUT_FILENO))
+    {
+        previewFrame(&preview, rgbGrid);
+        previewFree(&preview);
+    }
+    if (previewing)
+    {
+        printf("preview: %u frames, %u cells drawn, %llu bytes\n", preview.frames,
+            preview.cellsDrawn, (unsigned long long)preview.bytes);
+        previewFree(&preview);
+    }
+    printf("frames: %u sent, %u suppressed as unchanged\n",
+        idle.sent, idle.suppressed);
+    if (verifyChip != NULL)
+        printf("verify: %u frames decoded, %u mismatched\n",
+            framesVerified, framesMismatched);
+    if (caching)
+        printf("cache: %u hits (%.0f us avg), %u misses (%.0f us avg), "
+            "%u evicted, %u errors\n", cache.hits,
+            cache.hits? (double)cache.hitUsecs / cache.hits : 0.0, cache.misses,
+            cache.misses? (double)cache.missUsecs / cache.misses : 0.0,
+            cache.evictions, cache.errors);
+    if (arena.peak > 0 || arena.refused > 0)
+        printf("arena: peak %.1f of %d KB, %u loads refused\n",
+            arena.peak / 1024.0, arenaKB, arena.refused);
+    if (streaming)
+    {
+        streamFree(&stream);
+        printf("stream: %u frames in %u chunks, encoder waited %u times\n",
+            stream.frames, stream.chunks, stream.encoderWaits);
+    }
+    if (recording)
+    {
+        recording = false;
+        bool ok = recordClose(&recorder);
+        printf("record: %u buffers, %llu bytes to %s, %u dropped, %u truncated%s\n",
+            recorder.recorded - recorder.dropped, (unsigned long long)recorder.bytes,
+            recordFile, recorder.dropped, recorder.truncated, ok? "" : " (WRITE FAILED)");
+    }
+    if (traceFile != NULL)
+    {
+        uint32_t events;
+        if (!traceWrite(traceFile, &events))
+            pabort("can't write trace");
+        printf("trace: %u events in %s\n", events, traceFile);
+    }
     
-    close(fd);
+    spiledClose(pLed);
+    arenaFree(&arena);
 
     return ret;
 }
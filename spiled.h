@@ -0,0 +1,124 @@
+/*
+* SPI NEOPixel 16x16 RGB LED display utility (using spidev driver)
+* By R. Blansett
+*
+* Shared definitions for spiled.cpp and its helper modules.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License.
+*
+*/
+
+#ifndef SPILED_H
+#define SPILED_H
+
+#include <stdint.h>
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define REFRESH 0x00	// 00000000 - represents "RESET"
+#define _0_0	0x88	// 10001000 - represents 00
+#define _0_1 	0x8C	// 10001100 - represents 01
+#define _1_0 	0xC8	// 11001000 - represents 10
+#define _1_1 	0xCC	// 11001100 - represents 11
+
+static const uint16_t GRID_WIDTH = 16;
+static const uint16_t GRID_HEIGHT = 16;
+static const uint16_t GRID_AREA = GRID_WIDTH * GRID_HEIGHT;
+static const uint16_t REFRESH_SIZE = 280;
+static const uint16_t BITS_PER_SPI_BYTE = 2;
+static const uint16_t SPI_BYTES_PER_BYTE = 4;
+
+struct rgbPixel_t
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a; // alpha (make it an even number)
+};
+
+struct spiRgbPixel_t
+{
+    // My scheme requires SPI 4 bytes to make 8 bits:
+    // IMPORTANT: In the LED, Green is first 8 bits, so it's GRB
+    // IMPORTANT: In the 16x16 LED panel, the even rows are order-reversed.
+    uint8_t g[SPI_BYTES_PER_BYTE];
+    uint8_t r[SPI_BYTES_PER_BYTE];
+    uint8_t b[SPI_BYTES_PER_BYTE];
+};
+
+typedef uint64_t rowMask_t;     // one bit per grid row
+
+static const rowMask_t ALL_ROWS = GRID_HEIGHT == 64? ~(rowMask_t)0 :
+    ((rowMask_t)1 << GRID_HEIGHT) - 1;
+
+static inline rgbPixel_t&
+    makeRgbPixel(rgbPixel_t& pixel, uint8_t r, uint8_t g, uint8_t b)
+{
+    pixel.r = r < 64? r : 64;
+    pixel.g = g < 64? g : 64;
+    pixel.b = b < 64? b : 64;
+    pixel.a = 0;
+
+    return pixel;
+}
+
+// Reference encoder for one GRB pixel (the display itself uses the
+// table-driven Grid::encodePixel, which must produce the same bytes).
+// NOTE: You have to pass in the spiPixel for this to fill and return.
+static inline spiRgbPixel_t& 
+    makeSpiPixel(spiRgbPixel_t& spiPixel, const rgbPixel_t& rgb)
+{
+    uint8_t mapBits [4] = {
+        _0_0,	// 10001000 - represents 00
+        _0_1, 	// 10001100 - represents 01
+        _1_0, 	// 11001000 - represents 10
+        _1_1, 	// 11001100 - represents 11
+    };
+
+    // Get copies because shifting zeros the byte.
+    uint8_t r = rgb.r;
+    uint8_t g = rgb.g;
+    uint8_t b = rgb.b;
+    for (int8_t bytePos = SPI_BYTES_PER_BYTE-1; bytePos >= 0; bytePos--)
+    {
+        // Needs 1 SPI byte per 2 bits of LED color data.
+        spiPixel.r[bytePos] = mapBits[r & 0x03];
+        r >>= 2;
+
+        spiPixel.g[bytePos] = mapBits[g & 0x03];
+        g >>= 2;
+
+        spiPixel.b[bytePos] = mapBits[b & 0x03];
+        b >>= 2;
+    }
+
+    return spiPixel;
+}
+
+#include "grid.h"
+
+// The panel this program drives. Its frame and wire image are also known
+// by their original names, rgbGrid and txBuffer.
+typedef Grid<GRID_WIDTH, GRID_HEIGHT, ORDER_GRB, WIRING_MAPPED> display_t;
+
+static const uint16_t txBuffer_SIZE = display_t::TX_SIZE;
+
+extern display_t display;
+extern rgbPixel_t (&rgbGrid)[GRID_AREA];
+extern uint8_t (&txBuffer)[txBuffer_SIZE];
+
+// Convert rgbGrid and send it (plus the REFRESH tail) out the SPI device.
+void gridTransfer(int fd);
+
+// Same, but only re-encode the given rows of rgbGrid.
+void gridTransferRows(int fd, rowMask_t rows);
+
+// Send txBuffer as it stands (for callers that encode it themselves).
+void txTransfer(int fd);
+
+// Send any wire image (e.g. another Grid's tx) out the SPI device.
+void spiTransfer(int fd, const uint8_t* tx, uint32_t len);
+
+#endif // SPILED_H
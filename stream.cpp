@@ -0,0 +1,203 @@
+/*
+* Bounded-memory streaming encoder for long LED chains
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stream.h"
+#include "trace.h"
+
+static void* transportThread(void* arg)
+{
+    wireStream_t* pStream = (wireStream_t*)arg;
+    traceThreadName("stream transport");
+
+    while (true)
+    {
+        sem_wait(&pStream->filled);
+        if (__atomic_load_n(&pStream->stop, __ATOMIC_ACQUIRE))
+            break;
+
+        int slot = pStream->tail;
+        pStream->sink(pStream->sinkCtx, &pStream->ring[slot * pStream->chunkSize],
+            pStream->lengths[slot]);
+        pStream->tail = (slot + 1) % pStream->config.slots;
+        sem_post(&pStream->free);
+    }
+    return NULL;
+}
+
+bool streamInit(wireStream_t* pStream, const streamConfig_t* pConfig,
+    chunkSink_t sink, void* sinkCtx)
+{
+    memset(pStream, 0, sizeof(*pStream));
+    pStream->config = *pConfig;
+    streamConfig_t& config = pStream->config;
+    if (config.chunkLeds < 1)
+        config.chunkLeds = DEFAULT_CHUNK_LEDS;
+    if (config.slots < 2)
+        config.slots = DEFAULT_STREAM_SLOTS;
+    if (config.width < 1)
+        config.width = config.leds;
+
+    // Every slot can take the REFRESH tail after its LEDs.
+    pStream->chunkSize = config.chunkLeds * STREAM_PIXEL_SIZE + REFRESH_SIZE;
+    pStream->ring = (uint8_t*)malloc(config.slots * pStream->chunkSize);
+    pStream->lengths = (uint32_t*)calloc(config.slots, sizeof(uint32_t));
+    if (pStream->ring == NULL || pStream->lengths == NULL)
+    {
+        free(pStream->ring);
+        free(pStream->lengths);
+        return false;
+    }
+
+    pStream->sink = sink;
+    pStream->sinkCtx = sinkCtx;
+    sem_init(&pStream->filled, 0, 0);
+    sem_init(&pStream->free, 0, config.slots);
+    if (pthread_create(&pStream->transport, NULL, transportThread, pStream) != 0)
+    {
+        sem_destroy(&pStream->filled);
+        sem_destroy(&pStream->free);
+        free(pStream->ring);
+        free(pStream->lengths);
+        return false;
+    }
+    return true;
+}
+
+void streamDrain(wireStream_t* pStream)
+{
+    for (int i = 0; i < pStream->config.slots; i++)
+        sem_wait(&pStream->free);
+    for (int i = 0; i < pStream->config.slots; i++)
+        sem_post(&pStream->free);
+}
+
+void streamFree(wireStream_t* pStream)
+{
+    streamDrain(pStream);
+    __atomic_store_n(&pStream->stop, true, __ATOMIC_RELEASE);
+    sem_post(&pStream->filled);
+    pthread_join(pStream->transport, NULL);
+
+    sem_destroy(&pStream->filled);
+    sem_destroy(&pStream->free);
+    free(pStream->ring);
+    free(pStream->lengths);
+    pStream->ring = NULL;
+    pStream->lengths = NULL;
+}
+
+// Wire bytes for one pixel of an RGB frame...
+struct rgbSource_t
+{
+    const rgbPixel_t* frame;
+
+    inline void put(uint8_t* pOut, int pixel) const
+    {
+        display_t::encodePixel(pOut, frame[pixel]);
+    }
+};
+
+// ...and of an indexed one, already encoded in the palette.
+struct indexedSource_t
+{
+    const uint8_t* frame;
+    const uint8_t (*palette)[STREAM_PIXEL_SIZE];
+
+    inline void put(uint8_t* pOut, int pixel) const
+    {
+        memcpy(pOut, palette[frame[pixel]], STREAM_PIXEL_SIZE);
+    }
+};
+
+// Encode LEDs [first, first + count) into pOut, a row segment at a time.
+template <class S> static void encodeLeds(const streamConfig_t& config, const S& source,
+    uint8_t* pOut, int first, int count)
+{
+    if (config.ledToPixel != NULL)
+    {
+        for (int led = first; led < first + count; led++, pOut += STREAM_PIXEL_SIZE)
+            source.put(pOut, config.ledToPixel[led]);
+        return;
+    }
+
+    int led = first;
+    int end = first + count;
+    while (led < end)
+    {
+        int row = led / config.width;
+        int col = led % config.width;
+        int run = config.width - col;
+        if (run > end - led)
+            run = end - led;
+
+        if (config.wiring == WIRING_SERPENTINE && !(row & 1))
+        {
+            // Reversed row: LED col is pixel width - 1 - col.
+            int pixel = row * config.width + config.width - 1 - col;
+            for (int i = 0; i < run; i++, pOut += STREAM_PIXEL_SIZE)
+                source.put(pOut, pixel--);
+        }
+        else
+        {
+            int pixel = led;
+            for (int i = 0; i < run; i++, pOut += STREAM_PIXEL_SIZE)
+                source.put(pOut, pixel++);
+        }
+        led += run;
+    }
+}
+
+template <class S> static void queueFrame(wireStream_t* pStream, const S& source)
+{
+    const streamConfig_t& config = pStream->config;
+
+    for (int first = 0; first < config.leds; first += config.chunkLeds)
+    {
+        int count = config.leds - first;
+        if (count > config.chunkLeds)
+            count = config.chunkLeds;
+
+        if (sem_trywait(&pStream->free) != 0)
+        {
+            pStream->encoderWaits++;
+            sem_wait(&pStream->free);
+        }
+
+        int slot = pStream->head;
+        uint8_t* pOut = &pStream->ring[slot * pStream->chunkSize];
+        encodeLeds(config, source, pOut, first, count);
+        uint32_t len = count * STREAM_PIXEL_SIZE;
+
+        // The last chunk carries the REFRESH tail that latches the frame.
+        if (first + count == config.leds)
+        {
+            memset(&pOut[len], REFRESH, REFRESH_SIZE);
+            len += REFRESH_SIZE;
+        }
+
+        pStream->lengths[slot] = len;
+        pStream->head = (slot + 1) % config.slots;
+        pStream->chunks++;
+        sem_post(&pStream->filled);
+    }
+    pStream->frames++;
+}
+
+void streamFrame(wireStream_t* pStream, const rgbPixel_t* frame)
+{
+    rgbSource_t source = { frame };
+    queueFrame(pStream, source);
+}
+
+void streamFrameIndexed(wireStream_t* pStream, const uint8_t* indices,
+    const uint8_t (*palette)[STREAM_PIXEL_SIZE])
+{
+    indexedSource_t source = { indices, palette };
+    queueFrame(pStream, source);
+}
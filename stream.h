@@ -0,0 +1,92 @@
+/*
+* Bounded-memory streaming encoder for long LED chains
+* By R. Blansett
+*
+* Encodes a frame in fixed-size chunks of LEDs into a small ring of wire
+* buffers. A transport thread sends each chunk as soon as it is ready
+* while the next ones are being encoded, so the full wire image never
+* exists; memory is the ring plus the caller's RGB frame, whatever the
+* chain length.
+*
+* Chunks go out as back-to-back SPI messages. The LEDs latch when the
+* line stays low for the reset time, so the gap between two messages
+* must stay well under it (280 us on current WS2812B parts, 50 us on
+* older ones). Bigger chunks mean fewer gaps.
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "spiled.h"
+
+// Streams are GRB, like the display.
+static const int STREAM_PIXEL_SIZE = display_t::WIRE_PIXEL_SIZE;
+// 256 LEDs plus the tail is 3352 bytes, inside spidev's default 4096 bufsiz.
+static const int DEFAULT_CHUNK_LEDS = 256;
+static const int DEFAULT_STREAM_SLOTS = 4;
+
+// Sends one chunk of wire bytes; called on the transport thread.
+typedef void (*chunkSink_t)(void* ctx, const uint8_t* data, uint32_t len);
+
+struct streamConfig_t
+{
+    int leds;                   // chain length
+    int width;                  // LEDs per row, for the serpentine order
+    wiring_t wiring;            // WIRING_PROGRESSIVE or WIRING_SERPENTINE
+    const uint16_t* ledToPixel; // or, for any other order: LED -> pixel
+    int chunkLeds;
+    int slots;
+};
+
+struct wireStream_t
+{
+    streamConfig_t config;
+    uint32_t chunkSize;         // bytes per slot (chunk plus room for the tail)
+
+    uint8_t* ring;
+    uint32_t* lengths;
+    int head;                   // next slot the encoder fills
+    int tail;                   // next slot the transport sends
+    sem_t filled;
+    sem_t free;
+
+    chunkSink_t sink;
+    void* sinkCtx;
+    pthread_t transport;
+    bool stop;                  // accessed with __atomic builtins
+
+    uint32_t frames;
+    uint32_t chunks;
+    uint32_t encoderWaits;      // chunks the encoder had to wait for a slot
+};
+
+bool streamInit(wireStream_t* pStream, const streamConfig_t* pConfig,
+    chunkSink_t sink, void* sinkCtx);
+
+// Waits for everything queued to go out, then stops the transport.
+void streamFree(wireStream_t* pStream);
+
+// Encode frame (config.leds pixels, row-major) and queue it, REFRESH tail
+// included. Returns once the last chunk is queued; frame may then change.
+void streamFrame(wireStream_t* pStream, const rgbPixel_t* frame);
+
+// The same for an indexed frame (one byte per pixel), each pixel copied
+// from its palette entry's wire bytes (see palette.h).
+void streamFrameIndexed(wireStream_t* pStream, const uint8_t* indices,
+    const uint8_t (*palette)[STREAM_PIXEL_SIZE]);
+
+// Wait until every queued chunk has been sent.
+void streamDrain(wireStream_t* pStream);
+
+// Bytes of memory the stream itself uses.
+static inline uint32_t streamFootprint(const wireStream_t* pStream)
+{
+    return sizeof(*pStream) + pStream->config.slots *
+        (pStream->chunkSize + sizeof(uint32_t));
+}
+
+#endif // STREAM_H
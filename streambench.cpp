@@ -0,0 +1,168 @@
+/*
+* Streaming encoder benchmark
+* By R. Blansett
+*
+* Streams frames for a long virtual chain into a sink that checks each
+* chunk against a full-frame Grid<> encode of the same chain, then times
+* the stream against encoding the whole wire image at once. Either way
+* the encode is a small fraction of the time the frame takes on the wire.
+* Indexed frames are checked and timed the same way.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "stream.h"
+#include "palette.h"
+
+// 200 x 250 = 50000 LEDs, 600KB of wire image when encoded in full.
+static const int WALL_WIDTH = 200;
+static const int WALL_HEIGHT = 250;
+typedef Grid<WALL_WIDTH, WALL_HEIGHT, ORDER_GRB, WIRING_SERPENTINE> wall_t;
+
+static wall_t wall;
+
+struct checkSink_t
+{
+    uint32_t offset;            // bytes of the current frame seen so far
+    uint32_t mismatches;
+    bool check;
+};
+
+static void checkChunk(void* ctx, const uint8_t* data, uint32_t len)
+{
+    checkSink_t* pSink = (checkSink_t*)ctx;
+    if (pSink->check && (pSink->offset + len > sizeof(wall.tx) ||
+        memcmp(&wall.tx[pSink->offset], data, len) != 0))
+    {
+        pSink->mismatches++;
+    }
+    pSink->offset += len;
+    if (pSink->offset >= sizeof(wall.tx))
+        pSink->offset = 0;
+}
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void fillFrame(int frame)
+{
+    for (int i = 0; i < wall_t::AREA; i++)
+        makeRgbPixel(wall.rgb[i], (i + frame) & 0x3F, (i >> 4) & 0x3F, frame & 0x3F);
+}
+
+int main()
+{
+    const int frames = 50;
+    const int chunkSizes[] = { 16, 64, 256, 1024 };
+
+    // Whole-frame encode, the way the display does it.
+    double start = now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        fillFrame(frame);
+        wall.encode();
+    }
+    double fullTime = (now() - start) / frames;
+    printf("chain of %d LEDs (%dx%d serpentine)\n", wall_t::AREA, WALL_WIDTH, WALL_HEIGHT);
+    printf("full frame     %8u bytes  %7.3f ms/frame  (%.0f ms on the wire at 8 MHz)\n",
+        (uint32_t)sizeof(wall.tx), fullTime * 1e3, sizeof(wall.tx) * 8 / 8e6 * 1e3);
+
+    int failures = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(chunkSizes); i++)
+    {
+        streamConfig_t config = { wall_t::AREA, WALL_WIDTH, WIRING_SERPENTINE, NULL,
+            chunkSizes[i], DEFAULT_STREAM_SLOTS };
+        checkSink_t sink = { 0, 0, true };
+        wireStream_t stream;
+        if (!streamInit(&stream, &config, checkChunk, &sink))
+        {
+            perror("can't start stream");
+            exit(1);
+        }
+
+        // Correctness: the reference wire image must be ready before the
+        // chunks arrive, so drain after each frame.
+        for (int frame = 0; frame < 3; frame++)
+        {
+            fillFrame(frame);
+            wall.encode();
+            streamFrame(&stream, wall.rgb);
+            streamDrain(&stream);
+        }
+
+        // Throughput, with the encoder and transport overlapping.
+        sink.check = false;
+        start = now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            fillFrame(frame);
+            streamFrame(&stream, wall.rgb);
+        }
+        streamDrain(&stream);
+        double streamTime = (now() - start) / frames;
+
+        printf("chunk %4d LEDs %8u bytes  %7.3f ms/frame  %5.2fx  %s\n",
+            chunkSizes[i], streamFootprint(&stream), streamTime * 1e3,
+            fullTime / streamTime, sink.mismatches? "MISMATCH" : "identical");
+        if (sink.mismatches)
+            failures++;
+        streamFree(&stream);
+    }
+
+    // Indexed: one byte per LED, each copied from its palette entry.
+    static uint8_t indices[wall_t::AREA];
+    static palette_t palette;
+    paletteInit(&palette);
+    for (int i = 0; i < PALETTE_SIZE; i++)
+    {
+        rgbPixel_t color = makeRgbPixel(color, i & 0x3F, (i >> 2) & 0x3F, 63 - (i & 0x3F));
+        paletteSet(&palette, i, color);
+    }
+
+    streamConfig_t config = { wall_t::AREA, WALL_WIDTH, WIRING_SERPENTINE, NULL,
+        DEFAULT_CHUNK_LEDS, DEFAULT_STREAM_SLOTS };
+    checkSink_t sink = { 0, 0, true };
+    wireStream_t stream;
+    if (!streamInit(&stream, &config, checkChunk, &sink))
+    {
+        perror("can't start stream");
+        exit(1);
+    }
+    for (int frame = 0; frame < 3; frame++)
+    {
+        for (int i = 0; i < wall_t::AREA; i++)
+            indices[i] = (i * 7 + frame) & 0xFF;
+        paletteExpand(&palette, indices, wall_t::AREA, wall.rgb);
+        wall.encode();
+        streamFrameIndexed(&stream, indices, palette.wire);
+        streamDrain(&stream);
+    }
+
+    sink.check = false;
+    start = now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        // Cycle the palette; the indices never change.
+        paletteSet(&palette, frame & 0xFF, palette.colors[(frame + 1) & 0xFF]);
+        streamFrameIndexed(&stream, indices, palette.wire);
+    }
+    streamDrain(&stream);
+    double indexedTime = (now() - start) / frames;
+    printf("indexed  %4d LEDs %8u bytes  %7.3f ms/frame  %5.2fx  %s\n",
+        DEFAULT_CHUNK_LEDS, streamFootprint(&stream), indexedTime * 1e3,
+        fullTime / indexedTime, sink.mismatches? "MISMATCH" : "identical");
+    if (sink.mismatches)
+        failures++;
+    streamFree(&stream);
+
+    return failures? 1 : 0;
+}
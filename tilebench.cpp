@@ -0,0 +1,189 @@
+/*
+* Tile pool scaling benchmark
+* By R. Blansett
+*
+* Renders the procedural patterns onto a 256x128 virtual wall with 1..N
+* threads, checks every result against the serial path byte for byte,
+* and reports the speedup.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "raster.h"
+#include "tilepool.h"
+#include "patterns.h"
+
+static int wallWidth = 256;
+static int wallHeight = 128;
+static int maxThreads = 0;
+static int tileWidth = DEFAULT_TILE_WIDTH;
+static int tileHeight = DEFAULT_TILE_HEIGHT;
+static int frames = 100;
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [-wHtxyn]\n", prog);
+    puts("  -w --width    wall width (default 256)\n"
+         "  -H --height   wall height (default 128)\n"
+         "  -t --threads  most threads to try (default: every core)\n"
+         "  -x --tilew    tile width (default 64)\n"
+         "  -y --tileh    tile height (default 16)\n"
+         "  -n --frames   frames per measurement (default 100)\n");
+    exit(1);
+}
+
+static void parse_opts(int argc, char *argv[])
+{
+    while (1) {
+        static const struct option lopts[] = {
+            { "width",   1, 0, 'w' },
+            { "height",  1, 0, 'H' },
+            { "threads", 1, 0, 't' },
+            { "tilew",   1, 0, 'x' },
+            { "tileh",   1, 0, 'y' },
+            { "frames",  1, 0, 'n' },
+            { NULL, 0, 0, 0 },
+        };
+        int c;
+
+        c = getopt_long(argc, argv, "w:H:t:x:y:n:", lopts, NULL);
+
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 'w':
+            wallWidth = atoi(optarg);
+            break;
+        case 'H':
+            wallHeight = atoi(optarg);
+            break;
+        case 't':
+            maxThreads = atoi(optarg);
+            break;
+        case 'x':
+            tileWidth = atoi(optarg);
+            break;
+        case 'y':
+            tileHeight = atoi(optarg);
+            break;
+        case 'n':
+            frames = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            break;
+        }
+    }
+}
+
+struct benchPattern_t
+{
+    const char* name;
+    tileShader_t shader;
+    void (*setFrame)(void* params, int frame);
+    void* params;
+};
+
+static sineParams_t sine;
+static plasmaParams_t plasma = { 0.0f, 48.0f };
+
+static void sineFrame(void* params, int frame)
+{
+    ((sineParams_t*)params)->pass = frame;
+}
+
+static void plasmaFrame(void* params, int frame)
+{
+    ((plasmaParams_t*)params)->time = frame * 0.05f;
+}
+
+int main(int argc, char * argv[])
+{
+    parse_opts(argc, argv);
+    if (maxThreads < 1)
+        maxThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (maxThreads < 1)
+        maxThreads = 1;
+
+    int area = wallWidth * wallHeight;
+    rgbPixel_t* serialPixels = new rgbPixel_t[area];
+    rgbPixel_t* poolPixels = new rgbPixel_t[area];
+    surface_t serial = makeSurface(serialPixels, wallWidth, wallHeight);
+    surface_t wall = makeSurface(poolPixels, wallWidth, wallHeight);
+
+    benchPattern_t patterns[] = {
+        { "sine", sineShader, sineFrame, &sine },
+        { "plasma", plasmaShader, plasmaFrame, &plasma },
+    };
+
+    printf("wall %dx%d (%d LEDs), tiles %dx%d, %d frames, up to %d threads\n",
+        wallWidth, wallHeight, area, tileWidth, tileHeight, frames, maxThreads);
+
+    int mismatches = 0;
+    for (size_t p = 0; p < ARRAY_SIZE(patterns); p++)
+    {
+        benchPattern_t* pPattern = &patterns[p];
+
+        double start = now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            pPattern->setFrame(pPattern->params, frame);
+            tileRenderSerial(&serial, pPattern->shader, pPattern->params);
+        }
+        double serialTime = (now() - start) / frames;
+        printf("%-8s serial     %8.3f ms/frame\n", pPattern->name, serialTime * 1e3);
+
+        for (int threads = 1; threads <= maxThreads; threads++)
+        {
+            tilePool_t pool;
+            if (!tilePoolInit(&pool, threads))
+            {
+                perror("can't start tile pool");
+                exit(1);
+            }
+
+            uint32_t steals = 0;
+            start = now();
+            for (int frame = 0; frame < frames; frame++)
+            {
+                pPattern->setFrame(pPattern->params, frame);
+                tilePoolRender(&pool, &wall, pPattern->shader, pPattern->params,
+                    tileWidth, tileHeight);
+                for (int i = 0; i < pool.count; i++)
+                    steals += pool.workers[i].steals;
+            }
+            double poolTime = (now() - start) / frames;
+
+            // The last frame of each run must match the serial render of it.
+            tileRenderSerial(&serial, pPattern->shader, pPattern->params);
+            bool same = memcmp(serialPixels, poolPixels, area * sizeof(rgbPixel_t)) == 0;
+            if (!same)
+                mismatches++;
+
+            printf("%-8s %2d thread%s %8.3f ms/frame  %5.2fx  %6.1f steals/frame  %s\n",
+                pPattern->name, threads, threads == 1? " " : "s", poolTime * 1e3,
+                serialTime / poolTime, (double)steals / frames,
+                same? "identical" : "MISMATCH");
+            tilePoolFree(&pool);
+        }
+    }
+
+    delete[] serialPixels;
+    delete[] poolPixels;
+    return mismatches? 1 : 0;
+}
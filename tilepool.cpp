@@ -0,0 +1,154 @@
+/*
+* Tile-parallel rendering for large LED walls
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tilepool.h"
+
+static void shadeTile(tilePool_t* pPool, int tile)
+{
+    rect_t rect;
+    rect.x = (tile % pPool->tilesX) * pPool->tileWidth;
+    rect.y = (tile / pPool->tilesX) * pPool->tileHeight;
+    rect.width = pPool->pDst->width - rect.x;
+    rect.height = pPool->pDst->height - rect.y;
+    if (rect.width > pPool->tileWidth)
+        rect.width = pPool->tileWidth;
+    if (rect.height > pPool->tileHeight)
+        rect.height = pPool->tileHeight;
+
+    pPool->shader(pPool->params, pPool->pDst, rect);
+}
+
+// Owner and thieves both take tiles off the front of a run with one
+// fetch-and-add; whoever gets an index below end owns that tile.
+static bool takeTile(tileWorker_t* pWorker, int* pTile)
+{
+    int tile = __atomic_fetch_add(&pWorker->next, 1, __ATOMIC_RELAXED);
+    *pTile = tile;
+    return tile < pWorker->end;
+}
+
+static void runTiles(tilePool_t* pPool, tileWorker_t* pSelf)
+{
+    int tile;
+    while (takeTile(pSelf, &tile))
+    {
+        shadeTile(pPool, tile);
+        pSelf->tilesDone++;
+    }
+
+    // Own run finished: help whoever is furthest behind.
+    while (true)
+    {
+        tileWorker_t* pVictim = NULL;
+        int most = 0;
+        for (int i = 0; i < pPool->count; i++)
+        {
+            tileWorker_t* pWorker = &pPool->workers[i];
+            int left = pWorker->end - __atomic_load_n(&pWorker->next, __ATOMIC_RELAXED);
+            if (left > most)
+            {
+                most = left;
+                pVictim = pWorker;
+            }
+        }
+        if (pVictim == NULL)
+            break;
+
+        if (takeTile(pVictim, &tile))
+        {
+            shadeTile(pPool, tile);
+            pSelf->tilesDone++;
+            pSelf->steals++;
+        }
+    }
+}
+
+static void* workerThread(void* arg)
+{
+    tileWorker_t* pWorker = (tileWorker_t*)arg;
+    tilePool_t* pPool = pWorker->pPool;
+
+    while (true)
+    {
+        sem_wait(&pWorker->start);
+        if (__atomic_load_n(&pPool->stop, __ATOMIC_ACQUIRE))
+            break;
+        runTiles(pPool, pWorker);
+        sem_post(&pPool->done);
+    }
+    return NULL;
+}
+
+bool tilePoolInit(tilePool_t* pPool, int threads)
+{
+    memset(pPool, 0, sizeof(*pPool));
+    pPool->count = threads < 1? 1 : threads;
+    pPool->workers = new tileWorker_t[pPool->count];
+    memset(pPool->workers, 0, pPool->count * sizeof(tileWorker_t));
+    sem_init(&pPool->done, 0, 0);
+
+    for (int i = 0; i < pPool->count; i++)
+    {
+        tileWorker_t* pWorker = &pPool->workers[i];
+        pWorker->pPool = pPool;
+        sem_init(&pWorker->start, 0, 0);
+        if (i > 0 && pthread_create(&pWorker->thread, NULL, workerThread, pWorker) != 0)
+        {
+            pPool->count = i;
+            tilePoolFree(pPool);
+            return false;
+        }
+    }
+    return true;
+}
+
+void tilePoolFree(tilePool_t* pPool)
+{
+    __atomic_store_n(&pPool->stop, true, __ATOMIC_RELEASE);
+    for (int i = 1; i < pPool->count; i++)
+    {
+        sem_post(&pPool->workers[i].start);
+        pthread_join(pPool->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < pPool->count; i++)
+        sem_destroy(&pPool->workers[i].start);
+    sem_destroy(&pPool->done);
+    delete[] pPool->workers;
+    pPool->workers = NULL;
+    pPool->count = 0;
+}
+
+void tilePoolRender(tilePool_t* pPool, surface_t* pDst, tileShader_t shader,
+    const void* params, int tileWidth, int tileHeight)
+{
+    pPool->pDst = pDst;
+    pPool->shader = shader;
+    pPool->params = params;
+    pPool->tileWidth = tileWidth > 0? tileWidth : DEFAULT_TILE_WIDTH;
+    pPool->tileHeight = tileHeight > 0? tileHeight : DEFAULT_TILE_HEIGHT;
+    pPool->tilesX = (pDst->width + pPool->tileWidth - 1) / pPool->tileWidth;
+    int tilesY = (pDst->height + pPool->tileHeight - 1) / pPool->tileHeight;
+    int tiles = pPool->tilesX * tilesY;
+
+    // Contiguous runs, so each worker starts on neighbouring tiles.
+    for (int i = 0; i < pPool->count; i++)
+    {
+        tileWorker_t* pWorker = &pPool->workers[i];
+        pWorker->next = tiles * i / pPool->count;
+        pWorker->end = tiles * (i + 1) / pPool->count;
+        pWorker->tilesDone = 0;
+        pWorker->steals = 0;
+    }
+
+    for (int i = 1; i < pPool->count; i++)
+        sem_post(&pPool->workers[i].start);
+    runTiles(pPool, &pPool->workers[0]);
+    for (int i = 1; i < pPool->count; i++)
+        sem_wait(&pPool->done);
+}
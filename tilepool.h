@@ -0,0 +1,81 @@
+/*
+* Tile-parallel rendering for large LED walls
+* By R. Blansett
+*
+* Splits a frame into cache-sized tiles and runs a shader over them on a
+* pool of threads. Each worker starts on its own contiguous run of tiles
+* and, once that is done, steals tiles from whichever worker has the most
+* left, so an uneven shader still keeps every core busy. The calling
+* thread works too.
+*
+* Shaders must compute each pixel from its (x, y) and the params only;
+* then any split of the frame gives exactly the same pixels as one call
+* over the whole surface.
+*/
+
+#ifndef TILEPOOL_H
+#define TILEPOOL_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "spiled.h"
+#include "raster.h"
+
+// Fill the part of pDst inside tile.
+typedef void (*tileShader_t)(const void* params, surface_t* pDst, rect_t tile);
+
+// 64x16 tiles are 4KB of rgbPixel_t, comfortably inside L1.
+static const int DEFAULT_TILE_WIDTH = 64;
+static const int DEFAULT_TILE_HEIGHT = 16;
+
+struct tilePool_t;
+
+struct tileWorker_t
+{
+    pthread_t thread;
+    sem_t start;
+    tilePool_t* pPool;
+
+    int next;                   // next tile of this worker's run (atomic)
+    int end;
+
+    uint32_t tilesDone;         // stats, since the last tilePoolRender
+    uint32_t steals;
+};
+
+struct tilePool_t
+{
+    tileWorker_t* workers;      // workers[0] is the calling thread
+    int count;
+    sem_t done;
+    bool stop;
+
+    // The frame being rendered.
+    surface_t* pDst;
+    tileShader_t shader;
+    const void* params;
+    int tileWidth;
+    int tileHeight;
+    int tilesX;
+};
+
+// Start threads - 1 helper threads. Returns false if they can't be started.
+bool tilePoolInit(tilePool_t* pPool, int threads);
+void tilePoolFree(tilePool_t* pPool);
+
+// Shade all of pDst and return once every tile is done. A tile size of
+// 0 picks the default.
+void tilePoolRender(tilePool_t* pPool, surface_t* pDst, tileShader_t shader,
+    const void* params, int tileWidth, int tileHeight);
+
+// The serial path: one shader call over the whole surface.
+static inline void tileRenderSerial(surface_t* pDst, tileShader_t shader,
+    const void* params)
+{
+    rect_t all = { 0, 0, pDst->width, pDst->height };
+    shader(params, pDst, all);
+}
+
+#endif // TILEPOOL_H
@@ -0,0 +1,26 @@
+/*
+* Frame clock helpers for the SPI NEOPixel display
+* By R. Blansett
+*
+* The paced loops (playback, playlists, audio, dmxsend) sleep to absolute
+* CLOCK_MONOTONIC deadlines with clock_nanosleep(TIMER_ABSTIME), stepping
+* the deadline by one period at a time so that no drift accumulates.
+*/
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <time.h>
+
+// Move t on by nsec (which may exceed a second).
+static inline void addNsec(struct timespec& t, long nsec)
+{
+    t.tv_nsec += nsec;
+    while (t.tv_nsec >= 1000000000L)
+    {
+        t.tv_nsec -= 1000000000L;
+        t.tv_sec++;
+    }
+}
+
+#endif // TIMING_H
@@ -0,0 +1,164 @@
+/*
+* Frame-path tracing for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+struct traceEvent_t
+{
+    uint64_t beginNs;
+    uint32_t durationNs;
+    uint32_t stage;
+};
+
+struct traceRing_t
+{
+    traceRing_t* pNext;         // all rings, newest first
+    int tid;
+    bool inUse;                 // owned by a live thread
+    char name[32];
+    uint32_t capacity;
+    uint64_t head;              // events ever recorded; only the owner writes
+    traceEvent_t* events;
+};
+
+bool traceEnabled = false;
+
+static int eventsPerRing;
+static uint64_t startNs;
+static traceRing_t* pRings = NULL;
+static int nextTid = 0;
+static __thread traceRing_t* pOwnRing = NULL;
+static pthread_key_t ringKey;
+
+static const char* stageNames[TRACE_STAGES] =
+{
+    "generate", "convert", "encode", "transfer", "sleep"
+};
+
+// A thread that exits hands its ring (and track) on to the next new
+// thread, so short-lived loaders don't each cost a ring.
+static void releaseRing(void* arg)
+{
+    __atomic_store_n(&((traceRing_t*)arg)->inUse, false, __ATOMIC_RELEASE);
+}
+
+bool traceStart(int eventsPerThread)
+{
+    eventsPerRing = eventsPerThread > 0? eventsPerThread : DEFAULT_TRACE_EVENTS;
+    startNs = traceNow();
+    if (pthread_key_create(&ringKey, releaseRing) != 0)
+        return false;
+    traceEnabled = true;
+    traceThreadName("main");
+    return pOwnRing != NULL;
+}
+
+// The calling thread's ring, made and linked in on first use.
+static traceRing_t* ownRing()
+{
+    if (pOwnRing != NULL)
+        return pOwnRing;
+
+    for (traceRing_t* pRing = __atomic_load_n(&pRings, __ATOMIC_ACQUIRE); pRing != NULL;
+        pRing = pRing->pNext)
+    {
+        bool inUse = false;
+        if (__atomic_compare_exchange_n(&pRing->inUse, &inUse, true, false,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            pthread_setspecific(ringKey, pRing);
+            pOwnRing = pRing;
+            return pRing;
+        }
+    }
+
+    traceRing_t* pRing = (traceRing_t*)calloc(1, sizeof(traceRing_t));
+    if (pRing == NULL)
+        return NULL;
+    pRing->events = (traceEvent_t*)malloc(eventsPerRing * sizeof(traceEvent_t));
+    if (pRing->events == NULL)
+    {
+        free(pRing);
+        return NULL;
+    }
+    pRing->capacity = eventsPerRing;
+    pRing->inUse = true;
+    pRing->tid = __atomic_fetch_add(&nextTid, 1, __ATOMIC_RELAXED) + 1;
+    snprintf(pRing->name, sizeof(pRing->name), "thread %d", pRing->tid);
+
+    pRing->pNext = __atomic_load_n(&pRings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&pRings, &pRing->pNext, pRing, true,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    pthread_setspecific(ringKey, pRing);
+    pOwnRing = pRing;
+    return pRing;
+}
+
+void traceThreadName(const char* name)
+{
+    if (!traceEnabled)
+        return;
+    traceRing_t* pRing = ownRing();
+    if (pRing != NULL)
+        snprintf(pRing->name, sizeof(pRing->name), "%s", name);
+}
+
+void traceRecord(traceStage_t stage, uint64_t beginNs, uint64_t endNs)
+{
+    traceRing_t* pRing = ownRing();
+    if (pRing == NULL)
+        return;
+
+    uint64_t head = pRing->head;
+    traceEvent_t& event = pRing->events[head % pRing->capacity];
+    event.beginNs = beginNs;
+    event.durationNs = endNs - beginNs > 0xFFFFFFFFull? 0xFFFFFFFF : (uint32_t)(endNs - beginNs);
+    event.stage = stage;
+    __atomic_store_n(&pRing->head, head + 1, __ATOMIC_RELEASE);
+}
+
+bool traceWrite(const char* path, uint32_t* pEvents)
+{
+    *pEvents = 0;
+    FILE* pFile = fopen(path, "w");
+    if (pFile == NULL)
+        return false;
+
+    fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(pFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"name\":\"spitest\"}}");
+
+    for (traceRing_t* pRing = __atomic_load_n(&pRings, __ATOMIC_ACQUIRE); pRing != NULL;
+        pRing = pRing->pNext)
+    {
+        fprintf(pFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s\"}}", pRing->tid, pRing->name);
+
+        // The oldest event the ring still holds; one slot is left alone
+        // in case its owner is writing it right now.
+        uint64_t head = __atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > pRing->capacity - 1? head - (pRing->capacity - 1) : 0;
+        for (uint64_t i = first; i < head; i++)
+        {
+            const traceEvent_t& event = pRing->events[i % pRing->capacity];
+            if (event.beginNs < startNs)
+                continue;
+            fprintf(pFile, ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\","
+                "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                stageNames[event.stage], pRing->tid, (event.beginNs - startNs) / 1e3,
+                event.durationNs / 1e3);
+            (*pEvents)++;
+        }
+    }
+
+    fprintf(pFile, "\n]}\n");
+    return fclose(pFile) == 0;
+}
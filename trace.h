@@ -0,0 +1,67 @@
+/*
+* Frame-path tracing for the SPI NEOPixel display
+* By R. Blansett
+*
+* Records when each stage of each frame began and ended: pattern
+* generation, conversion (BMP to grid), encoding into the wire format,
+* the SPI transfer, and the sleep until the next frame. Every thread
+* that records gets its own ring of events, written only by that thread,
+* so recording takes no lock; a full ring overwrites its oldest events.
+* traceWrite() saves the lot as Chrome trace JSON, which Perfetto
+* (ui.perfetto.dev) and chrome://tracing open as one timeline per thread.
+*
+* Off unless traceStart() is called. Disabled, traceBegin() is a load
+* and a branch, and traceEnd() of its 0 does nothing.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+
+enum traceStage_t
+{
+    TRACE_GENERATE,
+    TRACE_CONVERT,
+    TRACE_ENCODE,
+    TRACE_TRANSFER,
+    TRACE_SLEEP,
+    TRACE_STAGES
+};
+
+static const int DEFAULT_TRACE_EVENTS = 65536;     // per thread
+
+extern bool traceEnabled;
+
+bool traceStart(int eventsPerThread);
+
+// Name the calling thread's track in the trace.
+void traceThreadName(const char* name);
+
+void traceRecord(traceStage_t stage, uint64_t beginNs, uint64_t endNs);
+
+// Save everything recorded so far. Threads still recording may lose
+// the event in progress, nothing more.
+bool traceWrite(const char* path, uint32_t* pEvents);
+
+static inline uint64_t traceNow()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+// uint64_t t = traceBegin(); ...the stage...; traceEnd(TRACE_ENCODE, t);
+static inline uint64_t traceBegin()
+{
+    return traceEnabled? traceNow() : 0;
+}
+
+static inline void traceEnd(traceStage_t stage, uint64_t beginNs)
+{
+    if (beginNs != 0)
+        traceRecord(stage, beginNs, traceNow());
+}
+
+#endif // TRACE_H
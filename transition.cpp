@@ -0,0 +1,275 @@
+/*
+* Transitions between frames for the SPI NEOPixel display
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "spiled.h"
+#include "transition.h"
+#include "trace.h"
+#include "timing.h"
+
+static_assert(sizeof(rgbPixel_t) == 4, "lerp kernel expects packed RGBA");
+
+// Two whole pixels at a time, at any alignment, without breaking strict aliasing.
+typedef uint64_t __attribute__((may_alias, aligned(1))) pixelPair_t;
+typedef uint32_t __attribute__((may_alias, aligned(1))) pixelWord_t;
+
+static const uint64_t LANES = 0x00FF00FF00FF00FFull;
+static const uint64_t ROUND = 0x0080008000800080ull;
+
+// Each channel sits in its own 16-bit lane, so one multiply weights four
+// channels; 255 * 256 + 128 still fits the lane.
+static inline uint64_t lerpPair(uint64_t a, uint64_t b, uint64_t t)
+{
+    uint64_t s = TRANSITION_STEPS - t;
+    uint64_t lo = (((a & LANES) * s + (b & LANES) * t + ROUND) >> 8) & LANES;
+    uint64_t hi = (((a >> 8) & LANES) * s + ((b >> 8) & LANES) * t + ROUND) & ~LANES;
+    return lo | hi;
+}
+
+void transitionLerpRow(rgbPixel_t* out, const rgbPixel_t* from,
+    const rgbPixel_t* to, int count, int t)
+{
+    pixelPair_t* pOut = (pixelPair_t*)out;
+    const pixelPair_t* pFrom = (const pixelPair_t*)from;
+    const pixelPair_t* pTo = (const pixelPair_t*)to;
+    for (int i = 0; i < count / 2; i++)
+        pOut[i] = lerpPair(pFrom[i], pTo[i], t);
+
+    if (count & 1)
+    {
+        int last = count - 1;
+        ((pixelWord_t*)out)[last] = (uint32_t)lerpPair(
+            ((const pixelWord_t*)from)[last], ((const pixelWord_t*)to)[last], t);
+    }
+}
+
+// Rank of each pixel in the dissolve order: a fixed shuffle, so a
+// dissolve looks the same every time.
+static uint16_t dissolveRank[GRID_AREA];
+static bool dissolveReady = false;
+
+static void buildDissolve()
+{
+    uint32_t seed = 0x2545F491;
+    for (int i = 0; i < GRID_AREA; i++)
+        dissolveRank[i] = i;
+    for (int i = GRID_AREA - 1; i > 0; i--)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        int j = seed % (i + 1);
+        uint16_t tmp = dissolveRank[i];
+        dissolveRank[i] = dissolveRank[j];
+        dissolveRank[j] = tmp;
+    }
+    dissolveReady = true;
+}
+
+void transitionFrame(rgbPixel_t* out, const rgbPixel_t* from,
+    const rgbPixel_t* to, transition_t kind, int t)
+{
+    if (t < 0)
+        t = 0;
+    if (t > TRANSITION_STEPS)
+        t = TRANSITION_STEPS;
+
+    switch (kind)
+    {
+        case TRANSITION_CUT:
+            memcpy(out, t < TRANSITION_STEPS? from : to, GRID_AREA * sizeof(rgbPixel_t));
+            break;
+
+        case TRANSITION_FADE:
+            transitionLerpRow(out, from, to, GRID_AREA, t);
+            break;
+
+        case TRANSITION_WIPE:
+        {
+            // Column weights: done left of the edge, the edge column part way.
+            uint16_t weight[GRID_WIDTH];
+            int edge = t * GRID_WIDTH;
+            for (int col = 0; col < GRID_WIDTH; col++)
+            {
+                int w = edge - col * TRANSITION_STEPS;
+                weight[col] = w < 0? 0 : w > TRANSITION_STEPS? TRANSITION_STEPS : w;
+            }
+            for (int row = 0; row < GRID_HEIGHT; row++)
+            {
+                int base = row * GRID_WIDTH;
+                for (int col = 0; col < GRID_WIDTH; col++)
+                    transitionLerpRow(&out[base + col], &from[base + col],
+                        &to[base + col], 1, weight[col]);
+            }
+            break;
+        }
+
+        case TRANSITION_DISSOLVE:
+        {
+            if (!dissolveReady)
+                buildDissolve();
+            int switched = t * GRID_AREA / TRANSITION_STEPS;
+            for (int i = 0; i < GRID_AREA; i++)
+                out[i] = dissolveRank[i] < switched? to[i] : from[i];
+            break;
+        }
+    }
+}
+
+bool transitionParse(const char* spec, transition_t* pKind, int* pMs)
+{
+    static const struct
+    {
+        const char* name;
+        transition_t kind;
+    } names[] = {
+        { "cut", TRANSITION_CUT },
+        { "fade", TRANSITION_FADE },
+        { "wipe", TRANSITION_WIPE },
+        { "dissolve", TRANSITION_DISSOLVE },
+    };
+
+    const char* colon = strchr(spec, ':');
+    size_t len = colon? (size_t)(colon - spec) : strlen(spec);
+    for (size_t i = 0; i < ARRAY_SIZE(names); i++)
+    {
+        if (strlen(names[i].name) == len && strncmp(spec, names[i].name, len) == 0)
+        {
+            *pKind = names[i].kind;
+            if (colon)
+                *pMs = atoi(colon + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// One background load: the loader thread fills frame while the display
+// holds the current asset.
+struct assetLoad_t
+{
+    pthread_t thread;
+    const char* name;
+    rgbPixel_t* frame;
+    assetLoader_t load;
+    bool ok;
+    bool done;                  // accessed with __atomic builtins
+};
+
+static void* loadThread(void* arg)
+{
+    assetLoad_t* pLoad = (assetLoad_t*)arg;
+    traceThreadName("asset loader");
+    pLoad->ok = pLoad->load(pLoad->name, pLoad->frame);
+    __atomic_store_n(&pLoad->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+bool playlistRun(int fd, char* const* names, int count,
+    const playlistConfig_t* pConfig, assetLoader_t load, playlistStats_t* pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+
+    rgbPixel_t (*frames)[GRID_AREA] = new rgbPixel_t[2][GRID_AREA];
+    rgbPixel_t* pShown = frames[0];
+    rgbPixel_t* pNext = frames[1];
+
+    // The first asset is loaded up front; there is nothing to hide it behind.
+    int index = 0;
+    while (index < count && !load(names[index], pShown))
+    {
+        printf("playlist: can't load %s\n", names[index]);
+        pStats->loadErrors++;
+        index++;
+    }
+    if (index == count)
+    {
+        delete[] frames;
+        return false;
+    }
+
+    memcpy(rgbGrid, pShown, sizeof(rgbGrid));
+    gridTransfer(fd);
+    pStats->assetsShown++;
+
+    int fps = pConfig->fps < 1? 1 : pConfig->fps;
+    int steps = pConfig->kind == TRANSITION_CUT? 1 :
+        pConfig->transitionMs * fps / 1000;
+    if (steps < 1)
+        steps = 1;
+    const long FRAME_NSEC = 1000000000L / fps;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    addNsec(next, pConfig->holdMs * 1000000L);
+
+    int failures = 0;
+    while (count > 1)
+    {
+        if (++index == count)
+        {
+            if (!pConfig->loop)
+                break;
+            index = 0;
+        }
+
+        // Load the next asset while the current one is held.
+        assetLoad_t job = { 0, names[index], pNext, load, false, false };
+        if (pthread_create(&job.thread, NULL, loadThread, &job) != 0)
+        {
+            perror("can't start asset loader");
+            exit(1);
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (!__atomic_load_n(&job.done, __ATOMIC_ACQUIRE))
+            pStats->lateLoads++;
+        pthread_join(job.thread, NULL);
+
+        if (!job.ok)
+        {
+            printf("playlist: can't load %s\n", names[index]);
+            pStats->loadErrors++;
+            if (++failures >= count)
+                break;
+            continue;
+        }
+        failures = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        for (int step = 1; step <= steps; step++)
+        {
+            uint64_t generated = traceBegin();
+            transitionFrame(rgbGrid, pShown, pNext, pConfig->kind,
+                step * TRANSITION_STEPS / steps);
+            traceEnd(TRACE_GENERATE, generated);
+            gridTransfer(fd);
+            pStats->frames++;
+
+            addNsec(next, FRAME_NSEC);
+            uint64_t slept = traceBegin();
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            traceEnd(TRACE_SLEEP, slept);
+        }
+
+        rgbPixel_t* pTmp = pShown;
+        pShown = pNext;
+        pNext = pTmp;
+        pStats->assetsShown++;
+        pStats->transitions++;
+
+        addNsec(next, pConfig->holdMs * 1000000L);
+    }
+
+    // Give the last asset its hold time too.
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+    delete[] frames;
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+* Transitions between frames for the SPI NEOPixel display
+* By R. Blansett
+*
+* Crossfade, wipe and dissolve between two pre-converted frames, and a
+* playlist player that shows a list of assets with a transition between
+* each pair. The next asset is loaded on a background thread while the
+* current one is on the display, so a slow BMP never stalls a transition.
+*
+* Progress is 0..256 (0 = all "from", 256 = all "to"). Every in-between
+* frame is one blend of the two endpoints plus an encode.
+*/
+
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+enum transition_t
+{
+    TRANSITION_CUT,
+    TRANSITION_FADE,            // crossfade every pixel
+    TRANSITION_WIPE,            // left to right, one pixel soft edge
+    TRANSITION_DISSOLVE,        // pixels switch over in a fixed random order
+};
+
+static const int TRANSITION_STEPS = 256;
+
+// "fade", "wipe", "dissolve" or "cut", optionally followed by ":ms".
+bool transitionParse(const char* spec, transition_t* pKind, int* pMs);
+
+// out = from * (256 - t) / 256 + to * t / 256, for count pixels.
+void transitionLerpRow(rgbPixel_t* out, const rgbPixel_t* from,
+    const rgbPixel_t* to, int count, int t);
+
+// One grid-sized in-between frame at progress t (0..256).
+void transitionFrame(rgbPixel_t* out, const rgbPixel_t* from,
+    const rgbPixel_t* to, transition_t kind, int t);
+
+// Fill frame with the named asset; called on the loader thread.
+typedef bool (*assetLoader_t)(const char* name, rgbPixel_t* frame);
+
+struct playlistConfig_t
+{
+    transition_t kind;
+    int transitionMs;
+    int holdMs;                 // time each asset stays up between transitions
+    int fps;                    // transition frame rate
+    bool loop;
+};
+
+struct playlistStats_t
+{
+    uint32_t assetsShown;
+    uint32_t transitions;
+    uint32_t frames;            // in-between frames sent
+    uint32_t loadErrors;        // assets skipped
+    uint32_t lateLoads;         // transitions that had to wait for the loader
+};
+
+// Show each named asset in turn. Returns false if none could be loaded.
+bool playlistRun(int fd, char* const* names, int count,
+    const playlistConfig_t* pConfig, assetLoader_t load, playlistStats_t* pStats);
+
+#endif // TRANSITION_H
@@ -0,0 +1,168 @@
+/*
+* Wire-format decoder and WS2812 timing check
+* By R. Blansett
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "wire.h"
+
+// Datasheet limits. The ws2812b figures are from the original datasheet;
+// V5 parts only differ in needing the longer reset.
+const ledTiming_t LED_TIMINGS[] = {
+    { "ws2812",   200, 500,  650, 950,  550, 850,  450, 750,  50000 },
+    { "ws2812b",  250, 550,  700, 1000, 650, 950,  300, 600,  50000 },
+    { "ws2812b-v5", 250, 550, 700, 1000, 650, 950, 300, 600,  280000 },
+    { "sk6812",   150, 450,  750, 1050, 450, 750,  450, 750,  80000 },
+};
+const int LED_TIMING_COUNT = ARRAY_SIZE(LED_TIMINGS);
+
+const ledTiming_t* ledTimingFind(const char* name)
+{
+    for (int i = 0; i < LED_TIMING_COUNT; i++)
+    {
+        if (strcmp(LED_TIMINGS[i].name, name) == 0)
+            return &LED_TIMINGS[i];
+    }
+    return NULL;
+}
+
+// Symbol byte -> its two LED bits, or -1.
+static int symbolBits(uint8_t byte)
+{
+    switch (byte)
+    {
+        case _0_0: return 0;
+        case _0_1: return 1;
+        case _1_0: return 2;
+        case _1_1: return 3;
+        default:   return -1;
+    }
+}
+
+uint32_t wireFrameLength(const uint8_t* wire, uint32_t len)
+{
+    // Data runs until the first zero byte; the frame then ends where the
+    // zero run does.
+    uint32_t i = 0;
+    while (i < len && wire[i] != REFRESH)
+        i++;
+    while (i < len && wire[i] == REFRESH)
+        i++;
+    return i;
+}
+
+int wireDecode(const uint8_t* wire, uint32_t len, rgbPixel_t* leds, int maxLeds,
+    wireDecode_t* pDecode)
+{
+    memset(pDecode, 0, sizeof(*pDecode));
+    pDecode->firstBadOffset = -1;
+
+    uint32_t data = 0;
+    while (data < len && wire[data] != REFRESH)
+        data++;
+    pDecode->dataBytes = data;
+    uint32_t tail = data;
+    while (tail < len && wire[tail] == REFRESH)
+        tail++;
+    pDecode->refreshBytes = tail - data;
+
+    // Each color byte is 4 symbols, most significant pair first; GRB order.
+    const uint32_t LED_BYTES = 3 * SPI_BYTES_PER_BYTE;
+    int count = 0;
+    for (uint32_t offset = 0; offset + LED_BYTES <= data; offset += LED_BYTES)
+    {
+        uint8_t color[3];
+        for (int c = 0; c < 3; c++)
+        {
+            uint8_t value = 0;
+            for (int i = 0; i < SPI_BYTES_PER_BYTE; i++)
+            {
+                uint32_t at = offset + c * SPI_BYTES_PER_BYTE + i;
+                int bits = symbolBits(wire[at]);
+                if (bits < 0)
+                {
+                    if (pDecode->firstBadOffset < 0)
+                        pDecode->firstBadOffset = at;
+                    pDecode->badSymbols++;
+                    bits = 0;
+                }
+                value = (value << 2) | bits;
+            }
+            color[c] = value;
+        }
+
+        if (count < maxLeds)
+        {
+            leds[count].r = color[1];
+            leds[count].g = color[0];
+            leds[count].b = color[2];
+            leds[count].a = 0;
+        }
+        count++;
+    }
+    pDecode->leds = count;
+    pDecode->strayBytes = data % LED_BYTES;
+
+    return count < maxLeds? count : maxLeds;
+}
+
+// High bits at the top of a 4-bit symbol half, then the low bits after.
+static void nibblePulse(uint8_t nibble, int* pHigh, int* pLow)
+{
+    int high = 0;
+    int bit = 3;
+    while (bit >= 0 && (nibble >> bit) & 1)
+    {
+        high++;
+        bit--;
+    }
+    *pHigh = high;
+    *pLow = 4 - high;
+}
+
+void wireCheckTiming(uint32_t speedHz, uint32_t refreshBytes,
+    const ledTiming_t* pTiming, wireTiming_t* pResult)
+{
+    memset(pResult, 0, sizeof(*pResult));
+    pResult->speedHz = speedHz;
+    pResult->bitNs = (int)(1000000000.0 / speedHz + 0.5);
+
+    // Every symbol is two LED bits of the form 1000 (0) or 1100 (1).
+    int high, low;
+    nibblePulse(_0_0 >> 4, &high, &low);
+    pResult->t0h = high * pResult->bitNs;
+    pResult->t0l = low * pResult->bitNs;
+    nibblePulse(_1_1 >> 4, &high, &low);
+    pResult->t1h = high * pResult->bitNs;
+    pResult->t1l = low * pResult->bitNs;
+
+    // The tail follows the last symbol's own low bits.
+    int lastLow = pResult->t0l < pResult->t1l? pResult->t0l : pResult->t1l;
+    pResult->resetNs = refreshBytes * 8 * pResult->bitNs + lastLow;
+
+    pResult->t0hOk = pResult->t0h >= pTiming->t0hMin && pResult->t0h <= pTiming->t0hMax;
+    pResult->t0lOk = pResult->t0l >= pTiming->t0lMin && pResult->t0l <= pTiming->t0lMax;
+    pResult->t1hOk = pResult->t1h >= pTiming->t1hMin && pResult->t1h <= pTiming->t1hMax;
+    pResult->t1lOk = pResult->t1l >= pTiming->t1lMin && pResult->t1l <= pTiming->t1lMax;
+    pResult->resetOk = pResult->resetNs >= pTiming->resetMin;
+    pResult->ok = pResult->t0hOk && pResult->t0lOk && pResult->t1hOk &&
+        pResult->t1lOk && pResult->resetOk;
+}
+
+void wirePrintTiming(const wireTiming_t* pResult, const ledTiming_t* pTiming)
+{
+    printf("timing: %s at %u Hz (%d ns per SPI bit): %s\n", pTiming->name,
+        pResult->speedHz, pResult->bitNs, pResult->ok? "OK" : "OUT OF SPEC");
+    printf("  T0H %5d ns (%d-%d) %s\n", pResult->t0h, pTiming->t0hMin,
+        pTiming->t0hMax, pResult->t0hOk? "ok" : "BAD");
+    printf("  T0L %5d ns (%d-%d) %s\n", pResult->t0l, pTiming->t0lMin,
+        pTiming->t0lMax, pResult->t0lOk? "ok" : "BAD");
+    printf("  T1H %5d ns (%d-%d) %s\n", pResult->t1h, pTiming->t1hMin,
+        pTiming->t1hMax, pResult->t1hOk? "ok" : "BAD");
+    printf("  T1L %5d ns (%d-%d) %s\n", pResult->t1l, pTiming->t1lMin,
+        pTiming->t1lMax, pResult->t1lOk? "ok" : "BAD");
+    printf("  RES %5d us (>= %d) %s\n", pResult->resetNs / 1000,
+        pTiming->resetMin / 1000, pResult->resetOk? "ok" : "BAD");
+}
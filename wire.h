@@ -0,0 +1,75 @@
+/*
+* Wire-format decoder and WS2812 timing check
+* By R. Blansett
+*
+* Turns captured SPI bytes back into LED colors and checks them the way
+* the LED chain would see them: every SPI byte must be one of the four
+* two-bit symbols, and at a given SPI clock the high and low pulse
+* widths of each LED bit, and the low time that latches a frame, must
+* fall inside the chip's tolerances.
+*
+* This lets an encoder change be verified bit-exact and timing-correct
+* without a logic analyzer.
+*/
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stdint.h>
+
+#include "spiled.h"
+
+// LED timing limits, in ns.
+struct ledTiming_t
+{
+    const char* name;
+    int t0hMin, t0hMax;         // high then low time of a 0 bit
+    int t0lMin, t0lMax;
+    int t1hMin, t1hMax;         // high then low time of a 1 bit
+    int t1lMin, t1lMax;
+    int resetMin;               // low time that latches the frame
+};
+
+extern const ledTiming_t LED_TIMINGS[];
+extern const int LED_TIMING_COUNT;
+
+// Chip by name (ws2812, ws2812b, ws2812b-v5, sk6812), or NULL.
+const ledTiming_t* ledTimingFind(const char* name);
+
+struct wireDecode_t
+{
+    int leds;                   // complete LEDs decoded
+    uint32_t dataBytes;         // bytes before the REFRESH tail
+    uint32_t refreshBytes;      // zero bytes after the data
+    uint32_t badSymbols;        // data bytes that aren't a two-bit symbol
+    int32_t firstBadOffset;     // -1 if none
+    uint32_t strayBytes;        // data bytes left over after the last LED
+};
+
+// Decode one latched frame (data then zero tail) into up to maxLeds
+// colors in chain order. Returns the number of LEDs decoded.
+int wireDecode(const uint8_t* wire, uint32_t len, rgbPixel_t* leds, int maxLeds,
+    wireDecode_t* pDecode);
+
+// Length of the first frame in a capture: its data plus the zero run
+// after it. 0 if the capture is empty.
+uint32_t wireFrameLength(const uint8_t* wire, uint32_t len);
+
+struct wireTiming_t
+{
+    uint32_t speedHz;
+    int bitNs;                  // one SPI bit
+    int t0h, t0l, t1h, t1l;     // pulse widths the symbols produce
+    int resetNs;                // low time of the REFRESH tail
+    bool t0hOk, t0lOk, t1hOk, t1lOk, resetOk;
+    bool ok;
+};
+
+// Pulse widths the symbol encoding produces at speedHz, with a tail of
+// refreshBytes zero bytes, checked against pTiming.
+void wireCheckTiming(uint32_t speedHz, uint32_t refreshBytes,
+    const ledTiming_t* pTiming, wireTiming_t* pResult);
+
+void wirePrintTiming(const wireTiming_t* pResult, const ledTiming_t* pTiming);
+
+#endif // WIRE_H
@@ -0,0 +1,156 @@
+/*
+* Wire capture checker
+* By R. Blansett
+*
+* Splits a capture of SPI bytes (e.g. everything spiled sent) into
+* latched frames, decodes each back into LED colors, flags any byte that
+* isn't a valid symbol, and checks the pulse timing at an SPI clock
+* against an LED chip's limits.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "spiled.h"
+#include "wire.h"
+
+static uint32_t speed = 8000000;
+static const char *chip = "ws2812";
+static int width = GRID_WIDTH;
+static int showFrame = -1;
+
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [-scwp] capture\n", prog);
+    puts("  -s --speed    SPI clock the capture is sent at (default 8000000)\n"
+         "  -c --chip     ws2812, ws2812b, ws2812b-v5 or sk6812 (default ws2812)\n"
+         "  -w --width    LEDs per printed row (default 16)\n"
+         "  -p --print    print the colors of this frame, in chain order\n");
+    exit(1);
+}
+
+static void parse_opts(int argc, char *argv[])
+{
+    while (1) {
+        static const struct option lopts[] = {
+            { "speed",   1, 0, 's' },
+            { "chip",    1, 0, 'c' },
+            { "width",   1, 0, 'w' },
+            { "print",   1, 0, 'p' },
+            { NULL, 0, 0, 0 },
+        };
+        int c;
+
+        c = getopt_long(argc, argv, "s:c:w:p:", lopts, NULL);
+
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 's':
+            speed = atoi(optarg);
+            break;
+        case 'c':
+            chip = optarg;
+            break;
+        case 'w':
+            width = atoi(optarg);
+            break;
+        case 'p':
+            showFrame = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            break;
+        }
+    }
+    if (optind != argc - 1 || width < 1)
+        print_usage(argv[0]);
+}
+
+int main(int argc, char * argv[])
+{
+    parse_opts(argc, argv);
+
+    const ledTiming_t* pTiming = ledTimingFind(chip);
+    if (pTiming == NULL)
+    {
+        printf("Unknown chip: %s\n", chip);
+        exit(1);
+    }
+
+    FILE* pFile = fopen(argv[optind], "rb");
+    if (pFile == NULL)
+    {
+        perror("can't open capture");
+        exit(1);
+    }
+    fseek(pFile, 0, SEEK_END);
+    long size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    uint8_t* capture = (uint8_t*)malloc(size > 0? size : 1);
+    if (fread(capture, 1, size, pFile) != (size_t)size)
+    {
+        perror("can't read capture");
+        exit(1);
+    }
+    fclose(pFile);
+
+    int frames = 0;
+    int badFrames = 0;
+    uint32_t shortestTail = 0xFFFFFFFF;
+    int ledsMin = 0x7FFFFFFF;
+    int ledsMax = 0;
+    uint32_t offset = 0;
+    while (offset < (uint32_t)size)
+    {
+        uint32_t len = wireFrameLength(&capture[offset], size - offset);
+        wireDecode_t decode;
+        int maxLeds = len / (3 * SPI_BYTES_PER_BYTE);
+        rgbPixel_t* leds = new rgbPixel_t[maxLeds > 0? maxLeds : 1];
+        wireDecode(&capture[offset], len, leds, maxLeds, &decode);
+
+        if (decode.badSymbols || decode.strayBytes)
+        {
+            badFrames++;
+            printf("frame %d at byte %u: %u bad symbols (first at +%d), %u stray bytes\n",
+                frames, offset, decode.badSymbols, decode.firstBadOffset,
+                decode.strayBytes);
+        }
+        if (decode.refreshBytes < shortestTail)
+            shortestTail = decode.refreshBytes;
+        if (decode.leds < ledsMin)
+            ledsMin = decode.leds;
+        if (decode.leds > ledsMax)
+            ledsMax = decode.leds;
+
+        if (frames == showFrame)
+        {
+            printf("frame %d: %d LEDs, %u tail bytes\n", frames, decode.leds,
+                decode.refreshBytes);
+            for (int i = 0; i < decode.leds; i++)
+            {
+                printf("%02X:%02X:%02X%s", leds[i].r, leds[i].g, leds[i].b,
+                    (i + 1) % width == 0? "\n" : " ");
+            }
+            printf("\n");
+        }
+
+        delete[] leds;
+        offset += len;
+        frames++;
+    }
+
+    printf("capture: %ld bytes, %d frames of %d-%d LEDs, %d with errors\n",
+        size, frames, frames? ledsMin : 0, ledsMax, badFrames);
+
+    wireTiming_t timing;
+    wireCheckTiming(speed, frames? shortestTail : REFRESH_SIZE, pTiming, &timing);
+    wirePrintTiming(&timing, pTiming);
+
+    free(capture);
+    return badFrames || !timing.ok? 1 : 0;
+}